@@ -8,19 +8,23 @@ const string BedrockCommand::defaultPluginName("NO_PLUGIN");
 
 BedrockCommand::BedrockCommand(SQLiteCommand&& baseCommand, BedrockPlugin* plugin, bool escalateImmediately_) :
     SQLiteCommand(move(baseCommand)),
+    _arena(_arenaBuffer, sizeof(_arenaBuffer)),
     priority(PRIORITY_NORMAL),
     peekCount(0),
     processCount(0),
     repeek(false),
+    timingInfo(&_arena),
     crashIdentifyingValues(*this),
+    timeoutHandle(0),
     escalateImmediately(escalateImmediately_),
     _plugin(plugin),
     _inProgressTiming(INVALID, 0, 0),
     _timeout(_getTimeout(request))
 {
     // Initialize the priority, if supplied.
-    if (request.isSet("priority")) {
-        int tempPriority = request.calc("priority");
+    auto priorityIt = request.nameValueMap.find(SHeaderTable::PRIORITY);
+    if (priorityIt != request.nameValueMap.end()) {
+        int tempPriority = min((long)strtoll(priorityIt->second.c_str(), 0, 10), (long)0x7fffffffL);
         switch (tempPriority) {
             // For any valid case, we just set the value directly.
             case BedrockCommand::PRIORITY_MIN:
@@ -49,10 +53,14 @@ const string& BedrockCommand::getName() const {
 
 int64_t BedrockCommand::_getTimeout(const SData& request) {
     // Timeout is the default, unless explicitly supplied, or if Connection: forget is set.
+    // These are looked up on every command, so use the pre-hashed header names.
+    const SHeaderTable& headers = request.nameValueMap;
     int64_t timeout =  DEFAULT_TIMEOUT;
-    if (request.isSet("timeout")) {
-        timeout = request.calc("timeout");
-    } else if (SIEquals(request["connection"], "forget")) {
+    auto timeoutIt = headers.find(SHeaderTable::TIMEOUT);
+    auto connectionIt = headers.find(SHeaderTable::CONNECTION);
+    if (timeoutIt != headers.end()) {
+        timeout = min((long)strtoll(timeoutIt->second.c_str(), 0, 10), (long)0x7fffffffL);
+    } else if (connectionIt != headers.end() && SIEquals(connectionIt->second, "forget")) {
         timeout = DEFAULT_TIMEOUT_FORGET;
     }
 
@@ -60,8 +68,9 @@ int64_t BedrockCommand::_getTimeout(const SData& request) {
     timeout *= 1000;
 
     int64_t start;
-    if (request.isSet("commandExecuteTime")) {
-        start = request.calc64("commandExecuteTime");
+    auto executeTimeIt = headers.find(SHeaderTable::COMMAND_EXECUTE_TIME);
+    if (executeTimeIt != headers.end()) {
+        start = strtoll(executeTimeIt->second.c_str(), 0, 10);
     } else {
         SWARN("BedrockCommand '" + request.methodLine + "' created with no commandExecuteTime, should be done in base constructor!");
         start = STimeNow();
@@ -83,7 +92,7 @@ void BedrockCommand::startTiming(TIMING_INFO type) {
         SWARN("Starting timing, but looks like it was already running.");
     }
     get<0>(_inProgressTiming) = type;
-    get<1>(_inProgressTiming) = STimeNow();
+    get<1>(_inProgressTiming) = SMonotonicNow();
     get<2>(_inProgressTiming) = 0;
 }
 
@@ -95,7 +104,7 @@ void BedrockCommand::stopTiming(TIMING_INFO type) {
     }
 
     // Add it to the list of timing info.
-    get<2>(_inProgressTiming) = STimeNow();
+    get<2>(_inProgressTiming) = SMonotonicNow();
     timingInfo.push_back(_inProgressTiming);
 
     // And reset it for next use.
@@ -117,6 +126,7 @@ void BedrockCommand::reset(BedrockCommand::STAGE stage) {
     if (stage == STAGE::PEEK) {
         jsonContent.clear();
         response.clear();
+        _holdTimeoutResponse.clear();
     }
 }
 
@@ -151,13 +161,13 @@ void BedrockCommand::finalizeTimingInfo() {
                                             escalationTimeUS + queueWorkerTotal + queueSyncTotal);
 
     // Build a map of the values we care about.
-    map<string, uint64_t> valuePairs = {
+    pmr::map<string, uint64_t> valuePairs({
         {"peekTime",        peekTotal},
         {"processTime",     processTotal},
         {"totalTime",       totalTime},
         {"escalationTime",  escalationTimeUS},
         {"unaccountedTime", unaccountedTime},
-    };
+    }, &_arena);
 
     // We also want to know what leader did if we're on a follower.
     uint64_t upstreamPeekTime = 0;
@@ -4,6 +4,13 @@
 class BedrockPlugin;
 
 class BedrockCommand : public SQLiteCommand {
+  private:
+    // Backing storage for `arena()`. This is declared first so that it's constructed before, and destroyed after, any
+    // of the members below that allocate from it.
+    static const size_t ARENA_INLINE_SIZE = 2048;
+    alignas(max_align_t) char _arenaBuffer[ARENA_INLINE_SIZE];
+    pmr::monotonic_buffer_resource _arena;
+
   public:
     enum Priority {
         PRIORITY_MIN = 0,
@@ -80,6 +87,15 @@ class BedrockCommand : public SQLiteCommand {
     // Returns true if all of the httpsRequests for this command are complete (or if it has none).
     bool areHttpsRequestsComplete() const;
 
+    // Scratch memory for this command. Allocations are carved out of a buffer inside the command (and larger blocks
+    // after that runs out), never individually freed, and all released at once when the command is destroyed. Use it
+    // for allocator-aware containers holding temporary data while handling the command, i.e.:
+    //     pmr::string query(command.arena());
+    //     pmr::vector<pmr::string> values(command.arena());
+    // Nothing allocated here can outlive the command, and it's not thread-safe, which is fine as long as it's only
+    // used by whichever thread is currently handling the command.
+    pmr::memory_resource* arena() { return &_arena; }
+
     // If the `peek` portion of this command needs to make an HTTPS request, this is where we store it.
     list<SHTTPSManager::Transaction*> httpsRequests;
 
@@ -104,8 +120,16 @@ class BedrockCommand : public SQLiteCommand {
     // all HTTPS requests are complete. It will be automatically cleared if the command throws an exception.
     bool repeek;
 
-    // A list of timing sets, with an info type, start, and end.
-    list<tuple<TIMING_INFO, uint64_t, uint64_t>> timingInfo;
+    // `peek` can call this, rather than answering, to have the server hold the command until something it's waiting
+    // for changes, without using a worker while it waits. The command's plugin calls
+    // `BedrockServer::releaseHeldCommands` when that might have happened, and the command is peeked again. If it times
+    // out first, it's answered with `timeoutResponse` instead. This is cleared each time the command is peeked.
+    void hold(const string& timeoutResponse) { _holdTimeoutResponse = timeoutResponse; }
+    bool isHeld() const { return !_holdTimeoutResponse.empty(); }
+    const string& holdTimeoutResponse() const { return _holdTimeoutResponse; }
+
+    // A list of timing sets, with an info type, start, and end. Allocated from `arena()`.
+    pmr::list<tuple<TIMING_INFO, uint64_t, uint64_t>> timingInfo;
 
     // This defaults to false, but a specific plugin can set it to 'true' to force this command to be passed
     // to the sync thread for processing, thus guaranteeing that process() will not result in a conflict.
@@ -143,6 +167,10 @@ class BedrockCommand : public SQLiteCommand {
     // Return the timestamp by which this command must finish executing.
     uint64_t timeout() const { return _timeout; }
 
+    // A command only ever waits in one place at a time. Whichever `STimerWheel` is tracking its timeout while it waits
+    // keeps the handle here, so it can cancel it when the command stops waiting.
+    STimerHandle timeoutHandle;
+
     // Return the number of commands in existence.
     static size_t getCommandCount() { return _commandCount.load(); }
 
@@ -167,6 +195,9 @@ class BedrockCommand : public SQLiteCommand {
     // This is a timestamp in *microseconds* for when this command should timeout.
     uint64_t _timeout;
 
+    // Set by `hold`.
+    string _holdTimeoutResponse;
+
     static atomic<size_t> _commandCount;
 
     static const string defaultPluginName;
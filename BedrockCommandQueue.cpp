@@ -15,6 +15,9 @@ BedrockCommandQueue::BedrockCommandQueue() :
 list<string> BedrockCommandQueue::getRequestMethodLines() {
     list<string> returnVal;
     SAUTOLOCK(_queueMutex);
+    for (auto& item : _timedOut) {
+        returnVal.push_back(item->request.methodLine);
+    }
     for (auto& queue : _queue) {
         for (auto& entry : queue.second) {
             returnVal.push_back(entry.second.item->request.methodLine);
@@ -41,8 +44,12 @@ void BedrockCommandQueue::abandonFutureCommands(int msInFuture) {
             commandMapIt++;
         }
 
-        // Whatever's left in the queue is scheduled in the future and can be erased.
-        size_t numberToErase = distance(commandMapIt, queueMapIt->second.end());
+        // Whatever's left in the queue is scheduled in the future and can be erased, along with its timeout.
+        size_t numberToErase = 0;
+        for (auto it = commandMapIt; it != queueMapIt->second.end(); it++) {
+            _timeouts.cancel(it->second.timeoutHandle);
+            numberToErase++;
+        }
         if (numberToErase) {
             queueMapIt->second.erase(commandMapIt, queueMapIt->second.end());
         }
@@ -21,9 +21,9 @@ class BedrockCore : public SQLiteCore {
     class AutoTimer {
       public:
         AutoTimer(unique_ptr<BedrockCommand>& command, BedrockCommand::TIMING_INFO type) :
-        _command(command), _type(type), _start(STimeNow()) { }
+        _command(command), _type(type), _start(SMonotonicNow()) { }
         ~AutoTimer() {
-            _command->timingInfo.emplace_back(make_tuple(_type, _start, STimeNow()));
+            _command->timingInfo.emplace_back(make_tuple(_type, _start, SMonotonicNow()));
         }
       private:
         unique_ptr<BedrockCommand>& _command;
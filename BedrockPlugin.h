@@ -76,6 +76,12 @@ class BedrockPlugin {
     // re-open those connections if not handled elsewhere in the plugin.
     virtual void onAttach() {}
 
+    // Called by the sync thread each time it opens the database, before any commands run or any transactions are
+    // replicated, and again just before it closes it. Plugins that keep in-memory state derived from the database can
+    // build it, and register for changes to it (see `SQLite::RowChangeListener`), here.
+    virtual void onDatabaseOpen(SQLite& db) {}
+    virtual void onDatabaseClose(SQLite& db) {}
+
     // Map of plugin names to functions that will return a new plugin of the given type.
     static map<string, function<BedrockPlugin*(BedrockServer&)>> g_registeredPluginList;
 
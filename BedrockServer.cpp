@@ -187,6 +187,17 @@ void BedrockServer::sync(const SData& args,
     // Initialize the command processor.
     BedrockCore core(db, server);
 
+    // Commands waiting on future commits are released by our notifier as the DB commits. It starts from wherever the
+    // DB is now.
+    server._futureCommitNotifier.reset();
+    server._futureCommitNotifier.notifyThrough(db.getCommitCount());
+    db.addCommitListener(server._futureCommitNotifier);
+
+    // Let plugins set up anything they keep in memory that's derived from the DB, before anything else can change it.
+    for (auto plugin : server.plugins) {
+        plugin.second->onDatabaseOpen(db);
+    }
+
     // And the sync node.
     uint64_t firstTimeout = STIME_US_PER_M * 2 + SRandom::rand64() % STIME_US_PER_S * 30;
 
@@ -238,75 +249,29 @@ void BedrockServer::sync(const SData& args,
             SAUTOPREFIX(command->request);
         }
 
-        // If there were commands waiting on our commit count to come up-to-date, we'll move them back to the main
-        // command queue here. There's no place in particular that's best to do this, so we do it at the top of this
-        // main loop, as that prevents it from ever getting skipped in the event that we `continue` early from a loop
-        // iteration.
+        // Commands waiting on our commit count to come up-to-date go back to the main command queue as soon as the
+        // commit they need lands (see `_waitForFutureCommit`), but any that time out first are moved back here. There's
+        // no place in particular that's best to do this, so we do it at the top of this main loop, as that prevents it
+        // from ever getting skipped in the event that we `continue` early from a loop iteration.
         // We also move all commands back to the main queue here if we're shutting down, just to make sure they don't
         // end up lost in the ether.
         {
             SAUTOLOCK(server._futureCommitCommandMutex);
-
-            // First, see if anything has timed out, and move that back to the main queue.
-            if (server._futureCommitCommandTimeouts.size()) {
-                uint64_t now = STimeNow();
-                auto it =  server._futureCommitCommandTimeouts.begin();
-                while (it != server._futureCommitCommandTimeouts.end() && it->first < now) {
-                    // Find commands depending on this commit.
-                    auto itPair =  server._futureCommitCommands.equal_range(it->second);
-                    for (auto cmdIt = itPair.first; cmdIt != itPair.second; cmdIt++) {
-                        // Check for one with this timeout.
-                        if (cmdIt->second->timeout() == it->first) {
-                            // This command has the right commit count *and* timeout, return it.
-                            SINFO("Returning command (" << cmdIt->second->request.methodLine << ") waiting on commit " << cmdIt->first
-                                  << " to queue, timed out at: " << now << ", timeout was: " << it->first << ".");
-
-                            // Goes back to the main queue, where it will hit it's timeout in a worker thread.
-                            server._commandQueue.push(move(cmdIt->second));
-
-                            // And delete it, it's gone.
-                             server._futureCommitCommands.erase(cmdIt);
-
-                            // Done.
-                            break;
-                        }
-                    }
-                    it++;
-                }
-
-                // And remove everything we just iterated through.
-                if (it != server._futureCommitCommandTimeouts.begin()) {
-                    server._futureCommitCommandTimeouts.erase(server._futureCommitCommandTimeouts.begin(), it);
-                }
-            }
-
-            // Anything that hasn't timed out might be ready to return because the commit count is up-to-date.
-            if (!server._futureCommitCommands.empty()) {
-                uint64_t commitCount = db.getCommitCount();
-                auto it = server._futureCommitCommands.begin();
-                while (it != server._futureCommitCommands.end() && (it->first <= commitCount || server._shutdownState.load() != RUNNING)) {
-                    // Save the timeout since we'll be moving the command, thus making this inaccessible.
-                    uint64_t commandTimeout = it->second->timeout();
-                    SINFO("Returning command (" << it->second->request.methodLine << ") waiting on commit " << it->first
-                          << " to queue, now have commit " << commitCount);
-                    server._commandQueue.push(move(it->second));
-
-                    // Remove it from the timed out list as well.
-                    auto itPair = server._futureCommitCommandTimeouts.equal_range(commandTimeout);
-                    for (auto timeoutIt = itPair.first; timeoutIt != itPair.second; timeoutIt++) {
-                        if (timeoutIt->second == it->first) {
-                             server._futureCommitCommandTimeouts.erase(timeoutIt);
-                            break;
-                        }
-                    }
-                    it++;
-                }
-                if (it != server._futureCommitCommands.begin()) {
-                    server._futureCommitCommands.erase(server._futureCommitCommands.begin(), it);
+            server._futureCommitCommandTimeouts.expire(STimeCached(), [&server](uint64_t& id) {
+                server._releaseFutureCommitCommand(id, true);
+            });
+            if (server._shutdownState.load() != RUNNING) {
+                while (!server._futureCommitCommands.empty()) {
+                    server._releaseFutureCommitCommand(server._futureCommitCommands.begin()->first, false);
                 }
             }
         }
 
+        // Same for held commands, except that these are answered rather than re-queued, as running them again would
+        // only hold them again. When we're shutting down, we answer all of them, so their clients don't keep us
+        // waiting.
+        server._timeOutHeldCommands(server._shutdownState.load() != RUNNING);
+
         // If we're in a state where we can initialize shutdown, then go ahead and do so.
         // Having responded to all clients means there are no *local* clients, but it doesn't mean there are no
         // escalated commands. This is fine though - if we're following, there can't be any escalated commands, and if
@@ -333,6 +298,7 @@ void BedrockServer::sync(const SData& args,
         // Add our command queues to our fd_map.
         syncNodeQueuedCommands.prePoll(fdm);
         server._completedCommands.prePoll(fdm);
+        server._syncThreadTasks.prePoll(fdm);
 
         // Wait for activity on any of those FDs, up to a timeout.
         const uint64_t now = STimeNow();
@@ -345,8 +311,9 @@ void BedrockServer::sync(const SData& args,
         }
         server._syncMutex.lock();
 
-        // And set our next timeout for 1 second from now.
-        nextActivity = STimeNow() + STIME_US_PER_S;
+        // And set our next timeout for 1 second from now. This also refreshes the cached time used by everything else
+        // that runs between here and the next poll.
+        nextActivity = STimeRefresh() + STIME_US_PER_S;
 
         // Process any network traffic that happened. Scope this so that we can change the log prefix and have it
         // auto-revert when we're finished.
@@ -360,6 +327,12 @@ void BedrockServer::sync(const SData& args,
             server._syncNode->postPoll(fdm, nextActivity);
             syncNodeQueuedCommands.postPoll(fdm);
             server._completedCommands.postPoll(fdm);
+            server._syncThreadTasks.postPoll(fdm);
+        }
+
+        // Run anything other threads have left for us to do.
+        while (!server._syncThreadTasks.empty()) {
+            server._syncThreadTasks.pop()();
         }
 
         // Ok, let the sync node to it's updating for as many iterations as it requires. We'll update the replication
@@ -603,7 +576,9 @@ void BedrockServer::sync(const SData& args,
                             // This command completed in peek, respond to it appropriately, either directly or by sending it
                             // back to the sync thread.
                             SASSERT(command->complete);
-                            if (command->initiatingPeerID) {
+                            if (command->isHeld()) {
+                                server._holdCommand(move(command));
+                            } else if (command->initiatingPeerID) {
                                 server._finishPeerCommand(command);
                             } else {
                                 server._reply(command);
@@ -669,7 +644,7 @@ void BedrockServer::sync(const SData& args,
                     // If we're following, we just escalate directly to leader without peeking. We can only get an incomplete
                     // command on the follower sync thread if a follower worker thread peeked it unsuccessfully, so we don't
                     // bother peeking it again.
-                    auto it = command->request.nameValueMap.find("Connection");
+                    auto it = command->request.nameValueMap.find(SHeaderTable::CONNECTION);
                     bool forget = it != command->request.nameValueMap.end() && SIEquals(it->second, "forget");
                     server._syncNode->escalateCommand(move(command), forget);
                 }
@@ -721,6 +696,12 @@ void BedrockServer::sync(const SData& args,
         workerThread.join();
     }
 
+    // Nothing commits after this, and the DB is going away.
+    db.removeCommitListener(server._futureCommitNotifier);
+    for (auto plugin : server.plugins) {
+        plugin.second->onDatabaseClose(db);
+    }
+
     // If there's anything left in the command queue here, we'll discard it, because we have no way of processing it.
     if (server._commandQueue.size()) {
         SWARN("Sync thread shut down with " << server._commandQueue.size() << " queued commands. Commands were: "
@@ -779,6 +760,7 @@ void BedrockServer::worker(SQLitePool& dbPool,
 
             // And get another one.
             command = commandQueue.get(1000000);
+            STimeRefresh();
 
             SAUTOPREFIX(command->request);
             SINFO("Dequeued command " << command->request.methodLine << " in worker, "
@@ -895,7 +877,7 @@ void BedrockServer::worker(SQLitePool& dbPool,
                 // is note that and discard it, as we have nobody to deliver it to.
                 if (command->initiatingPeerID) {
                     // Let's note how old this command is.
-                    uint64_t ageSeconds = (STimeNow() - command->creationTime) / STIME_US_PER_S;
+                    uint64_t ageSeconds = (STimeCached() - command->creationTime) / STIME_US_PER_S;
                     SWARN("Found unexpected complete command " << command->request.methodLine
                           << " from peer in worker thread. Discarding (command was " << ageSeconds << "s old).");
                     continue;
@@ -913,23 +895,16 @@ void BedrockServer::worker(SQLitePool& dbPool,
             }
 
             // If this command is dependent on a commitCount newer than what we have (maybe it's a follow-up to a
-            // command that was escalated to leader), we'll set it aside for later processing. When the sync node
-            // finishes its update loop, it will re-queue any of these commands that are no longer blocked on our
-            // updated commit count.
+            // command that was escalated to leader), we'll set it aside for later processing. It's re-queued as soon
+            // as that commit lands, or when it times out.
             uint64_t commitCount = db.getCommitCount();
             uint64_t commandCommitCount = command->request.calcU64("commitCount");
             if (commandCommitCount > commitCount) {
-                SAUTOLOCK(server._futureCommitCommandMutex);
-                auto newQueueSize = server._futureCommitCommands.size() + 1;
                 SINFO("Command (" << command->request.methodLine << ") depends on future commit (" << commandCommitCount
-                      << "), Currently at: " << commitCount << ", storing for later. Queue size: " << newQueueSize);
-                server._futureCommitCommandTimeouts.insert(make_pair(command->timeout(), commandCommitCount));
-                server._futureCommitCommands.insert(make_pair(commandCommitCount, move(command)));
+                      << "), Currently at: " << commitCount << ", storing for later.");
 
                 // Don't count this as `in progress`, it's just sitting there.
-                if (newQueueSize > 100) {
-                    SHMMM("server._futureCommitCommands.size() == " << newQueueSize);
-                }
+                server._waitForFutureCommit(move(command), commandCommitCount);
                 continue;
             }
 
@@ -954,7 +929,7 @@ void BedrockServer::worker(SQLitePool& dbPool,
             // If all the other checks have passed, and we haven't sent a quorum command to the sync thread in a while,
             // auto-promote one.
             if (canWriteParallel) {
-                uint64_t now = STimeNow();
+                uint64_t now = STimeCached();
                 if (now > (server._lastQuorumCommandTime + (server._quorumCheckpointSeconds * 1'000'000))) {
                     SINFO("Forcing QUORUM for command '" << command->request.methodLine << "'.");
                     server._lastQuorumCommandTime = now;
@@ -985,6 +960,12 @@ void BedrockServer::worker(SQLitePool& dbPool,
                     continue;
                 }
 
+                // Peek asked to hold this command until something changes, so we set it aside until then.
+                if (peekResult == BedrockCore::RESULT::COMPLETE && command->isHeld()) {
+                    server._holdCommand(move(command));
+                    break;
+                }
+
                 if (!calledPeek || peekResult == BedrockCore::RESULT::SHOULD_PROCESS) {
                     // We've just unsuccessfully peeked a command, which means we're in a state where we might want to
                     // write it. We'll flag that here, to keep the node from falling out of LEADING/STANDINGDOWN
@@ -1229,7 +1210,9 @@ BedrockServer::BedrockServer(SQLiteNode::State state, const SData& args_) : SQLi
 BedrockServer::BedrockServer(const SData& args_)
   : SQLiteServer(""), shutdownWhileDetached(false), args(args_), _requestCount(0), _replicationState(SQLiteNode::SEARCHING),
     _upgradeInProgress(false), _suppressCommandPort(false), _suppressCommandPortManualOverride(false),
-    _syncThreadComplete(false), _syncNode(nullptr), _shutdownState(RUNNING),
+    _syncThreadComplete(false), _syncNode(nullptr), _nextFutureCommitID(1), _futureCommitReleasedCount(0),
+    _futureCommitTimedOutCount(0), _futureCommitTotalWaitUS(0), _futureCommitMaxWaitUS(0), _nextHeldCommandID(1),
+    _heldCommandReleasedCount(0), _heldCommandTimedOutCount(0), _shutdownState(RUNNING),
     _multiWriteEnabled(args.test("-enableMultiWrite")), _shouldBackup(false), _detach(args.isSet("-bootstrap")),
     _controlPort(nullptr), _commandPort(nullptr), _maxConflictRetries(3), _lastQuorumCommandTime(STimeNow()),
     _pluginsDetached(false)
@@ -1500,7 +1483,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
     _acceptSockets();
 
     // Time the end of the accept section.
-    uint64_t acceptEndTime = STimeNow();
+    uint64_t acceptEndTime = SMonotonicNow();
 
     // Process any new activity from incoming sockets. In order to not modify the socket list while we're iterating
     // over it, we'll keep a list of sockets that need closing.
@@ -1529,7 +1512,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                     SAUTOLOCK(_socketIDMutex);
                     if (s->recvBuffer.empty()) {
                         // If nothing's been received, break early.
-                        if (_shutdownState.load() != RUNNING && lastChance && lastChance < STimeNow() && _socketIDMap.find(s->id) == _socketIDMap.end()) {
+                        if (_shutdownState.load() != RUNNING && lastChance && lastChance < STimeCached() && _socketIDMap.find(s->id) == _socketIDMap.end()) {
                             // If we're shutting down and past our lastChance timeout, we start killing these.
                             SINFO("Closing socket " << s->id << " with no data and no pending command: shutting down.");
                             socketsToClose.push_back(s);
@@ -1573,7 +1556,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                     deserializedRequests++;
                     // Either shut down the socket or store it so we can eventually sync out the response.
                     if (SIEquals(request["Connection"], "forget") ||
-                        (uint64_t)request.calc64("commandExecuteTime") > STimeNow()) {
+                        (uint64_t)request.calc64("commandExecuteTime") > STimeCached()) {
                         // Respond immediately to make it clear we successfully queued it, but don't add to the socket
                         // map as we don't care about the answer.
                         SINFO("Firing and forgetting '" << request.methodLine << "'");
@@ -1636,7 +1619,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                 } else {
                     SAUTOLOCK(_socketIDMutex);
                     // If we weren't able to deserialize a complete request, and we're shutting down, give up.
-                    if (_shutdownState.load() != RUNNING && lastChance && lastChance < STimeNow() && _socketIDMap.find(s->id) == _socketIDMap.end()) {
+                    if (_shutdownState.load() != RUNNING && lastChance && lastChance < STimeCached() && _socketIDMap.find(s->id) == _socketIDMap.end()) {
                         SINFO("Closing socket " << s->id << " with incomplete data and no pending command: shutting down.");
                         socketsToClose.push_back(s);
                     }
@@ -1658,7 +1641,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
     }
 
     // Log the timing of this loop.
-    uint64_t readElapsedMS = (STimeNow() - acceptEndTime) / 1000;
+    uint64_t readElapsedMS = (SMonotonicNow() - acceptEndTime) / 1000;
     SINFO("[performance] Read from " << socketList.size() << " sockets, attempted to deserialize " << deserializationAttempts
           << " commands, " << deserializedRequests << " were complete and deserialized in " << readElapsedMS << "ms.");
 
@@ -1679,7 +1662,7 @@ void BedrockServer::postPoll(fd_map& fdm, uint64_t& nextActivity) {
     // If we've been told to start shutting down, we'll set the lastChance timer.
     if (_shutdownState.load() == START_SHUTDOWN) {
         if (!lastChance) {
-            lastChance = STimeNow() + 5 * 1'000'000; // 5 seconds from now.
+            lastChance = STimeCached() + 5 * 1'000'000; // 5 seconds from now.
         }
         // If we've run out of sockets or hit our timeout, we'll increment _shutdownState.
         if (socketList.empty() || _gracefulShutdownTimeout.ringing()) {
@@ -1829,6 +1812,7 @@ bool BedrockServer::getPeerInfo(list<STable>& peerData) {
                 peerData.back()["host"] = peer->host;
                 peerData.back()["name"] = peer->name;
                 peerData.back()["State"] = SQLiteNode::stateName(peer->state);
+                peerData.back()["unknownMessages"] = to_string(peer->unknownMessages);
             }
         }
     } else {
@@ -1944,6 +1928,9 @@ void BedrockServer::_status(unique_ptr<BedrockCommand>& command) {
 
                     // Get any escalated commands that are waiting to be processed.
                     escalated = _syncNodeCopy->getEscalatedCommandRequestMethodLines();
+
+                    // And how long the sync node has spent handling each kind of peer message.
+                    content["peerMessageTiming"] = SComposeJSONObject(_syncNodeCopy->getMessageTiming());
                 } else {
                     content["syncNodeAvailable"] = "false";
                 }
@@ -1977,6 +1964,28 @@ void BedrockServer::_status(unique_ptr<BedrockCommand>& command) {
         content["syncThreadQueuedCommandList"] = SComposeJSONArray(syncNodeQueuedMethods);
         content["escalatedCommandList"]        = SComposeJSONArray(escalated);
 
+        // How commands waiting on future commits have fared.
+        {
+            SAUTOLOCK(_futureCommitCommandMutex);
+            STable futureCommitWait;
+            futureCommitWait["waiting"] = to_string(_futureCommitCommands.size());
+            futureCommitWait["released"] = to_string(_futureCommitReleasedCount);
+            futureCommitWait["timedOut"] = to_string(_futureCommitTimedOutCount);
+            futureCommitWait["totalWaitUS"] = to_string(_futureCommitTotalWaitUS);
+            futureCommitWait["maxWaitUS"] = to_string(_futureCommitMaxWaitUS);
+            content["futureCommitWait"] = SComposeJSONObject(futureCommitWait);
+        }
+
+        // And how commands held by their plugins have fared.
+        {
+            lock_guard<decltype(_heldCommandMutex)> lock(_heldCommandMutex);
+            STable heldCommands;
+            heldCommands["waiting"] = to_string(_heldCommands.size());
+            heldCommands["released"] = to_string(_heldCommandReleasedCount);
+            heldCommands["timedOut"] = to_string(_heldCommandTimedOutCount);
+            content["heldCommands"] = SComposeJSONObject(heldCommands);
+        }
+
         // Done, compose the response.
         response.methodLine = "200 OK";
         response.content = SComposeJSONObject(content);
@@ -2111,17 +2120,19 @@ void BedrockServer::_prePollPlugins(fd_map& fdm) {
 
 void BedrockServer::_postPollPlugins(fd_map& fdm, uint64_t nextActivity) {
     // Only pass timeouts for transactions belonging to timed out commands.
-    uint64_t now = STimeNow();
+    uint64_t now = STimeCached();
     map<SHTTPSManager::Transaction*, uint64_t> transactionTimeouts;
     {
         lock_guard<mutex> lock(_httpsCommandMutex);
-        auto timeoutIt = _outstandingHTTPSCommands.begin();
-        while (timeoutIt != _outstandingHTTPSCommands.end() && (*timeoutIt)->timeout() < now) {
+        _httpsCommandTimeouts.expire(now, [this](BedrockCommand*& command) {
+            command->timeoutHandle = 0;
+            _timedOutHTTPSCommands.insert(command);
+        });
+        for (auto command : _timedOutHTTPSCommands) {
             // Add all the transactions for this command, even if some are already complete, they'll just get ignored.
-            for (auto transaction : (*timeoutIt)->httpsRequests) {
-                transactionTimeouts[transaction] = (*timeoutIt)->timeout();
+            for (auto transaction : command->httpsRequests) {
+                transactionTimeouts[transaction] = command->timeout();
             }
-            timeoutIt++;
         }
     }
 
@@ -2143,6 +2154,134 @@ void BedrockServer::_postPollPlugins(fd_map& fdm, uint64_t nextActivity) {
     }
 }
 
+void BedrockServer::_waitForFutureCommit(unique_ptr<BedrockCommand>&& command, uint64_t commitCount) {
+    SAUTOLOCK(_futureCommitCommandMutex);
+    uint64_t id = _nextFutureCommitID++;
+    BedrockCommand* commandPtr = command.get();
+    _futureCommitCommands.emplace(id, FutureCommitCommand{move(command), commitCount, 0, SMonotonicNow()});
+    commandPtr->timeoutHandle = _futureCommitCommandTimeouts.add(commandPtr->timeout(), id);
+    if (_futureCommitCommands.size() > 100) {
+        SHMMM("_futureCommitCommands.size() == " << _futureCommitCommands.size());
+    }
+
+    // If the commit has landed since our caller checked, this calls back before it returns, and the command's already
+    // gone back to the queue. We can still get the lock in the callback, as it's recursive.
+    uint64_t callbackID = _futureCommitNotifier.notifyWhen(commitCount, [this, id](SQLiteSequentialNotifier::RESULT result) {
+        SAUTOLOCK(_futureCommitCommandMutex);
+        _releaseFutureCommitCommand(id, false);
+    });
+    auto it = _futureCommitCommands.find(id);
+    if (it != _futureCommitCommands.end()) {
+        it->second.callbackID = callbackID;
+    }
+}
+
+void BedrockServer::_releaseFutureCommitCommand(uint64_t id, bool timedOut) {
+    // The commit can land just as the command times out, in which case whichever's second has nothing to do.
+    auto it = _futureCommitCommands.find(id);
+    if (it == _futureCommitCommands.end()) {
+        return;
+    }
+    FutureCommitCommand& waiting = it->second;
+    uint64_t waitUS = SMonotonicNow() - waiting.waitStart;
+    _futureCommitTotalWaitUS += waitUS;
+    _futureCommitMaxWaitUS = max(_futureCommitMaxWaitUS, waitUS);
+    if (timedOut) {
+        _futureCommitTimedOutCount++;
+        SINFO("Returning command (" << waiting.command->request.methodLine << ") waiting on commit " << waiting.commitCount
+              << " to queue, timed out after " << waitUS / 1000 << "ms.");
+    } else {
+        _futureCommitReleasedCount++;
+        SINFO("Returning command (" << waiting.command->request.methodLine << ") waiting on commit " << waiting.commitCount
+              << " to queue, waited " << waitUS / 1000 << "ms.");
+    }
+
+    // Whichever of these didn't release the command doesn't need to anymore.
+    _futureCommitNotifier.removeCallback(waiting.callbackID);
+    _futureCommitCommandTimeouts.cancel(waiting.command->timeoutHandle);
+    waiting.command->timeoutHandle = 0;
+    _commandQueue.push(move(waiting.command));
+    _futureCommitCommands.erase(it);
+}
+
+void BedrockServer::_holdCommand(unique_ptr<BedrockCommand>&& command) {
+    // Nothing's going to change for this command once we've started shutting down, so there's no point holding it.
+    // Nor do we hold commands escalated from peers, which are only escalated once the peer found something to do.
+    if (_shutdownState.load() != RUNNING || command->initiatingPeerID) {
+        command->response.clear();
+        command->response.methodLine = command->holdTimeoutResponse();
+        if (command->initiatingPeerID) {
+            _finishPeerCommand(command);
+        } else {
+            _reply(command);
+        }
+        return;
+    }
+
+    SINFO("Holding command " << command->request.methodLine << " until it's released or times out.");
+    command->complete = false;
+    lock_guard<decltype(_heldCommandMutex)> lock(_heldCommandMutex);
+    HeldCommandKey key(-(int)command->priority, _nextHeldCommandID++);
+    command->timeoutHandle = _heldCommandTimeouts.add(command->timeout(), key);
+    _heldCommands.emplace(key, HeldCommand{move(command), SMonotonicNow()});
+}
+
+void BedrockServer::releaseHeldCommands(const BedrockPlugin& plugin,
+                                        const function<bool(BedrockCommand& command)>& shouldRelease) {
+    lock_guard<decltype(_heldCommandMutex)> lock(_heldCommandMutex);
+    for (auto it = _heldCommands.begin(); it != _heldCommands.end();) {
+        unique_ptr<BedrockCommand>& command = it->second.command;
+        if (command->getName() != plugin.getName() || !shouldRelease(*command)) {
+            it++;
+            continue;
+        }
+        SINFO("Releasing held command " << command->request.methodLine << " after "
+              << (SMonotonicNow() - it->second.holdStart) / 1000 << "ms.");
+        _heldCommandTimeouts.cancel(command->timeoutHandle);
+        command->timeoutHandle = 0;
+        _heldCommandReleasedCount++;
+        _commandQueue.push(move(command));
+        it = _heldCommands.erase(it);
+    }
+}
+
+void BedrockServer::runOnSyncThread(function<void()>&& task) {
+    _syncThreadTasks.push(move(task));
+}
+
+void BedrockServer::_timeOutHeldCommands(bool all) {
+    list<unique_ptr<BedrockCommand>> timedOut;
+    {
+        lock_guard<decltype(_heldCommandMutex)> lock(_heldCommandMutex);
+        auto timeOut = [this, &timedOut](HeldCommandKey& key) {
+            auto it = _heldCommands.find(key);
+            if (it != _heldCommands.end()) {
+                it->second.command->timeoutHandle = 0;
+                timedOut.push_back(move(it->second.command));
+                _heldCommands.erase(it);
+            }
+        };
+        _heldCommandTimeouts.expire(STimeCached(), timeOut);
+        if (all) {
+            while (!_heldCommands.empty()) {
+                HeldCommandKey key = _heldCommands.begin()->first;
+                _heldCommandTimeouts.cancel(_heldCommands.begin()->second.command->timeoutHandle);
+                timeOut(key);
+            }
+        }
+        _heldCommandTimedOutCount += timedOut.size();
+    }
+
+    // We reply outside the lock, so that commands can be held and released while we do.
+    for (auto& command : timedOut) {
+        SINFO("Held command " << command->request.methodLine << " timed out.");
+        command->response.clear();
+        command->response.methodLine = command->holdTimeoutResponse();
+        command->complete = true;
+        _reply(command);
+    }
+}
+
 void BedrockServer::_beginShutdown(const string& reason, bool detach) {
     if (_shutdownState.load() == RUNNING) {
         _detach = detach;
@@ -2221,7 +2360,7 @@ void BedrockServer::onNodeLogin(SQLiteNode::Peer* peer)
 
 void BedrockServer::_finishPeerCommand(unique_ptr<BedrockCommand>& command) {
     // See if we're supposed to forget this command (because the follower is not listening for a response).
-    auto it = command->request.nameValueMap.find("Connection");
+    auto it = command->request.nameValueMap.find(SHeaderTable::CONNECTION);
     bool forget = it != command->request.nameValueMap.end() && SIEquals(it->second, "forget");
     command->finalizeTimingInfo();
     if (forget) {
@@ -2260,6 +2399,7 @@ void BedrockServer::waitForHTTPS(unique_ptr<BedrockCommand>&& command) {
 
     // And we keep it in a set of all commands with outstanding HTTPS requests.
     _outstandingHTTPSCommands.insert(commandPtr);
+    commandPtr->timeoutHandle = _httpsCommandTimeouts.add(commandPtr->timeout(), commandPtr);
 
     for (auto request : commandPtr->httpsRequests) {
         if (!request->response) {
@@ -2288,8 +2428,11 @@ int BedrockServer::finishWaitingForHTTPS(list<SHTTPSManager::Transaction*>& comp
             // I guess it's still here! Is it done?
             if (commandPtr->areHttpsRequestsComplete()) {
                 // If so, add it back to the main queue, erase its entry in _outstandingHTTPSCommands, and delete it.
-                _commandQueue.push(unique_ptr<BedrockCommand>(commandPtr));
+                _httpsCommandTimeouts.cancel(commandPtr->timeoutHandle);
+                commandPtr->timeoutHandle = 0;
+                _timedOutHTTPSCommands.erase(commandPtr);
                 _outstandingHTTPSCommands.erase(commandPtrIt);
+                _commandQueue.push(unique_ptr<BedrockCommand>(commandPtr));
                 commandsCompleted++;
             }
         }
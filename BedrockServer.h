@@ -227,6 +227,15 @@ class BedrockServer : public SQLiteServer {
     // Arguments passed on the command line.
     const SData args;
 
+    // Returns commands belonging to `plugin` that are being held (see `BedrockCommand::hold`) to the command queue to
+    // be peeked again. `shouldRelease` is called for each, highest priority first, then in the order they were held,
+    // and only those it returns true for are released. Safe to call from any thread.
+    void releaseHeldCommands(const BedrockPlugin& plugin, const function<bool(BedrockCommand& command)>& shouldRelease);
+
+    // Runs `task` on the sync thread, the next time it wakes up (which this makes it do), for work that's noticed
+    // somewhere it can't be done, such as inside a commit. Safe to call from any thread.
+    void runOnSyncThread(function<void()>&& task);
+
   private:
     // The name of the sync thread.
     static constexpr auto _syncThreadName = "sync";
@@ -356,16 +365,66 @@ class BedrockServer : public SQLiteServer {
     // This stars the server shutting down.
     void _beginShutdown(const string& reason, bool detach = false);
 
-    // This is a map of commit counts in the future to commands that depend on them. We can receive a command that
-    // depends on a future commit if we're a follower that's behind leader, and a client makes two requests, one to a node
-    // more current than ourselves, and a following request to us. We'll move these commands to this special map until
-    // we catch up, and then move them back to the regular command queue.
-    multimap<uint64_t, unique_ptr<BedrockCommand>> _futureCommitCommands;
+    // We can receive a command that depends on a future commit if we're a follower that's behind leader, and a client
+    // makes two requests, one to a node more current than ourselves, and a following request to us. We set these
+    // commands aside until we catch up, and then move them back to the regular command queue.
+    //
+    // `_futureCommitNotifier` is registered for commits on the DB, and calls back the moment the commit a command is
+    // waiting for lands, from whichever thread committed it, so they don't wait on anything else to notice.
+    struct FutureCommitCommand {
+        unique_ptr<BedrockCommand> command;
+        uint64_t commitCount;
+        uint64_t callbackID;
+        uint64_t waitStart;
+    };
+    map<uint64_t, FutureCommitCommand> _futureCommitCommands;
+    uint64_t _nextFutureCommitID;
+    SQLiteSequentialNotifier _futureCommitNotifier;
 
-    // Map of command timeouts to the indexes into _futureCommitCommands where those commands live.
-    multimap<uint64_t, uint64_t> _futureCommitCommandTimeouts;
+    // The timeouts of the commands in _futureCommitCommands, by their keys in that map.
+    STimerWheel<uint64_t> _futureCommitCommandTimeouts;
     recursive_mutex _futureCommitCommandMutex;
 
+    // Counts of commands released because their commit arrived or because they timed out, and the total and longest
+    // time they waited, in microseconds. Reported by `Status`.
+    uint64_t _futureCommitReleasedCount;
+    uint64_t _futureCommitTimedOutCount;
+    uint64_t _futureCommitTotalWaitUS;
+    uint64_t _futureCommitMaxWaitUS;
+
+    // Sets a command aside until the DB reaches `commitCount`, or the command times out.
+    void _waitForFutureCommit(unique_ptr<BedrockCommand>&& command, uint64_t commitCount);
+
+    // Moves a command from `_futureCommitCommands` back to the main queue, if it's still there. Call with
+    // `_futureCommitCommandMutex` held.
+    void _releaseFutureCommitCommand(uint64_t id, bool timedOut);
+
+    // Commands whose `peek` asked to be held until something changes (see `BedrockCommand::hold`), keyed by their
+    // priority, negated so that the highest comes first, and then by the order they were held in. They wait here,
+    // rather than in a worker, until their plugin releases them or they time out.
+    typedef pair<int, uint64_t> HeldCommandKey;
+    struct HeldCommand {
+        unique_ptr<BedrockCommand> command;
+        uint64_t holdStart;
+    };
+    map<HeldCommandKey, HeldCommand> _heldCommands;
+    uint64_t _nextHeldCommandID;
+    STimerWheel<HeldCommandKey> _heldCommandTimeouts;
+    mutex _heldCommandMutex;
+
+    // Counts of held commands that were released and that timed out. Reported by `Status`.
+    uint64_t _heldCommandReleasedCount;
+    uint64_t _heldCommandTimedOutCount;
+
+    // Tasks for the sync thread, queued by `runOnSyncThread`.
+    SSynchronizedQueue<function<void()>> _syncThreadTasks;
+
+    // Takes a command that `peek` asked to hold and sets it aside in `_heldCommands`.
+    void _holdCommand(unique_ptr<BedrockCommand>&& command);
+
+    // Answers any held commands that have timed out, or all of them if `all` is set, with their timeout responses.
+    void _timeOutHeldCommands(bool all);
+
     // A set of command names that will always be run with QUORUM consistency level.
     // Specified by the `-synchronousCommands` command-line switch.
     set<string> _syncCommands;
@@ -399,17 +458,14 @@ class BedrockServer : public SQLiteServer {
     map<SHTTPSManager::Transaction*, BedrockCommand*> _outstandingHTTPSRequests;
     mutex _httpsCommandMutex;
 
-    // Comparison class to sort command pointers based on their timeout rather than pointer address. This lets us keep
-    // commands ordered such that the first ones to time out are at the front.
-    struct compareCommandByTimeout {
-        bool operator() (BedrockCommand* a, BedrockCommand* b) const {
-            return a->timeout() < b->timeout();
-        }
-    };
-
     // This contains all of the command that _outstandingHTTPSRequests` points at. This allows us to keep only a single
-    // copy of each command, even if it has multiple requests. Sorted with the above `compareCommandByTimeout`.
-    set<BedrockCommand*, compareCommandByTimeout> _outstandingHTTPSCommands;
+    // copy of each command, even if it has multiple requests.
+    set<BedrockCommand*> _outstandingHTTPSCommands;
+
+    // The timeouts of the commands in `_outstandingHTTPSCommands`. As they expire, the commands are moved to
+    // `_timedOutHTTPSCommands`, and their transactions are timed out each time we poll, until they finish.
+    STimerWheel<BedrockCommand*> _httpsCommandTimeouts;
+    set<BedrockCommand*> _timedOutHTTPSCommands;
 
     // Takes a command that has an outstanding HTTPS request and saves it in _outstandingHTTPSCommands until its HTTPS
     // requests are complete.
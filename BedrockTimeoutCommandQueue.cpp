@@ -1,58 +1,61 @@
 #include <BedrockTimeoutCommandQueue.h>
 
+BedrockTimeoutCommandQueue::BedrockTimeoutCommandQueue() : _timedOutEnd(_queue.end()) {
+}
+
 const unique_ptr<BedrockCommand>& BedrockTimeoutCommandQueue::front() const {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     if (_queue.empty()) {
         throw out_of_range("No commands");
     }
 
-    // has anything timed out?
-    if (_timeoutMap.begin()->first < STimeNow()) {
-        // first item has timed out, that's the effective front.
-        return *(_timeoutMap.begin()->second);
-    }
+    // Anything that's timed out is at the front, so that's the effective front.
+    _promoteTimedOut();
     return _queue.front();
 }
 
 void BedrockTimeoutCommandQueue::push(unique_ptr<BedrockCommand>&& rhs) {
-    lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    // Start the clock while we still own the command. Its timeout is tracked when it's drained onto the queue.
+    rhs->startTiming(BedrockCommand::QUEUE_SYNC);
+    SSynchronizedQueue<unique_ptr<BedrockCommand>>::push(move(rhs));
+}
 
-    // Add to the queue and timeout map.
-    _queue.push_back(move(rhs));
-    _queue.back()->startTiming(BedrockCommand::QUEUE_SYNC);
+void BedrockTimeoutCommandQueue::_itemQueued(list<unique_ptr<BedrockCommand>>::iterator it) const {
+    (*it)->timeoutHandle = _timeouts.add((*it)->timeout(), it);
 
-    // This is past-the-end, so we decrement it to point to the last element.
-    auto lastIt = _queue.end();
-    lastIt--;
-    _timeoutMap.insert(make_pair((*lastIt)->timeout(), lastIt));
+    // If nothing was queued that hadn't timed out, this is now the first command that hasn't.
+    if (_timedOutEnd == _queue.end()) {
+        _timedOutEnd = it;
+    }
+}
 
-    // Write arbitrary buffer to the pipe so any subscribers will be awoken.
-    // **NOTE: 1 byte so write is atomic.
-    SASSERT(write(_pipeFD[1], "A", 1));
+void BedrockTimeoutCommandQueue::_promoteTimedOut() const {
+    _timeouts.expire(STimeNow(), [this](list<unique_ptr<BedrockCommand>>::iterator& it) {
+        (*it)->timeoutHandle = 0;
+        if (it == _timedOutEnd) {
+            // It's already in the right place.
+            _timedOutEnd++;
+        } else {
+            _queue.splice(_timedOutEnd, _queue, it);
+        }
+    });
 }
 
 unique_ptr<BedrockCommand> BedrockTimeoutCommandQueue::pop() {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     if (_queue.empty()) {
         throw out_of_range("No commands");
     }
-    if (_timeoutMap.begin()->first < STimeNow()) {
-        unique_ptr<BedrockCommand> item = move(*(_timeoutMap.begin()->second));
-        _queue.erase(_timeoutMap.begin()->second);
-        _timeoutMap.erase(_timeoutMap.begin());
-        item->stopTiming(BedrockCommand::QUEUE_SYNC);
-        return item;
-    }
+    _promoteTimedOut();
 
-    // We need to remove the reference in the timeout map for this item as well.
+    // If this command hasn't timed out, we need to remove it from the timeouts as well.
     auto firstCommandIt = _queue.begin();
-    auto itPair = _timeoutMap.equal_range((*firstCommandIt)->timeout());
-    for (auto it = itPair.first; it != itPair.second; it++) {
-        if (it->second == firstCommandIt) {
-            // This one points at this command, remove it.
-            _timeoutMap.erase(it);
-            break;
-        }
+    if (firstCommandIt == _timedOutEnd) {
+        _timeouts.cancel((*firstCommandIt)->timeoutHandle);
+        (*firstCommandIt)->timeoutHandle = 0;
+        _timedOutEnd++;
     }
     unique_ptr<BedrockCommand> item = move(*firstCommandIt);
     item->stopTiming(BedrockCommand::QUEUE_SYNC);
@@ -3,13 +3,28 @@
 
 class BedrockTimeoutCommandQueue : public SSynchronizedQueue<unique_ptr<BedrockCommand>> {
   public:
+    BedrockTimeoutCommandQueue();
+
     // Override the base class to account for timeouts.
     const unique_ptr<BedrockCommand>& front() const;
     void push(unique_ptr<BedrockCommand>&& rhs);
     unique_ptr<BedrockCommand> pop();
 
+  protected:
+    // Tracks each command's timeout as it's moved onto the queue.
+    void _itemQueued(list<unique_ptr<BedrockCommand>>::iterator it) const;
+
   private:
-    // Map of timeouts to commands in the queue. Because the queue is a std::list, we can store iterators into it and
-    // they stay valid as we manipulate the list, avoiding walking the list to re-locate them.
-    multimap<uint64_t, list<unique_ptr<BedrockCommand>>::iterator> _timeoutMap;
+    // Moves any commands that have timed out to the front of the queue, after any that already have. Call with
+    // `_queueMutex` held.
+    void _promoteTimedOut() const;
+
+    // The timeouts of the commands in the queue. Because the queue is a std::list, we can store iterators into it and
+    // they stay valid as we manipulate the list, avoiding walking the list to re-locate them. These are only touched
+    // with `_queueMutex` held, and are mutable for the same reason `_queue` is.
+    mutable STimerWheel<list<unique_ptr<BedrockCommand>>::iterator> _timeouts;
+
+    // Commands that have timed out are moved to the front of the queue, in the order they timed out. This points at
+    // the first command that hasn't (or is `_queue.end()`).
+    mutable list<unique_ptr<BedrockCommand>>::iterator _timedOutEnd;
 };
@@ -18,7 +18,20 @@ string& SData::operator[](const string& name) {
 }
 
 const string& SData::operator[](const string& name) const {
-    STable::const_iterator it = nameValueMap.find(name);
+    auto it = nameValueMap.find(name);
+    if (it == nameValueMap.end()) {
+        return placeholder;
+    } else {
+        return it->second;
+    }
+}
+
+string& SData::operator[](const SHeaderTable::Key& key) {
+    return nameValueMap[key];
+}
+
+const string& SData::operator[](const SHeaderTable::Key& key) const {
+    auto it = nameValueMap.find(key);
     if (it == nameValueMap.end()) {
         return placeholder;
     } else {
@@ -42,7 +55,7 @@ void SData::merge(const STable& table) {
 
 void SData::merge(const SData& rhs) {
     // **FIXME: What do we do with the content?  Where do we use this?
-    merge(rhs.nameValueMap);
+    nameValueMap.insert(rhs.nameValueMap.begin(), rhs.nameValueMap.end());
 }
 
 bool SData::empty() const {
@@ -50,7 +63,11 @@ bool SData::empty() const {
 }
 
 bool SData::isSet(const string& name) const {
-    return SContains(nameValueMap, name);
+    return nameValueMap.find(name) != nameValueMap.end();
+}
+
+bool SData::isSet(const SHeaderTable::Key& key) const {
+    return nameValueMap.find(key) != nameValueMap.end();
 }
 
 int SData::calc(const string& name) const {
@@ -58,7 +75,7 @@ int SData::calc(const string& name) const {
 }
 
 int64_t SData::calc64(const string& name) const {
-    STable::const_iterator it = nameValueMap.find(name);
+    auto it = nameValueMap.find(name);
     if (it == nameValueMap.end()) {
         return 0;
     } else {
@@ -67,7 +84,16 @@ int64_t SData::calc64(const string& name) const {
 }
 
 uint64_t SData::calcU64(const string& name) const {
-    STable::const_iterator it = nameValueMap.find(name);
+    auto it = nameValueMap.find(name);
+    if (it == nameValueMap.end()) {
+        return 0;
+    } else {
+        return strtoull(it->second.c_str(), 0, 10);
+    }
+}
+
+uint64_t SData::calcU64(const SHeaderTable::Key& key) const {
+    auto it = nameValueMap.find(key);
     if (it == nameValueMap.end()) {
         return 0;
     } else {
@@ -7,7 +7,7 @@
 struct SData {
     // Public attributes
     string methodLine;
-    STable nameValueMap;
+    SHeaderTable nameValueMap;
     string content;
 
     // Constructors
@@ -30,6 +30,10 @@ struct SData {
     // This version takes care not to create an entry if none is present
     const string& operator[](const string& name) const;
 
+    // The same, for well-known names, which don't need hashing for each lookup.
+    string& operator[](const SHeaderTable::Key& key);
+    const string& operator[](const SHeaderTable::Key& key) const;
+
     // Two templated versions of `set` are provided. One for arithmetic types, and one for other types (which must be
     // convertible to 'string'). These allow you to do the following:
     // SData.set("count", 7);
@@ -65,6 +69,7 @@ struct SData {
 
     // Returns whether or not a particular value has been set
     bool isSet(const string& name) const;
+    bool isSet(const SHeaderTable::Key& key) const;
 
     // Return as an int value.
     int calc(const string& name) const;
@@ -74,6 +79,7 @@ struct SData {
 
     // Return as an unsigned 64-bit value
     uint64_t calcU64(const string& name) const;
+    uint64_t calcU64(const SHeaderTable::Key& key) const;
 
     // Returns if the value evaluates to true
     bool test(const string& name) const;
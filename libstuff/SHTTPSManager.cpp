@@ -20,6 +20,9 @@ void SHTTPSManager::validate() {
     }
 }
 
+const size_t SStandaloneHTTPSManager::MAX_IDLE_CONNECTIONS_PER_HOST = 8;
+const uint64_t SStandaloneHTTPSManager::IDLE_CONNECTION_TIMEOUT = 30 * STIME_US_PER_S;
+
 SStandaloneHTTPSManager::SStandaloneHTTPSManager()
 {
 }
@@ -41,6 +44,14 @@ SStandaloneHTTPSManager::~SStandaloneHTTPSManager() {
     while (!_completedTransactionList.empty()) {
         closeTransaction(_completedTransactionList.front());
     }
+
+    // And any connections that were waiting to be reused.
+    for (auto& hostConnections : _idleConnections) {
+        for (auto& idle : hostConnections.second) {
+            closeSocket(idle.s);
+        }
+    }
+    _idleConnections.clear();
 }
 
 void SStandaloneHTTPSManager::closeTransaction(Transaction* transaction) {
@@ -53,12 +64,119 @@ void SStandaloneHTTPSManager::closeTransaction(Transaction* transaction) {
     _activeTransactionList.remove(transaction);
     _completedTransactionList.remove(transaction);
     if (transaction->s) {
-        closeSocket(transaction->s);
+        // If the connection is still good, hand it back to the pool for the next request to this host, as long as
+        // there's room.
+        Socket* s = transaction->s;
+        bool pooled = false;
+        if (transaction->keepAlive && s->state.load() == Socket::CONNECTED && s->recvBuffer.empty() && s->sendBufferEmpty()) {
+            auto& pool = _idleConnections[(transaction->https ? "https://" : "http://") + transaction->connectionHost];
+            if (pool.size() < MAX_IDLE_CONNECTIONS_PER_HOST) {
+                pool.push_back({s, STimeNow()});
+                pooled = true;
+            }
+        }
+        if (!pooled) {
+            closeSocket(s);
+        }
     }
     transaction->s = nullptr;
     delete transaction;
 }
 
+bool SStandaloneHTTPSManager::canReuseConnection(const SData& request, const SData& response) {
+    // If either side asked to close, we close.
+    if (SContains(SToLower(request["Connection"]), "close") || SContains(SToLower(response["Connection"]), "close")) {
+        return false;
+    }
+
+    // HTTP/1.1 is persistent by default, HTTP/1.0 only if the server explicitly says so. Anything else we don't know
+    // enough about to reuse.
+    if (SStartsWith(response.methodLine, "HTTP/1.0")) {
+        if (!SIEquals(response["Connection"], "keep-alive")) {
+            return false;
+        }
+    } else if (!SStartsWith(response.methodLine, "HTTP/1.1")) {
+        return false;
+    }
+
+    // Without a length or chunked encoding, the end of the response is marked by the server closing the connection.
+    return response.isSet("Content-Length") || SIEquals(response["Transfer-Encoding"], "chunked");
+}
+
+bool SStandaloneHTTPSManager::canRetryRequest(const SData& request) {
+    static const set<string, STableComp> idempotentMethods = {"GET", "HEAD", "PUT", "DELETE", "OPTIONS"};
+    return idempotentMethods.count(request.getVerb());
+}
+
+size_t SStandaloneHTTPSManager::idleConnectionCount() {
+    SAUTOLOCK(_listMutex);
+    size_t count = 0;
+    for (auto& hostConnections : _idleConnections) {
+        count += hostConnections.second.size();
+    }
+    return count;
+}
+
+SStandaloneHTTPSManager::Socket* SStandaloneHTTPSManager::_getConnection(const string& host, bool https, bool& reused, bool allowReuse) {
+    SAUTOLOCK(_listMutex);
+    reused = false;
+    if (allowReuse) {
+        auto poolIt = _idleConnections.find((https ? "https://" : "http://") + host);
+        if (poolIt != _idleConnections.end()) {
+            // Take the most recently used connection, it's the least likely to have been closed by the server. Anything
+            // that fails the health check is discarded.
+            uint64_t now = STimeNow();
+            auto& pool = poolIt->second;
+            while (!pool.empty()) {
+                IdleConnection idle = pool.back();
+                pool.pop_back();
+                if (idle.s->state.load() == Socket::CONNECTED && idle.s->recvBuffer.empty() && idle.s->sendBufferEmpty()
+                    && now < idle.idleSince + IDLE_CONNECTION_TIMEOUT) {
+                    reused = true;
+                    return idle.s;
+                }
+                closeSocket(idle.s);
+            }
+        }
+    }
+
+    if (!https) {
+        return openSocket(host);
+    }
+
+    // If this is going to be an https connection, use our shared TLS config, creating it if this is the first one.
+    if (!_sslConfig) {
+        _sslConfig = make_shared<SSSLConfig>(SX509Open(_pem, _srvCrt, _caCrt));
+    }
+    return openSocket(host, _sslConfig);
+}
+
+void SStandaloneHTTPSManager::_pruneIdleConnections() {
+    SAUTOLOCK(_listMutex);
+    uint64_t now = STimeNow();
+    auto poolIt = _idleConnections.begin();
+    while (poolIt != _idleConnections.end()) {
+        auto& pool = poolIt->second;
+        auto it = pool.begin();
+        while (it != pool.end()) {
+            // An idle connection shouldn't have anything to read. If it does, or the server closed it, or it's just been
+            // sitting around too long, get rid of it.
+            if (it->s->state.load() != Socket::CONNECTED || !it->s->recvBuffer.empty()
+                || now >= it->idleSince + IDLE_CONNECTION_TIMEOUT) {
+                closeSocket(it->s);
+                it = pool.erase(it);
+            } else {
+                it++;
+            }
+        }
+        if (pool.empty()) {
+            poolIt = _idleConnections.erase(poolIt);
+        } else {
+            poolIt++;
+        }
+    }
+}
+
 int SStandaloneHTTPSManager::getHTTPResponseCode(const string& methodLine) {
     // This code looks for the first space in the methodLine, and then for the first non-space
     // after that, and *then* parses the response code. If we fail to find such a code, or can't parse it as an
@@ -81,6 +199,11 @@ SStandaloneHTTPSManager::Socket* SStandaloneHTTPSManager::openSocket(const strin
     return STCPManager::openSocket(host, x509, &_listMutex);
 }
 
+SStandaloneHTTPSManager::Socket* SStandaloneHTTPSManager::openSocket(const string& host, const shared_ptr<SSSLConfig>& sslConfig) {
+    // Just call the base class function but in a thread-safe way.
+    return STCPManager::openSocket(host, sslConfig, &_listMutex);
+}
+
 void SStandaloneHTTPSManager::closeSocket(Socket* socket) {
     // Just call the base class function but in a thread-safe way.
     SAUTOLOCK(_listMutex);
@@ -110,6 +233,9 @@ void SStandaloneHTTPSManager::postPoll(fd_map& fdm, uint64_t& nextActivity, list
     // Let the base class do its thing
     STCPManager::postPoll(fdm);
 
+    // Clean up any pooled connections that are no longer usable.
+    _pruneIdleConnections();
+
     // Update each of the active requests
     uint64_t timeout = timeoutMS * 1000;
     list<Transaction*>::iterator nextIt = _activeTransactionList.begin();
@@ -133,6 +259,10 @@ void SStandaloneHTTPSManager::postPoll(fd_map& fdm, uint64_t& nextActivity, list
             // Consume how much we read.
             active->s->recvBuffer.consumeFront(size);
 
+            // Note whether this connection can go back into the pool. Anything left over in the buffer means the server
+            // sent more than we asked for, so we don't trust the connection.
+            active->keepAlive = canReuseConnection(active->fullRequest, active->fullResponse) && active->s->recvBuffer.empty();
+
             // 200OK or any content?
             active->finished = now;
             if (SContains(active->fullResponse.methodLine, " 200 ") || active->fullResponse.content.size()) {
@@ -147,6 +277,23 @@ void SStandaloneHTTPSManager::postPoll(fd_map& fdm, uint64_t& nextActivity, list
                 SWARN("Message failed: '" << active->fullResponse.methodLine << "'");
                 active->response = 500;
             }
+        } else if (active->reusedSocket && active->s->state.load() > Socket::CONNECTED && active->s->recvBuffer.empty()
+                   && !(elapsed > timeout || specificallyTimedOut) && canRetryRequest(active->fullRequest)) {
+            // We reused an idle connection and the server closed it without responding, probably because it timed it
+            // out just as we sent. Most likely the request never got processed, but the server could also have processed
+            // it and closed before answering, so we only try it again on a new connection if doing it twice is safe.
+            SINFO("Pooled connection to '" << active->connectionHost << "' closed before responding, retrying on a new connection.");
+            closeSocket(active->s);
+            bool reused;
+            active->s = _getConnection(active->connectionHost, active->https, reused, false);
+            active->reusedSocket = false;
+            if (active->s) {
+                active->s->send(active->fullRequest.serialize());
+                nextActivity = min(nextActivity, timeoutFromTime + timeout);
+            } else {
+                SWARN("Couldn't reopen connection to '" << active->connectionHost << "'.");
+                active->response = 503;
+            }
         } else if (active->s->state.load() > Socket::CONNECTED || elapsed > timeout || specificallyTimedOut) {
             // Net problem. Did this transaction end in an inconsistent state?
             SWARN("Connection " << (elapsed > timeout ? "timed out" : "died prematurely") << " after " << elapsed / 1000 << "ms");
@@ -179,7 +326,10 @@ SStandaloneHTTPSManager::Transaction::Transaction(SStandaloneHTTPSManager& manag
     response(0),
     manager(manager_),
     isDelayedSend(0),
-    sentTime(0)
+    sentTime(0),
+    https(false),
+    reusedSocket(false),
+    keepAlive(false)
 {
     manager.validate();
 }
@@ -214,9 +364,10 @@ SStandaloneHTTPSManager::Transaction* SStandaloneHTTPSManager::_httpsSend(const
     // Create a new transaction. This can throw if `validate` fails. We explicitly do this *before* creating a socket.
     Transaction* transaction = new Transaction(*this);
 
-    // If this is going to be an https transaction, create a certificate and give it to the socket.
-    SX509* x509 = SStartsWith(url, "https://") ? SX509Open(_pem, _srvCrt, _caCrt) : nullptr;
-    Socket* s = openSocket(host, x509);
+    // Reuse a pooled connection to this host if we have one, otherwise open a new one.
+    transaction->connectionHost = host;
+    transaction->https = SStartsWith(url, "https://");
+    Socket* s = _getConnection(host, transaction->https, transaction->reusedSocket);
     if (!s) {
         delete transaction;
         return _createErrorTransaction();
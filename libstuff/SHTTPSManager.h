@@ -21,6 +21,20 @@ class SStandaloneHTTPSManager : public STCPManager {
         SStandaloneHTTPSManager& manager;
         bool isDelayedSend;
         uint64_t sentTime;
+
+        // The host (with port) this transaction's connection goes to, and whether it's TLS. Together these make the
+        // key for the idle connection pool.
+        string connectionHost;
+        bool https;
+
+        // True if `s` was taken from the idle connection pool rather than freshly opened. If a reused connection dies
+        // before we get any response on it (the server probably closed it while it was idle), the request is resent
+        // once on a new connection.
+        bool reusedSocket;
+
+        // Set when a complete response arrives and the connection can be handed back to the pool once this
+        // transaction is closed.
+        bool keepAlive;
     };
 
     // Constructor/Destructor
@@ -37,6 +51,7 @@ class SStandaloneHTTPSManager : public STCPManager {
     // Default timeout for HTTPS requests is 5 minutes.This can be changed on any call to postPoll.
     void postPoll(fd_map& fdm, uint64_t& nextActivity, list<Transaction*>& completedRequests, map<Transaction*, uint64_t>& transactionTimeouts, uint64_t timeoutMS = (5 * 60 * 1000));
     Socket* openSocket(const string& host, SX509* x509 = nullptr);
+    Socket* openSocket(const string& host, const shared_ptr<SSSLConfig>& sslConfig);
     void closeSocket(Socket* socket);
 
     // Close a transaction and remove it from our internal lists.
@@ -44,6 +59,21 @@ class SStandaloneHTTPSManager : public STCPManager {
 
     static int getHTTPResponseCode(const string& methodLine);
 
+    // Returns true if, after this request and response, the connection they went over can be used for another request.
+    static bool canReuseConnection(const SData& request, const SData& response);
+
+    // Returns true if this request is idempotent, and so is safe to send again if we can't tell whether the server got
+    // it the first time.
+    static bool canRetryRequest(const SData& request);
+
+    // Returns the number of idle keep-alive connections currently pooled, across all hosts.
+    size_t idleConnectionCount();
+
+    // Limits for the idle connection pool. Connections beyond the per-host limit are closed rather than pooled, and
+    // pooled connections are closed if they sit unused for longer than the idle timeout.
+    static const size_t MAX_IDLE_CONNECTIONS_PER_HOST;
+    static const uint64_t IDLE_CONNECTION_TIMEOUT;
+
     virtual void validate() {
         // The constructor for a transaction needs to call this on it's manager. It can then throw in cases where this
         // manager should not be allowed to create transactions. This lets us have different validation behavior for
@@ -66,6 +96,25 @@ class SStandaloneHTTPSManager : public STCPManager {
     list<Transaction*> _activeTransactionList;
     list<Transaction*> _completedTransactionList;
 
+    // Returns a connection to `host`, reusing an idle pooled one if there's a healthy one available (in which case
+    // `reused` is set) and opening a new one otherwise. Returns nullptr if a new connection couldn't be opened.
+    Socket* _getConnection(const string& host, bool https, bool& reused, bool allowReuse = true);
+
+    // Closes any pooled connections that have timed out, been closed by the other end, or received unexpected data.
+    void _pruneIdleConnections();
+
+    // Idle keep-alive connections, keyed by scheme and host. Each list is in the order connections were returned to
+    // it, so the back is the most recently used, and the front is the first to time out.
+    struct IdleConnection {
+        Socket* s;
+        uint64_t idleSince;
+    };
+    map<string, list<IdleConnection>> _idleConnections;
+
+    // TLS configuration shared by all of this manager's HTTPS connections, created the first time we need it. This
+    // also holds the session cache that lets repeat connections to a host skip the full handshake.
+    shared_ptr<SSSLConfig> _sslConfig;
+
     // SStandaloneHTTPSManager operations are thread-safe, we lock around any accesses to our transaction lists, so that
     // multiple threads can add/remove from them.
     recursive_mutex _listMutex;
@@ -0,0 +1,104 @@
+#include "libstuff.h"
+
+const SHeaderTable::Key SHeaderTable::COMMIT_COUNT("CommitCount");
+const SHeaderTable::Key SHeaderTable::COMMAND_EXECUTE_TIME("commandExecuteTime");
+const SHeaderTable::Key SHeaderTable::CONNECTION("Connection");
+const SHeaderTable::Key SHeaderTable::CONTENT_LENGTH("Content-Length");
+const SHeaderTable::Key SHeaderTable::HASH("Hash");
+const SHeaderTable::Key SHeaderTable::ID("ID");
+const SHeaderTable::Key SHeaderTable::PRIORITY("priority");
+const SHeaderTable::Key SHeaderTable::TIMEOUT("timeout");
+
+SHeaderTable::SHeaderTable(const STable& table) {
+    *this = table;
+}
+
+SHeaderTable& SHeaderTable::operator=(const STable& table) {
+    // An STable's names are already unique, so there's no need to check for duplicates.
+    clear();
+    _entries.reserve(table.size());
+    _hashes.reserve(table.size());
+    for (const auto& item : table) {
+        _entries.emplace_back(item.first, item.second);
+        _hashes.push_back(hash(item.first.data(), item.first.size()));
+    }
+    return *this;
+}
+
+SHeaderTable::operator STable() const {
+    return STable(_entries.begin(), _entries.end());
+}
+
+size_t SHeaderTable::_find(const char* name, size_t length, uint32_t nameHash) const {
+    for (size_t i = 0; i < _hashes.size(); i++) {
+        if (_hashes[i] == nameHash) {
+            const string& candidate = _entries[i].first;
+            if (candidate.size() == length &&
+                equal(candidate.begin(), candidate.end(), name, [](unsigned char a, unsigned char b) {
+                    return tolower(a) == tolower(b);
+                })) {
+                return i;
+            }
+        }
+    }
+    return _entries.size();
+}
+
+SString& SHeaderTable::at(const string& name) {
+    auto it = find(name);
+    if (it == end()) {
+        throw out_of_range("SHeaderTable::at");
+    }
+    return it->second;
+}
+
+const SString& SHeaderTable::at(const string& name) const {
+    auto it = find(name);
+    if (it == end()) {
+        throw out_of_range("SHeaderTable::at");
+    }
+    return it->second;
+}
+
+SString& SHeaderTable::_findOrAdd(const string& name, uint32_t nameHash) {
+    size_t index = _find(name.data(), name.size(), nameHash);
+    if (index == _entries.size()) {
+        _entries.emplace_back(name, SString());
+        _hashes.push_back(nameHash);
+    }
+    return _entries[index].second;
+}
+
+size_t SHeaderTable::erase(const string& name) {
+    auto it = find(name);
+    if (it == end()) {
+        return 0;
+    }
+    erase(it);
+    return 1;
+}
+
+SHeaderTable::iterator SHeaderTable::erase(const_iterator position) {
+    // There are only ever a handful of headers, so shifting the rest down is cheap.
+    size_t index = position - _entries.cbegin();
+    _hashes.erase(_hashes.begin() + index);
+    return _entries.erase(_entries.begin() + index);
+}
+
+void SHeaderTable::clear() {
+    _entries.clear();
+    _hashes.clear();
+}
+
+bool SHeaderTable::operator==(const SHeaderTable& other) const {
+    if (size() != other.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < _entries.size(); i++) {
+        size_t index = other._find(_entries[i].first.data(), _entries[i].first.size(), _hashes[i]);
+        if (index == other.size() || other._entries[index].second != _entries[i].second) {
+            return false;
+        }
+    }
+    return true;
+}
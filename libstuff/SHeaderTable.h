@@ -0,0 +1,132 @@
+#pragma once
+
+// --------------------------------------------------------------------------
+// A small, flat name/value table with case-insensitive name matching. This is what `SData` keeps its headers in.
+// --------------------------------------------------------------------------
+// It supports the parts of the `STable` (std::map) interface that get used on headers, but it's stored as a vector of
+// entries, each with a cached case-insensitive hash of its name. A lookup hashes the name once and scans a handful of
+// integers, rather than doing a case-insensitive string compare at every level of a tree, and a message's headers
+// live in one allocation rather than one per header.
+//
+// It converts to and from `STable` for anything that needs a real map. Unlike `STable`, it iterates in insertion order.
+// `SComposeHTTP` sorts the names on output, so serialized messages are exactly what they'd be from an `STable`.
+//
+// Lookups are linear, which is the right trade for the dozen or so headers a message normally has. Something with
+// thousands of names should use an `STable`.
+class SHeaderTable {
+  public:
+    typedef pair<string, SString> value_type;
+    typedef vector<value_type>::iterator iterator;
+    typedef vector<value_type>::const_iterator const_iterator;
+
+    // Case-insensitive hash of a header name. Any two names that `STableComp` considers equal hash the same.
+    static uint32_t hash(const char* name, size_t length) {
+        uint32_t value = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            unsigned char c = name[i];
+            value = (value ^ (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c)) * 16777619u;
+        }
+        return value;
+    }
+
+    // A header name with its hash already computed, for names that get looked up over and over. The well-known ones
+    // below are what Bedrock and the cluster check on nearly every message. Entries added with a key get its name,
+    // spelled as it is here.
+    class Key {
+      public:
+        explicit Key(const string& name_) : name(name_), hash(SHeaderTable::hash(name_.data(), name_.size())) { }
+        const string name;
+        const uint32_t hash;
+    };
+    static const Key COMMIT_COUNT;
+    static const Key COMMAND_EXECUTE_TIME;
+    static const Key CONNECTION;
+    static const Key CONTENT_LENGTH;
+    static const Key HASH;
+    static const Key ID;
+    static const Key PRIORITY;
+    static const Key TIMEOUT;
+
+    // Construct/convert.
+    SHeaderTable() { }
+    SHeaderTable(const STable& table);
+    SHeaderTable& operator=(const STable& table);
+    operator STable() const;
+
+    // Iteration, in insertion order.
+    iterator begin() { return _entries.begin(); }
+    iterator end() { return _entries.end(); }
+    const_iterator begin() const { return _entries.begin(); }
+    const_iterator end() const { return _entries.end(); }
+
+    // Capacity.
+    bool empty() const { return _entries.empty(); }
+    size_t size() const { return _entries.size(); }
+
+    // Lookup.
+    iterator find(const string& name) { return _entries.begin() + _find(name.data(), name.size(), hash(name.data(), name.size())); }
+    const_iterator find(const string& name) const { return _entries.begin() + _find(name.data(), name.size(), hash(name.data(), name.size())); }
+    iterator find(const Key& key) { return _entries.begin() + _find(key.name.data(), key.name.size(), key.hash); }
+    const_iterator find(const Key& key) const { return _entries.begin() + _find(key.name.data(), key.name.size(), key.hash); }
+    size_t count(const string& name) const { return find(name) != end(); }
+    SString& at(const string& name);
+    const SString& at(const string& name) const;
+
+    // Returns the value for `name`, adding an empty one if there isn't one already.
+    SString& operator[](const string& name) { return _findOrAdd(name, hash(name.data(), name.size())); }
+    SString& operator[](const Key& key) { return _findOrAdd(key.name, key.hash); }
+
+    // Adds a value if there isn't one for its name already (otherwise, does nothing). Returns where the name is, and
+    // whether anything was added.
+    template <typename K, typename V>
+    pair<iterator, bool> emplace(K&& name, V&& value);
+    template <typename K, typename V>
+    pair<iterator, bool> emplace(const pair<K, V>& item) { return emplace(item.first, item.second); }
+    template <typename K, typename V>
+    pair<iterator, bool> emplace(pair<K, V>&& item) { return emplace(move(item.first), move(item.second)); }
+    template <typename K, typename V>
+    pair<iterator, bool> insert(const pair<K, V>& item) { return emplace(item.first, item.second); }
+    template <typename K, typename V>
+    pair<iterator, bool> insert(pair<K, V>&& item) { return emplace(move(item.first), move(item.second)); }
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        for (; first != last; ++first) {
+            emplace(first->first, first->second);
+        }
+    }
+
+    // Removal. The entries after the erased one keep their order, and, like `std::vector`, iterators to them are
+    // invalidated, but the returned one is where the next entry is now, so `it = erase(it)` loops work as they do on an
+    // `STable`.
+    size_t erase(const string& name);
+    iterator erase(const_iterator position);
+    void clear();
+
+    // Equal if they have the same names (ignoring case) with the same values, in any order.
+    bool operator==(const SHeaderTable& other) const;
+    bool operator!=(const SHeaderTable& other) const { return !(*this == other); }
+
+  private:
+    // Returns the index of the entry with this name, or `size()` if there isn't one.
+    size_t _find(const char* name, size_t length, uint32_t nameHash) const;
+
+    // Returns the value for `name`, which hashes to `nameHash`, adding an empty one if there isn't one already.
+    SString& _findOrAdd(const string& name, uint32_t nameHash);
+
+    vector<value_type> _entries;
+    vector<uint32_t> _hashes;
+};
+
+template <typename K, typename V>
+pair<SHeaderTable::iterator, bool> SHeaderTable::emplace(K&& name, V&& value) {
+    const string& nameRef = name;
+    uint32_t nameHash = hash(nameRef.data(), nameRef.size());
+    size_t index = _find(nameRef.data(), nameRef.size(), nameHash);
+    if (index != _entries.size()) {
+        return make_pair(_entries.begin() + index, false);
+    }
+    _entries.emplace_back(forward<K>(name), SString());
+    _entries.back().second = forward<V>(value);
+    _hashes.push_back(nameHash);
+    return make_pair(_entries.end() - 1, true);
+}
@@ -13,3 +13,265 @@ void SLogStackTrace() {
         SWARN(frame);
     }
 }
+
+// --------------------------------------------------------------------------
+// Asynchronous logging
+// --------------------------------------------------------------------------
+// Each thread that logs while async logging is enabled gets its own single-producer, single-consumer ring of log lines.
+// The thread writing the log is the only producer, and whoever holds `_SLogDrainMutex` (normally the logging thread) is
+// the only consumer, so neither side ever needs a lock to add or remove a line.
+struct SLogLine {
+    int priority;
+    uint64_t time;
+    string line;
+};
+
+class SLogRing {
+  public:
+    static const size_t CAPACITY = 1024;
+
+    // Producer side. Returns false without taking `line` if the ring is full.
+    bool push(int priority, string&& line) {
+        size_t tail = _tail.load(memory_order_relaxed);
+        if (tail - _head.load(memory_order_acquire) >= CAPACITY) {
+            return false;
+        }
+        SLogLine& slot = _slots[tail % CAPACITY];
+        slot.priority = priority;
+        slot.time = STimeNow();
+        slot.line = move(line);
+        _tail.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(SLogLine& out) {
+        size_t head = _head.load(memory_order_relaxed);
+        if (head == _tail.load(memory_order_acquire)) {
+            return false;
+        }
+        out = move(_slots[head % CAPACITY]);
+        _head.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    bool empty() {
+        return _head.load(memory_order_acquire) == _tail.load(memory_order_acquire);
+    }
+
+    // Set when the owning thread exits. Once an orphaned ring is empty, it can be discarded.
+    atomic<bool> orphaned{false};
+
+  private:
+    array<SLogLine, CAPACITY> _slots;
+    atomic<size_t> _head{0};
+    atomic<size_t> _tail{0};
+};
+
+// Owns the calling thread's ring, and marks it orphaned when the thread exits.
+struct SLogThreadRing {
+    ~SLogThreadRing() {
+        if (ring) {
+            ring->orphaned = true;
+        }
+    }
+    shared_ptr<SLogRing> ring;
+};
+static thread_local SLogThreadRing _SLogThreadRing;
+
+// These are all allocated once and never freed, so that threads that log during static destruction (or the logging
+// thread itself, if the process exits without calling SLogStopAsync) never see them destroyed.
+static atomic<bool> _SLogAsync(false);
+static mutex& _SLogRingListMutex = *new mutex;
+static list<shared_ptr<SLogRing>>& _SLogRingList = *new list<shared_ptr<SLogRing>>;
+static timed_mutex& _SLogDrainMutex = *new timed_mutex;
+static mutex& _SLogStartStopMutex = *new mutex;
+static thread* _SLogThread = nullptr;
+static atomic<bool> _SLogThreadExit(false);
+static atomic<uint64_t> _SLogDropped(0);
+
+// Output file, if we're logging to a file instead of syslog.
+static atomic<bool> _SLogToFile(false);
+static mutex& _SLogFileMutex = *new mutex;
+static FILE* _SLogFile = nullptr;
+
+// Writes a line to its final destination.
+static void _SLogOutput(int priority, const string& line, uint64_t time) {
+    if (_SLogToFile.load()) {
+        lock_guard<mutex> lock(_SLogFileMutex);
+        if (_SLogFile) {
+            char micros[16];
+            snprintf(micros, sizeof(micros), ".%06llu ", (unsigned long long)(time % STIME_US_PER_S));
+            fputs((SComposeTime("%Y-%m-%dT%H:%M:%S", time) + micros).c_str(), _SLogFile);
+            fputs(line.c_str(), _SLogFile);
+            if (line.empty() || line.back() != '\n') {
+                fputc('\n', _SLogFile);
+            }
+
+            // The logging thread flushes after each batch; without it, we flush every line.
+            if (!_SLogAsync.load(memory_order_acquire)) {
+                fflush(_SLogFile);
+            }
+            return;
+        }
+    }
+    syslog(priority, "%s", line.c_str());
+}
+
+// Writes out everything currently queued. The caller must hold `_SLogDrainMutex`. Returns the number of lines written.
+static size_t _SLogDrain() {
+    // Take a copy of the ring list so we don't hold the lock while writing, and clean up any rings whose threads have
+    // exited and which we've emptied.
+    list<shared_ptr<SLogRing>> rings;
+    {
+        lock_guard<mutex> lock(_SLogRingListMutex);
+        for (auto it = _SLogRingList.begin(); it != _SLogRingList.end();) {
+            if ((*it)->orphaned.load() && (*it)->empty()) {
+                it = _SLogRingList.erase(it);
+            } else {
+                rings.push_back(*it);
+                it++;
+            }
+        }
+    }
+
+    size_t count = 0;
+    SLogLine line;
+    for (auto& ring : rings) {
+        while (ring->pop(line)) {
+            _SLogOutput(line.priority, line.line, line.time);
+            count++;
+        }
+    }
+
+    // Let whoever's reading the logs know that there's a gap.
+    uint64_t dropped = _SLogDropped.exchange(0);
+    if (dropped) {
+        _SLogOutput(LOG_WARNING, "[warn] Dropped " + to_string(dropped) + " log lines because the log queue was full.",
+                    STimeNow());
+    }
+
+    if (count && _SLogToFile.load()) {
+        lock_guard<mutex> lock(_SLogFileMutex);
+        if (_SLogFile) {
+            fflush(_SLogFile);
+        }
+    }
+    return count;
+}
+
+void SLogWrite(int priority, string&& line) {
+    if (_SLogAsync.load(memory_order_acquire)) {
+        if (!_SLogThreadRing.ring) {
+            _SLogThreadRing.ring = make_shared<SLogRing>();
+            lock_guard<mutex> lock(_SLogRingListMutex);
+            _SLogRingList.push_back(_SLogThreadRing.ring);
+        }
+        if (_SLogThreadRing.ring->push(priority, move(line))) {
+            return;
+        }
+
+        // The ring is full, the logging thread isn't keeping up. Rather than block, we drop anything less important
+        // than a warning (and report how many we dropped). Warnings and worse are never dropped; those we write
+        // directly from this thread, same as if async logging was off.
+        if (priority > LOG_WARNING) {
+            _SLogDropped++;
+            return;
+        }
+    }
+    _SLogOutput(priority, line, STimeNow());
+}
+
+static void _SLogAtExit() {
+    SLogFlush();
+}
+
+void SLogStartAsync(const string& filename) {
+    lock_guard<mutex> lock(_SLogStartStopMutex);
+    if (_SLogThread) {
+        return;
+    }
+
+    if (!filename.empty()) {
+        SLogOpenFile(filename);
+    }
+
+    // Make sure whatever's queued gets written if the process exits without stopping us.
+    static bool registeredAtExit = false;
+    if (!registeredAtExit) {
+        atexit(_SLogAtExit);
+        registeredAtExit = true;
+    }
+
+    _SLogThreadExit = false;
+    _SLogThread = new thread([]() {
+        SLogSetThreadName("logger");
+        while (!_SLogThreadExit.load()) {
+            size_t count;
+            {
+                lock_guard<timed_mutex> drainLock(_SLogDrainMutex);
+                count = _SLogDrain();
+            }
+            if (!count) {
+                // Nothing to do, check again shortly. We poll rather than have loggers signal us so that logging
+                // never has to touch a lock.
+                this_thread::sleep_for(chrono::milliseconds(5));
+            }
+        }
+    });
+    _SLogAsync.store(true, memory_order_release);
+}
+
+void SLogStopAsync() {
+    lock_guard<mutex> lock(_SLogStartStopMutex);
+    if (!_SLogThread) {
+        return;
+    }
+
+    // Stop queuing, then stop the thread and write out whatever it didn't get to.
+    _SLogAsync.store(false, memory_order_release);
+    _SLogThreadExit = true;
+    _SLogThread->join();
+    delete _SLogThread;
+    _SLogThread = nullptr;
+    SLogFlush();
+
+    // Go back to syslog.
+    SLogCloseFile();
+}
+
+bool SLogOpenFile(const string& filename) {
+    FILE* file = fopen(filename.c_str(), "a");
+    if (!file) {
+        SWARN("Couldn't open log file '" << filename << "', logging to syslog instead.");
+        return false;
+    }
+    lock_guard<mutex> lock(_SLogFileMutex);
+    if (_SLogFile) {
+        fclose(_SLogFile);
+    }
+    _SLogFile = file;
+    _SLogToFile = true;
+    return true;
+}
+
+void SLogCloseFile() {
+    lock_guard<mutex> lock(_SLogFileMutex);
+    _SLogToFile = false;
+    if (_SLogFile) {
+        fclose(_SLogFile);
+        _SLogFile = nullptr;
+    }
+}
+
+void SLogFlush() {
+    // We don't wait forever for the lock, as this is called when crashing, possibly by the thread that holds it.
+    if (_SLogDrainMutex.try_lock_for(chrono::seconds(1))) {
+        lock_guard<timed_mutex> lock(_SLogDrainMutex, adopt_lock);
+        _SLogDrain();
+    }
+}
+
+uint64_t SLogDroppedCount() {
+    return _SLogDropped.load();
+}
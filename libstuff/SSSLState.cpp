@@ -2,7 +2,73 @@
 #include <mbedtls/error.h>
 #include <mbedtls/net.h>
 
-SSSLState::SSSLState() {
+const size_t SSSLConfig::MAX_CACHED_SESSIONS = 1000;
+
+SSSLConfig::SSSLConfig(SX509* x509) : _x509(x509) {
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ctr_drbg_init(&_ctr_drbg);
+    mbedtls_entropy_init(&_ec);
+
+    mbedtls_ctr_drbg_seed(&_ctr_drbg, mbedtls_entropy_func, &_ec, 0, 0);
+    mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_rng(&conf, _random, this);
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    if (_x509) {
+        // Add the certificate
+        mbedtls_ssl_conf_ca_chain(&conf, _x509->srvcert.next, 0);
+        SASSERT(mbedtls_ssl_conf_own_cert(&conf, &_x509->srvcert, &_x509->pk) == 0);
+    }
+}
+
+SSSLConfig::~SSSLConfig() {
+    _sessions.clear();
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&_ctr_drbg);
+    mbedtls_entropy_free(&_ec);
+    if (_x509) {
+        SX509Close(_x509);
+    }
+}
+
+int SSSLConfig::_random(void* config, unsigned char* output, size_t length) {
+    SSSLConfig* self = static_cast<SSSLConfig*>(config);
+    lock_guard<mutex> lock(self->_drbgMutex);
+    return mbedtls_ctr_drbg_random(&self->_ctr_drbg, output, length);
+}
+
+void SSSLConfig::saveSession(const string& host, const mbedtls_ssl_context& ssl) {
+    unique_ptr<Session> session(new Session);
+    if (mbedtls_ssl_get_session(&ssl, &session->session)) {
+        // Nothing we can resume.
+        return;
+    }
+    lock_guard<mutex> lock(_sessionMutex);
+    if (_sessions.size() >= MAX_CACHED_SESSIONS && _sessions.find(host) == _sessions.end()) {
+        // We only expect to talk to a handful of hosts. If we somehow have this many, just make room.
+        _sessions.erase(_sessions.begin());
+    }
+    _sessions[host] = move(session);
+}
+
+bool SSSLConfig::loadSession(const string& host, mbedtls_ssl_context& ssl) {
+    lock_guard<mutex> lock(_sessionMutex);
+    auto it = _sessions.find(host);
+    if (it == _sessions.end()) {
+        return false;
+    }
+
+    // This copies the session into `ssl`, so it's fine if it's replaced in the cache after this.
+    return mbedtls_ssl_set_session(&ssl, &it->second->session) == 0;
+}
+
+size_t SSSLConfig::sessionCount() {
+    lock_guard<mutex> lock(_sessionMutex);
+    return _sessions.size();
+}
+
+SSSLState::SSSLState() : sessionSaved(false) {
     mbedtls_ssl_init(&ssl);
     mbedtls_ssl_config_init(&conf);
     mbedtls_ctr_drbg_init(&ctr_drbg);
@@ -40,11 +106,43 @@ SSSLState* SSSLOpen(int s, SX509* x509) {
     return state;
 }
 
+// --------------------------------------------------------------------------
+SSSLState* SSSLOpen(int s, const shared_ptr<SSSLConfig>& config, const string& host) {
+    // Only the per-connection context is set up here, everything expensive is already done in `config`.
+    SASSERT(s >= 0);
+    SASSERT(config);
+    SSSLState* state = new SSSLState;
+    state->s = s;
+    state->sharedConfig = config;
+    state->host = host;
+
+    mbedtls_ssl_setup(&state->ssl, &config->conf);
+    mbedtls_ssl_set_hostname(&state->ssl, SGetDomain(host).c_str());
+    mbedtls_ssl_set_bio(&state->ssl, &state->s, mbedtls_net_send, mbedtls_net_recv, 0);
+
+    // If we've talked to this host before, offer to resume that session.
+    if (config->loadSession(host, state->ssl)) {
+        SDEBUG("Attempting to resume TLS session with '" << host << "'");
+    }
+    return state;
+}
+
+// --------------------------------------------------------------------------
+// Once a connection opened with a shared config finishes its handshake, save its session so the next connection to the
+// same host can resume it.
+static void _SSSLSaveSession(SSSLState* sslState) {
+    if (sslState->sharedConfig && !sslState->sessionSaved && sslState->ssl.state == MBEDTLS_SSL_HANDSHAKE_OVER) {
+        sslState->sharedConfig->saveSession(sslState->host, sslState->ssl);
+        sslState->sessionSaved = true;
+    }
+}
+
 // --------------------------------------------------------------------------
 int SSSLSend(SSSLState* sslState, const char* buffer, int length) {
     // Send as much as possible and report what happened
     SASSERT(sslState && buffer);
     const int numSent = mbedtls_ssl_write(&sslState->ssl, (unsigned char*)buffer, length);
+    _SSSLSaveSession(sslState);
     if (numSent > 0) {
         return numSent;
     }
@@ -70,6 +168,7 @@ int SSSLRecv(SSSLState* sslState, char* buffer, int length) {
     // Receive as much as we can and report what happened
     SASSERT(sslState && buffer);
     const int numRecv = mbedtls_ssl_read(&sslState->ssl, (unsigned char*)buffer, length);
+    _SSSLSaveSession(sslState);
     if (numRecv > 0) {
         return numRecv;
     }
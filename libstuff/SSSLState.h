@@ -4,6 +4,53 @@
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
 
+// Client TLS configuration that can be shared by any number of connections. Seeding a DRBG and building an
+// mbedtls_ssl_config is expensive, so rather than doing it for every socket, it's done once here and each connection
+// only sets up its own mbedtls_ssl_context against it. This also caches the most recent session negotiated with each
+// host, so new connections to a host we've talked to before can do an abbreviated handshake (via session ticket or
+// session ID, whichever the server supports).
+// Once constructed, `conf` is never modified, and the DRBG and session cache are locked internally, so this is safe to
+// use from multiple threads.
+class SSSLConfig {
+  public:
+    // Takes ownership of `x509`, which may be null for connections that don't present a certificate.
+    SSSLConfig(SX509* x509 = nullptr);
+    ~SSSLConfig();
+
+    // Saves the session from a connection that's completed its handshake, for reuse by later connections to `host`.
+    void saveSession(const string& host, const mbedtls_ssl_context& ssl);
+
+    // Sets up `ssl` to try to resume the last session saved for `host`. Returns false if there was none.
+    bool loadSession(const string& host, mbedtls_ssl_context& ssl);
+
+    // Number of hosts we currently have a session saved for.
+    size_t sessionCount();
+
+    // The shared configuration for new connections.
+    mbedtls_ssl_config conf;
+
+    // We never keep sessions for more than this many hosts.
+    static const size_t MAX_CACHED_SESSIONS;
+
+  private:
+    // Random number callback for `conf`. mbedtls's DRBG isn't thread-safe on its own, so this locks around it.
+    static int _random(void* config, unsigned char* output, size_t length);
+
+    mbedtls_entropy_context _ec;
+    mbedtls_ctr_drbg_context _ctr_drbg;
+    mutex _drbgMutex;
+    SX509* _x509;
+
+    // Saved sessions, by host.
+    struct Session {
+        Session() { mbedtls_ssl_session_init(&session); }
+        ~Session() { mbedtls_ssl_session_free(&session); }
+        mbedtls_ssl_session session;
+    };
+    map<string, unique_ptr<Session>> _sessions;
+    mutex _sessionMutex;
+};
+
 struct SSSLState {
     // Attributes
     int s;
@@ -12,12 +59,21 @@ struct SSSLState {
     mbedtls_ssl_config conf;
     mbedtls_ssl_context ssl;
 
+    // If this connection was opened with a shared config, this is it (and `ec`, `ctr_drbg` and `conf` are unused), as
+    // well as the host we'll save the session for once the handshake completes.
+    shared_ptr<SSSLConfig> sharedConfig;
+    string host;
+    bool sessionSaved;
+
     SSSLState();
     ~SSSLState();
 };
 
 // SSL helpers
 extern SSSLState* SSSLOpen(int s, SX509* x509);
+
+// Opens a client connection using a shared configuration. `host` is used for SNI and for session resumption.
+extern SSSLState* SSSLOpen(int s, const shared_ptr<SSSLConfig>& config, const string& host);
 extern int SSSLSend(SSSLState* ssl, const char* buffer, int length);
 extern int SSSLSend(SSSLState* ssl, const SFastBuffer& buffer);
 extern bool SSSLSendConsume(SSSLState* ssl, SFastBuffer& sendBuffer);
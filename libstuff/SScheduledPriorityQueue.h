@@ -10,8 +10,8 @@
 // What counts as the next item:
 //
 // If any item has timed out, it is the timed out item (if multiple items have timed out, it is the one with the oldest
-// timeout timestamp. If multiple items have identical timeout timestamps, which if those items is returned is
-// unspecified).
+// timeout timestamp. Timeouts are tracked to the millisecond, and if multiple items time out in the same millisecond,
+// which of those items is returned is unspecified).
 //
 // If no items have timed out, the items are returned in order of priority, but only if they're scheduled before now.
 //
@@ -65,10 +65,11 @@ class SScheduledPriorityQueue {
     // Associate the item with it's timeout so that when we dequeue an item to return, we can also remove it's entry
     // in our set of timeouts.
     struct ItemTimeoutPair {
-        ItemTimeoutPair(T&& _item, Timeout _timeout) : item(move(_item)), timeout(_timeout) {}
+        ItemTimeoutPair(T&& _item) : item(move(_item)) {}
         T item;
-        Timeout timeout;
+        STimerHandle timeoutHandle = 0;
     };
+    typedef typename multimap<Scheduled, ItemTimeoutPair>::iterator ItemIterator;
 
     // Removes an item from the queue and returns it, if a suitable item is available (see the comment at the top of
     // this file for what counts as a suitable item). Throws `out_of_range` otherwise.
@@ -81,8 +82,12 @@ class SScheduledPriorityQueue {
     // The main queue is a map of priorities to the items queued at that priority, sorted by their scheduled time.
     map<Priority, multimap<Scheduled, ItemTimeoutPair>> _queue;
 
-    // A map of timeouts back into the respective priority queue to find the item with the given timeout.
-    multimap<Timeout, pair<Priority, Scheduled>> _lookupByTimeout;
+    // Every item in `_queue`, by timeout, pointing back at where the item is in `_queue`.
+    STimerWheel<pair<Priority, ItemIterator>> _timeouts;
+
+    // Items that have timed out, in the order they did. These have been taken out of `_queue`, and are returned before
+    // anything else.
+    list<T> _timedOut;
 
     // Functions to call on each item when inserting or removing from the queue.
     function<void(T&)> _startFunction;
@@ -93,18 +98,20 @@ template<typename T>
 void SScheduledPriorityQueue<T>::clear()  {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
     _queue.clear();
+    _timeouts.clear();
+    _timedOut.clear();
 }
 
 template<typename T>
 bool SScheduledPriorityQueue<T>::empty()  {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
-    return _queue.empty();
+    return _queue.empty() && _timedOut.empty();
 }
 
 template<typename T>
 size_t SScheduledPriorityQueue<T>::size()  {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
-    size_t size = 0;
+    size_t size = _timedOut.size();
     for (const auto& queue : _queue) {
         size += queue.second.size();
     }
@@ -169,8 +176,8 @@ void SScheduledPriorityQueue<T>::push(T&& item, Priority priority, Scheduled sch
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
     auto& queue = _queue[priority];
     _startFunction(item);
-    _lookupByTimeout.insert(make_pair(timeout, make_pair(priority, scheduled)));
-    queue.emplace(scheduled, ItemTimeoutPair(move(item), timeout));
+    auto it = queue.emplace(scheduled, ItemTimeoutPair(move(item)));
+    it->second.timeoutHandle = _timeouts.add(timeout, make_pair(priority, it));
     _queueCondition.notify_one();
 }
 
@@ -183,84 +190,46 @@ T SScheduledPriorityQueue<T>::_dequeue() {
     // We need to know what time it is, so that we can compare to scheduled times.
     uint64_t now = STimeNow();
 
-    // If anything has timed out, pull that out of the queue, and return that first.
-    if (_lookupByTimeout.size()) {
-
-        // Get the first item in the timeout map (they're in order).
-        auto timeoutIt = _lookupByTimeout.begin();
-
-        // Convenience names for legibility.
-        const Timeout& itemTimeout = timeoutIt->first;
-        const Priority& itemPriority = timeoutIt->second.first;
-        const Scheduled& itemScheduled = timeoutIt->second.second;
-
-        // Has this timed out? If so, this is the item we'll return (regardless of which priority it had).
-        if (itemTimeout <= now) {
-
-            // Find the correct priority queue for this item.
-            auto priorityQueueIt = _queue.find(itemPriority);
-            if (priorityQueueIt != _queue.end()) {
-
-                // Find all the items in this priority queue scheduled at this particular moment.
-                auto matchingItemIterators = priorityQueueIt->second.equal_range(itemScheduled);
-
-                // Iterate across the matching section of items.
-                for (auto it = matchingItemIterators.first; it != matchingItemIterators.second; it++) {
-
-                    // Convenience names for legibility.
-                    ItemTimeoutPair& thisItemTimeoutPair = it->second;
-
-                    // Is this the one that timed out?
-                    if (thisItemTimeoutPair.timeout == itemTimeout) {
+    // Move anything that's timed out from the main queue to `_timedOut`.
+    _timeouts.expire(now, [this](pair<Priority, ItemIterator>& timedOut) {
+        auto priorityQueueIt = _queue.find(timedOut.first);
+        _timedOut.push_back(move(timedOut.second->second.item));
+        priorityQueueIt->second.erase(timedOut.second);
 
-                        // Yep, this one timed out. Pull it out of the queue.
-                        T item = move(thisItemTimeoutPair.item);
-
-                        // Erase this item from the main queue.
-                        priorityQueueIt->second.erase(it);
-
-                        // If this priority queue is empty, erase the whole thing.
-                        if (priorityQueueIt->second.empty()) {
-                            _queue.erase(priorityQueueIt);
-                        }
-
-                        // And erase it from the timeout map, too.
-                        _lookupByTimeout.erase(timeoutIt);
+        // If this priority queue is empty, erase the whole thing.
+        if (priorityQueueIt->second.empty()) {
+            _queue.erase(priorityQueueIt);
+        }
+    });
 
-                        // Call the end function and return the item.
-                        _endFunction(item);
-                        return item;
-                    }
-                }
-            }
+    // If anything has timed out, return that first (regardless of which priority it had).
+    if (!_timedOut.empty()) {
+        T item = move(_timedOut.front());
+        _timedOut.pop_front();
 
-            // This isn't supposed to be possible.
-            SWARN("Timeout (" << itemTimeout << ") before now, but couldn't find a item for it?");
-            _lookupByTimeout.erase(timeoutIt);
-        }
+        // Call the end function and return the item.
+        _endFunction(item);
+        return item;
     }
 
     // Ok, if we got here nothing has timed out, so we'll just look at each queue, in priority order, to see if any
     // items are ready to return.
     for (auto queueIt = _queue.rbegin(); queueIt != _queue.rend(); ++queueIt) {
 
-        // Record the priority of the queue we're currently looking at.
-        Priority queuePriority = queueIt->first;
-
         // And look at the first item in this particular priority queue.
         auto itemIt = queueIt->second.begin();
 
         // Convenience names for legibility.
         const Scheduled thisItemScheduled = itemIt->first;
         ItemTimeoutPair& thisItemTimeoutPair = itemIt->second;
-        const Timeout thisItemTimeout = thisItemTimeoutPair.timeout;
 
         // If the item is scheduled before now, we can return it. Otherwise, since these are in scheduled order, there
         // are no usable items in this queue, and we can go on to the next one.
         if (thisItemScheduled <= now) {
 
-            // Pull out the item we want to return.
+            // Pull out the item we want to return, and remove it from the timeouts.
             T item = move(thisItemTimeoutPair.item);
+            _timeouts.cancel(thisItemTimeoutPair.timeoutHandle);
 
             // Delete the entry in this queue.
             queueIt->second.erase(itemIt);
@@ -271,23 +240,6 @@ T SScheduledPriorityQueue<T>::_dequeue() {
                 _queue.erase(next(queueIt).base());
             }
 
-            // Remove from the timeout map, as well.
-            auto matchingTimeoutIterators = _lookupByTimeout.equal_range(thisItemTimeout);
-            for (auto it = matchingTimeoutIterators.first; it != matchingTimeoutIterators.second; it++) {
-
-                // Convenience names for legibility.
-                auto& timeoutPair = it->second;
-                Priority& thisTimeoutPriority = timeoutPair.first;
-                Scheduled& thisTimeoutScheduled = timeoutPair.second;
-
-                // If this timeout entry has the same queue that we're in, and the same scheduled time, we can remove
-                // it.
-                if (thisTimeoutPriority == queuePriority && thisTimeoutScheduled == thisItemScheduled) {
-                    _lookupByTimeout.erase(it);
-                    break;
-                }
-            }
-
             // Call the end function and return!
             _endFunction(item);
             return item;
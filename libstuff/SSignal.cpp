@@ -172,6 +172,9 @@ void _SSignal_StackTrace(int signum, siginfo_t *info, void *ucontext) {
             SSignalHandlerDieFunc();
             SSignalHandlerDieFunc = [](){};
             SWARN("DIE function returned, aborting (if not done).");
+
+            // If we're logging asynchronously, make sure all of the above actually gets written before we die.
+            SLogFlush();
         }
 
         // If we weren't already in ABORT, we'll call that. The second call will skip the above callstack generation.
@@ -5,7 +5,7 @@ class SSynchronizedQueue {
   public:
     // Constructor/Destructor
     SSynchronizedQueue();
-    ~SSynchronizedQueue();
+    virtual ~SSynchronizedQueue();
 
     // Explicitly delete copy constructor so it can't accidentally get called.
     SSynchronizedQueue(const SSynchronizedQueue& other) = delete;
@@ -25,7 +25,7 @@ class SSynchronizedQueue {
     // Get an item off the queue.
     virtual T pop();
 
-    // Push an item onto the queue, by move.
+    // Push an item onto the queue, by move. This never blocks on other threads using the queue.
     virtual void push(T&& rhs);
 
     // Returns the queue's size.
@@ -35,77 +35,131 @@ class SSynchronizedQueue {
     void each(const function<void (T&)> f);
 
   protected:
-    list<T> _queue;
+    // Pushes go onto `_pushed`, a lock-free stack, so that pushing threads never wait on each other or on whoever's
+    // reading the queue. Everything that reads the queue takes `_queueMutex` and first calls `_drainPushed` to move
+    // anything new onto the end of `_queue`, in the order it was pushed. Draining only moves items from one list to the
+    // other, so it's allowed from const methods, which is why `_queue` is mutable.
+    mutable list<T> _queue;
     mutable recursive_mutex _queueMutex;
 
-    // You may be wondering why we use a pipe instead of a condition variable
-    // for alerting threads that work is available. That's because we are treating
-    // queue activity like network activity in BedrockServer. This means that we
-    // treat the queue as if it was a network socket and we use the pipe to know
-    // if there are "unread bytes on the socket" that is to say -- work available --
-    // in the queue.
-    // This is kind of weird but prevents threads from waiting for a the poll()
-    // timeout on network activity. Since queue activity also causes poll() to return
-    // if there is work in the queue.
-    int _pipeFD[2] = {-1, -1};
+    // Call with `_queueMutex` held.
+    void _drainPushed() const;
+
+    // Called with `_queueMutex` held for each item as it's moved onto `_queue`, for subclasses that index the queue.
+    virtual void _itemQueued(typename list<T>::iterator it) const { }
+
+    // You may be wondering why we use a file descriptor instead of a condition variable for alerting threads that
+    // work is available. That's because we are treating queue activity like network activity in BedrockServer. This
+    // means that we treat the queue as if it was a network socket and we use the descriptor to know if there are
+    // "unread bytes on the socket" that is to say -- work available -- in the queue.
+    // This is kind of weird but prevents threads from waiting for a the poll() timeout on network activity. Since
+    // queue activity also causes poll() to return if there is work in the queue.
+    // On Linux this is a single eventfd (so both of these are the same descriptor); elsewhere it's a pipe. Either way,
+    // it's only written when a push finds `_pushed` empty, so a burst of pushes costs one write, and `postPoll` clears
+    // it with one read.
+    int _readFD = -1;
+    int _writeFD = -1;
+
+  private:
+    struct PushedItem {
+        T item;
+        PushedItem* next;
+    };
+    mutable atomic<PushedItem*> _pushed{nullptr};
 };
 
 template<typename T>
 SSynchronizedQueue<T>::SSynchronizedQueue() {
-    // Open up a pipe for communication and set the non-blocking reads.
-    SASSERT(0 == pipe(_pipeFD));
-    int flags = fcntl(_pipeFD[0], F_GETFL, 0);
-    fcntl(_pipeFD[0], F_SETFL, flags | O_NONBLOCK);
+#ifdef __linux__
+    _readFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    SASSERT(_readFD != -1);
+    _writeFD = _readFD;
+#else
+    // Open up a pipe for communication and set non-blocking reads and writes. If the pipe's full, a wakeup is already
+    // pending, so there's no need for a write to block.
+    int pipeFD[2];
+    SASSERT(0 == pipe(pipeFD));
+    _readFD = pipeFD[0];
+    _writeFD = pipeFD[1];
+    fcntl(_readFD, F_SETFL, fcntl(_readFD, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(_writeFD, F_SETFL, fcntl(_writeFD, F_GETFL, 0) | O_NONBLOCK);
+#endif
 }
 
 template<typename T>
 SSynchronizedQueue<T>::~SSynchronizedQueue() {
-    if (_pipeFD[0] != -1) {
-        close(_pipeFD[0]);
+    PushedItem* item = _pushed.exchange(nullptr);
+    while (item) {
+        PushedItem* next = item->next;
+        delete item;
+        item = next;
     }
-    if (_pipeFD[1] != -1) {
-        close(_pipeFD[1]);
+    if (_readFD != -1) {
+        close(_readFD);
+    }
+    if (_writeFD != -1 && _writeFD != _readFD) {
+        close(_writeFD);
     }
 }
 
 template<typename T>
 void SSynchronizedQueue<T>::prePoll(fd_map& fdm) {
-    // Put the read-side of the pipe into the fd set.
-    // **NOTE: This is *not* synchronized.  All threads use the same pipes. All threads use *different* fd_maps, though
-    //         so we don't have to worry about contention inside FDSet.
-    SFDset(fdm, _pipeFD[0], SREADEVTS);
+    // Put the read side into the fd set.
+    // **NOTE: This is *not* synchronized.  All threads use the same descriptor. All threads use *different* fd_maps,
+    //         though so we don't have to worry about contention inside FDSet.
+    SFDset(fdm, _readFD, SREADEVTS);
 }
 
 template<typename T>
 void SSynchronizedQueue<T>::postPoll(fd_map& fdm) {
-    // Check if there is anything to read off of the pipe, if there is, empty it.
-    if (SFDAnySet(fdm, _pipeFD[0], SREADEVTS)) {
-        // Read until there is nothing left to read.
-        while (true) {
-            char readbuffer[1];
-            int ret = read(_pipeFD[0], readbuffer, sizeof(readbuffer));
-
-            // Since the pipe is set to non-blocking reads, read() will return -1
-            // when there is no data to read  and will set errno to EAGAIN/EWOULDBLOCK
-            // otherwise it will 0 when we have read it all
-            if (ret <= 0 && errno == EWOULDBLOCK) {
-                break;
-            } else if (ret == -1) {
-                STHROW("Failed to read from pipe");
-            }
+    if (SFDAnySet(fdm, _readFD, SREADEVTS)) {
+        // Clear the wakeup. This has to happen before we drain, so that anything pushed after the drain finds
+        // `_pushed` empty and signals again. An eventfd is cleared by a single read, a pipe only ever has a few bytes.
+        char buffer[64];
+        ssize_t ret;
+        do {
+            ret = read(_readFD, buffer, sizeof(buffer));
+        } while (ret == (ssize_t)sizeof(buffer));
+        if (ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            STHROW("Failed to read from queue descriptor");
         }
+
+        // Now take whatever's been pushed. If we left it on `_pushed`, nothing else would signal until it was drained.
+        lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+        _drainPushed();
+    }
+}
+
+template<typename T>
+void SSynchronizedQueue<T>::_drainPushed() const {
+    // Take the whole stack at once. It's newest first, so reverse it.
+    PushedItem* item = _pushed.exchange(nullptr, memory_order_acquire);
+    PushedItem* reversed = nullptr;
+    while (item) {
+        PushedItem* next = item->next;
+        item->next = reversed;
+        reversed = item;
+        item = next;
+    }
+    while (reversed) {
+        PushedItem* next = reversed->next;
+        _queue.push_back(move(reversed->item));
+        delete reversed;
+        _itemQueued(prev(_queue.end()));
+        reversed = next;
     }
 }
 
 template<typename T>
 bool SSynchronizedQueue<T>::empty() const {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
-    return _queue.empty();
+    return _queue.empty() && !_pushed.load(memory_order_acquire);
 }
 
 template<typename T>
 const T& SSynchronizedQueue<T>::front() const {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     if (!_queue.empty()) {
         return _queue.front();
     }
@@ -115,6 +169,7 @@ const T& SSynchronizedQueue<T>::front() const {
 template<typename T>
 T SSynchronizedQueue<T>::pop() {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     if (!_queue.empty()) {
         T item = move(_queue.front());
         _queue.pop_front();
@@ -125,23 +180,32 @@ T SSynchronizedQueue<T>::pop() {
 
 template<typename T>
 void SSynchronizedQueue<T>::push(T&& rhs) {
-    lock_guard<decltype(_queueMutex)> lock(_queueMutex);
-    // Just add to the queue
-    _queue.push_back(move(rhs));
-
-    // Write arbitrary buffer to the pipe so any subscribers will be awoken.
-    // **NOTE: 1 byte so write is atomic.
-    SASSERT(write(_pipeFD[1], "A", 1));
+    // Once the item is on the stack it belongs to whoever drains it, so we don't touch it again after the exchange.
+    PushedItem* item = new PushedItem{move(rhs), nullptr};
+    PushedItem* previous = _pushed.load(memory_order_relaxed);
+    do {
+        item->next = previous;
+    } while (!_pushed.compare_exchange_weak(previous, item, memory_order_release, memory_order_relaxed));
+
+    // If there was nothing waiting to be drained, wake up anyone polling on us. Otherwise, a wakeup's already pending.
+    // **NOTE: 8 bytes is what an eventfd expects, and is small enough to be atomic on a pipe.
+    if (!previous) {
+        uint64_t one = 1;
+        ssize_t ret = write(_writeFD, &one, sizeof(one));
+        SASSERT(ret == sizeof(one) || errno == EAGAIN || errno == EWOULDBLOCK);
+    }
 }
 
 template<typename T>
 size_t SSynchronizedQueue<T>::size() const {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     return _queue.size();
 }
 
 template<typename T>
 void SSynchronizedQueue<T>::each(const function<void (T&)> f) {
     lock_guard<decltype(_queueMutex)> lock(_queueMutex);
+    _drainPushed();
     for_each(_queue.begin(), _queue.end(), f);
 }
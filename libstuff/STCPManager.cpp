@@ -217,7 +217,7 @@ void STCPManager::closeSocket(Socket* socket) {
 }
 
 STCPManager::Socket::Socket(int sock, STCPManager::Socket::State state_, SX509* x509)
-  : s(sock), addr{}, state(state_), connectFailure(false), openTime(STimeNow()), lastSendTime(openTime),
+  : s(sock), addr{}, state(state_), connectFailure(false), openTime(SMonotonicNowCoarse()), lastSendTime(openTime),
     lastRecvTime(openTime), ssl(nullptr), data(nullptr), id(STCPManager::Socket::socketCount++), _x509(x509),
     sentBytes(0), recvBytes(0)
 { }
@@ -244,14 +244,34 @@ STCPManager::Socket* STCPManager::openSocket(const string& host, SX509* x509, re
     Socket* socket = new Socket(s, Socket::CONNECTING, x509);
     socket->ssl = x509 ? SSSLOpen(socket->s, x509) : 0;
     SASSERT(!x509 || socket->ssl);
+    _addSocket(socket, listMutexPtr);
+    return socket;
+}
 
+STCPManager::Socket* STCPManager::openSocket(const string& host, const shared_ptr<SSSLConfig>& sslConfig, recursive_mutex* listMutexPtr) {
+    // Try to open the socket
+    SASSERT(SHostIsValid(host));
+    SASSERT(sslConfig);
+    int s = S_socket(host, true, false, false);
+    if (s < 0) {
+        return 0;
+    }
+
+    // Create a new socket. The certificate (if any) belongs to the shared config, not the socket.
+    Socket* socket = new Socket(s, Socket::CONNECTING);
+    socket->ssl = SSSLOpen(socket->s, sslConfig, host);
+    SASSERT(socket->ssl);
+    _addSocket(socket, listMutexPtr);
+    return socket;
+}
+
+void STCPManager::_addSocket(Socket* socket, recursive_mutex* listMutexPtr) {
     if (listMutexPtr) {
         lock_guard<recursive_mutex> lock(*listMutexPtr);
         socketList.push_back(socket);
     } else {
         socketList.push_back(socket);
     }
-    return socket;
 }
 
 void STCPManager::Socket::resetCounters() {
@@ -281,7 +301,7 @@ bool STCPManager::Socket::send() {
         result = S_sendconsume(s, sendBuffer);
     }
     sentBytes += (oldSize - sendBuffer.size());
-    lastSendTime = STimeNow();
+    lastSendTime = SMonotonicNowCoarse();
     return result;
 }
 
@@ -329,7 +349,7 @@ bool STCPManager::Socket::recv() {
     // We've received new data
     if (oldSize != recvBuffer.size()) {
         recvBytes += (recvBuffer.size() - oldSize);
-        lastRecvTime = STimeNow();
+        lastRecvTime = SMonotonicNowCoarse();
     }
     return result;
 }
@@ -15,6 +15,8 @@ struct STCPManager {
         SFastBuffer recvBuffer;
         atomic<State> state;
         bool connectFailure;
+
+        // These are monotonic (see `SMonotonicNowCoarse`), so they're only useful relative to each other or to "now".
         uint64_t openTime;
         uint64_t lastSendTime;
         uint64_t lastRecvTime;
@@ -62,6 +64,9 @@ struct STCPManager {
     // Opens outgoing socket
     Socket* openSocket(const string& host, SX509* x509 = nullptr, recursive_mutex* listMutexPtr = nullptr);
 
+    // Opens an outgoing TLS socket using a shared client configuration. See SSSLConfig.
+    Socket* openSocket(const string& host, const shared_ptr<SSSLConfig>& sslConfig, recursive_mutex* listMutexPtr = nullptr);
+
     // Gracefully shuts down a socket
     void shutdownSocket(Socket* socket, int how = SHUT_RDWR);
 
@@ -70,4 +75,8 @@ struct STCPManager {
 
     // Attributes
     list<Socket*> socketList;
+
+  private:
+    // Adds a newly opened socket to `socketList`, locking `listMutexPtr` if it's set.
+    void _addSocket(Socket* socket, recursive_mutex* listMutexPtr);
 };
@@ -3,6 +3,8 @@
 #undef SLOGPREFIX
 #define SLOGPREFIX "{" << name << "} "
 
+const size_t STCPNode::COMPRESSION_THRESHOLD = 1024;
+
 STCPNode::STCPNode(const string& name_, const string& host, const uint64_t recvTimeout_)
     : STCPServer(host), name(name_), recvTimeout(recvTimeout_), _deserializeTimer("STCPNode::deserialize"),
       _sConsumeFrontTimer("STCPNode::SConsumeFront"), _sAppendTimer("STCPNode::append") {
@@ -68,6 +70,18 @@ STCPNode::State STCPNode::stateFromName(const string& name) {
     }
 }
 
+string STCPNode::serializeForPeer(const SData& message, bool compress) {
+    if (!compress || message.content.size() < COMPRESSION_THRESHOLD) {
+        return message.serialize();
+    }
+
+    // Only copy the headers, the content can be large. SComposeHTTP does the actual compression, and falls back to
+    // sending the content uncompressed (without the header) if gzip fails.
+    STable headers = message.nameValueMap;
+    headers["Content-Encoding"] = "gzip";
+    return SComposeHTTP(message.methodLine, headers, message.content);
+}
+
 void STCPNode::addPeer(const string& peerName, const string& host, const STable& params) {
     // Create a new peer and ready it for connection
     SASSERT(SHostIsValid(host));
@@ -97,6 +111,73 @@ uint64_t STCPNode::getIDByPeer(STCPNode::Peer* peer) {
     return 0;
 }
 
+const string& STCPNode::verbName(STCPNode::Verb verb) {
+    // Indexed by Verb, so this must stay in the same order as the enum.
+    static const string names[] = {
+        "UNKNOWN",
+        "PING",
+        "PONG",
+        "LOGIN",
+        "STATE",
+        "STANDUP_RESPONSE",
+        "SYNCHRONIZE",
+        "SYNCHRONIZE_RESPONSE",
+        "SUBSCRIBE",
+        "SUBSCRIPTION_APPROVED",
+        "BEGIN_TRANSACTION",
+        "COMMIT_TRANSACTION",
+        "ROLLBACK_TRANSACTION",
+        "APPROVE_TRANSACTION",
+        "DENY_TRANSACTION",
+        "ESCALATE",
+        "ESCALATE_CANCEL",
+        "ESCALATE_RESPONSE",
+        "ESCALATE_ABORTED",
+        "CRASH_COMMAND",
+        "BROADCAST_COMMAND"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == (size_t)Verb::NUM_VERBS, "verb names out of sync with Verb");
+    if (verb >= Verb::NUM_VERBS) {
+        return names[(size_t)Verb::UNKNOWN];
+    }
+    return names[(size_t)verb];
+}
+
+STCPNode::Verb STCPNode::verbFromName(const string& name) {
+    static const unordered_map<string, Verb> lookup = {
+        {"PING", Verb::PING},
+        {"PONG", Verb::PONG},
+        {"LOGIN", Verb::LOGIN},
+        {"STATE", Verb::STATE},
+        {"STANDUP_RESPONSE", Verb::STANDUP_RESPONSE},
+        {"SYNCHRONIZE", Verb::SYNCHRONIZE},
+        {"SYNCHRONIZE_RESPONSE", Verb::SYNCHRONIZE_RESPONSE},
+        {"SUBSCRIBE", Verb::SUBSCRIBE},
+        {"SUBSCRIPTION_APPROVED", Verb::SUBSCRIPTION_APPROVED},
+        {"BEGIN_TRANSACTION", Verb::BEGIN_TRANSACTION},
+        {"COMMIT_TRANSACTION", Verb::COMMIT_TRANSACTION},
+        {"ROLLBACK_TRANSACTION", Verb::ROLLBACK_TRANSACTION},
+        {"APPROVE_TRANSACTION", Verb::APPROVE_TRANSACTION},
+        {"DENY_TRANSACTION", Verb::DENY_TRANSACTION},
+        {"ESCALATE", Verb::ESCALATE},
+        {"ESCALATE_CANCEL", Verb::ESCALATE_CANCEL},
+        {"ESCALATE_RESPONSE", Verb::ESCALATE_RESPONSE},
+        {"ESCALATE_ABORTED", Verb::ESCALATE_ABORTED},
+        {"CRASH_COMMAND", Verb::CRASH_COMMAND},
+        {"BROADCAST_COMMAND", Verb::BROADCAST_COMMAND},
+    };
+
+    // Peers always send these upper case, so try that first and only normalize if it misses.
+    auto it = lookup.find(name);
+    if (it == lookup.end()) {
+        it = lookup.find(SToUpper(name));
+        if (it == lookup.end()) {
+            return Verb::UNKNOWN;
+        }
+    }
+    return it->second;
+}
+
 void STCPNode::prePoll(fd_map& fdm) {
     // Let the base class do its thing
     return STCPServer::prePoll(fdm);
@@ -131,6 +212,40 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
             int messageSize = message.deserialize(socket->recvBuffer);
             if (messageSize) {
                 // What is it?
+                if (SIEquals(message.methodLine, "NODE_DATA_LOGIN")) {
+                    // This is the data channel for a control connection from the same peer. It's opened right after
+                    // the control socket, but we might see it first, in which case we leave it for the next poll.
+                    Peer* peer = nullptr;
+                    for (Peer* candidate : peerList) {
+                        if (candidate->name == message["Name"]) {
+                            peer = candidate;
+                            break;
+                        }
+                    }
+                    if (!peer) {
+                        SWARN("Unauthenticated node '" << message["Name"] << "' attempted to connected, rejecting.");
+                        STHROW("unauthenticated node");
+                    }
+                    if (!peer->s) {
+                        continue;
+                    }
+                    if (peer->connectionID.empty() || peer->connectionID != message["ConnectionID"]) {
+                        STHROW("data channel for unknown connection");
+                    }
+                    if (peer->dataSocket) {
+                        STHROW("data channel already connected");
+                    }
+                    socket->recvBuffer.consumeFront(messageSize);
+                    PINFO("Attaching incoming data socket");
+                    lock_guard<decltype(peer->socketMutex)> lock(peer->socketMutex);
+                    peer->dataSocket = socket;
+                    peer->dataSocketReady = true;
+                    acceptedSocketList.erase(socketIt);
+
+                    // Let the other end know it can start using this.
+                    socket->send(SData("NODE_DATA_READY").serialize());
+                    continue;
+                }
                 socket->recvBuffer.consumeFront(messageSize);
                 if (SIEquals(message.methodLine, "NODE_LOGIN")) {
                     // Got it -- can we associate with a peer?
@@ -141,9 +256,11 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                         if (peer->name == message["Name"]) {
                             // Found it!  Are we already connected?
                             if (!peer->s) {
-                                // Attach to this peer and LOGIN
+                                // Attach to this peer and LOGIN. If the peer is going to open a data channel, it will
+                                // identify it with this connection ID.
                                 PINFO("Attaching incoming socket");
                                 peer->s = socket;
+                                peer->connectionID = message["ConnectionID"];
                                 peer->failedConnections = 0;
                                 acceptedSocketList.erase(socketIt);
                                 foundIt = true;
@@ -193,15 +310,15 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                 SData message;
                 int messageSize = 0;
                 try {
-                    // peer->s->lastRecvTime is always set, it's initialized to STimeNow() at creation.
-                    if (peer->s->lastRecvTime + recvTimeout < STimeNow()) {
+                    // peer->s->lastRecvTime is always set, it's initialized to openTime at creation.
+                    if (peer->s->lastRecvTime + recvTimeout < SMonotonicNowCoarse()) {
                         // Reset and reconnect.
                         SHMMM("Connection with peer '" << peer->name << "' timed out.");
                         STHROW("Timed Out!");
                     }
 
                     // Send PINGs 5s before the socket times out
-                    if (STimeNow() - peer->s->lastSendTime > recvTimeout - 5 * STIME_US_PER_S) {
+                    if (SMonotonicNowCoarse() - peer->s->lastSendTime > recvTimeout - 5 * STIME_US_PER_S) {
                         // Let's not delay on flushing the PING PONG exchanges
                         // in case we get blocked before we get to flush later.
                         SINFO("Sending PING to peer '" << peer->name << "'");
@@ -222,26 +339,37 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                         } else {
                             PDEBUG("Received '" << message.methodLine << "'.");
                         }
-                        if (SIEquals(message.methodLine, "PING")) {
-                            // Let's not delay on flushing the PING PONG
-                            // exchanges in case we get blocked before we
-                            // get to flush later.  Pass back the remote
-                            // timestamp of the PING such that the remote
-                            // host can calculate latency.
-                            SINFO("Received PING from peer '" << peer->name << "'. Sending PONG.");
-                            SData pong("PONG");
-                            pong["Timestamp"] = message["Timestamp"];
-                            peer->s->send(pong.serialize());
-                        } else if (SIEquals(message.methodLine, "PONG")) {
-                            // Recevied the PONG; update our latency estimate for this peer.
-                            // We set a lower bound on this at 1, because even though it should be pretty impossible
-                            // for this to be 0 (it's in us), we rely on it being non-zero in order to connect to
-                            // peers.
-                            peer->latency = max(STimeNow() - message.calc64("Timestamp"), (uint64_t)1);
-                            SINFO("Received PONG from peer '" << peer->name << "' (" << peer->latency/1000 << "ms latency)");
+                        _onPeerMessage(peer, message);
+                    }
+
+                    // Then anything that's come in over the data channel, once it's connected. Until then there's
+                    // nothing to read, and it's only been rejected once it's shutting down or closed.
+                    if (peer->dataSocket && peer->dataSocket->state.load() != Socket::CONNECTING) {
+                        if (peer->dataSocket->state.load() != Socket::CONNECTED) {
+                            if (peer->dataSocketReady) {
+                                // We reconnect the whole peer, there may have been a response in flight on the data
+                                // channel that will otherwise never come.
+                                STHROW("lost data channel");
+                            }
+
+                            // This peer never accepted the data channel (probably an older version), so just keep
+                            // using the control socket for everything.
+                            PINFO("Data channel rejected, sending everything over the control channel.");
+                            lock_guard<decltype(peer->socketMutex)> lock(peer->socketMutex);
+                            closeSocket(peer->dataSocket);
+                            peer->dataSocket = nullptr;
                         } else {
-                            // Not a PING or PONG; pass to the child class
-                            _onMESSAGE(peer, message);
+                            while ((messageSize = message.deserialize(peer->dataSocket->recvBuffer))) {
+                                peer->dataSocket->recvBuffer.consumeFront(messageSize);
+                                PDEBUG("Received '" << message.methodLine << "' on data channel.");
+                                if (SIEquals(message.methodLine, "NODE_DATA_READY")) {
+                                    PINFO("Data channel ready.");
+                                    lock_guard<decltype(peer->socketMutex)> lock(peer->socketMutex);
+                                    peer->dataSocketReady = true;
+                                } else {
+                                    _onPeerMessage(peer, message);
+                                }
+                            }
                         }
                     }
                 } catch (const SException& e) {
@@ -264,10 +392,10 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                 // Done; clean up and try to reconnect
                 uint64_t delay = SRandom::rand64() % (STIME_US_PER_S * 5);
                 if (peer->s->connectFailure) {
-                    PINFO("Peer connection failed after " << (STimeNow() - peer->s->openTime) / 1000
+                    PINFO("Peer connection failed after " << (SMonotonicNowCoarse() - peer->s->openTime) / 1000
                                                           << "ms, reconnecting in " << delay / 1000 << "ms");
                 } else {
-                    PHMMM("Lost peer connection after " << (STimeNow() - peer->s->openTime) / 1000
+                    PHMMM("Lost peer connection after " << (SMonotonicNowCoarse() - peer->s->openTime) / 1000
                                                         << "ms, reconnecting in " << delay / 1000 << "ms");
                 }
                 _onDisconnect(peer);
@@ -295,10 +423,24 @@ void STCPNode::postPoll(fd_map& fdm, uint64_t& nextActivity) {
                 if (peer->s) {
                     // Try to log in now.  Send a PING immediately after so we
                     // can get a fast estimate of latency.
+                    peer->connectionID = SToHex(SRandom::rand64());
                     SData login("NODE_LOGIN");
                     login["Name"] = name;
+                    login["ConnectionID"] = peer->connectionID;
                     peer->s->send(login.serialize());
                     _sendPING(peer);
+
+                    // Open the data channel as well. We don't use it until the peer tells us it's ready, and if we
+                    // can't open it at all, bulk messages just go over the control socket.
+                    Socket* dataSocket = openSocket(peer->host);
+                    if (dataSocket) {
+                        login.methodLine = "NODE_DATA_LOGIN";
+                        dataSocket->send(login.serialize());
+                        lock_guard<decltype(peer->socketMutex)> lock(peer->socketMutex);
+                        peer->dataSocket = dataSocket;
+                    } else {
+                        PHMMM("Failed to open data channel, sending everything over the control channel.");
+                    }
                     _onConnect(peer);
                 } else {
                     // Failed to open -- try again later
@@ -322,10 +464,52 @@ void STCPNode::_sendPING(Peer* peer) {
     peer->s->send(ping.serialize());
 }
 
-void STCPNode::Peer::sendMessage(const SData& message) {
+void STCPNode::_onPeerMessage(Peer* peer, SData& message) {
+    if (message.isSet("Content-Encoding")) {
+        // The peer compressed this for us, inflate it before anyone else looks at it.
+        if (!SIEquals(message["Content-Encoding"], "gzip")) {
+            STHROW("unsupported Content-Encoding");
+        }
+        message.content = SGUnzip(message.content);
+        if (message.content.empty()) {
+            STHROW("failed to decompress content");
+        }
+        message.erase("Content-Encoding");
+    }
+    Verb verb = verbFromName(message.methodLine);
+    switch (verb) {
+    case Verb::PING: {
+        // Let's not delay on flushing the PING PONG
+        // exchanges in case we get blocked before we
+        // get to flush later.  Pass back the remote
+        // timestamp of the PING such that the remote
+        // host can calculate latency.
+        SINFO("Received PING from peer '" << peer->name << "'. Sending PONG.");
+        SData pong("PONG");
+        pong["Timestamp"] = message["Timestamp"];
+        peer->s->send(pong.serialize());
+        break;
+    }
+    case Verb::PONG:
+        // Recevied the PONG; update our latency estimate for this peer.
+        // We set a lower bound on this at 1, because even though it should be pretty impossible
+        // for this to be 0 (it's in us), we rely on it being non-zero in order to connect to
+        // peers.
+        peer->latency = max(STimeNow() - message.calc64("Timestamp"), (uint64_t)1);
+        SINFO("Received PONG from peer '" << peer->name << "' (" << peer->latency/1000 << "ms latency)");
+        break;
+    default:
+        // Not a PING or PONG; pass to the child class
+        _onMESSAGE(peer, verb, message);
+    }
+}
+
+void STCPNode::Peer::sendMessage(const SData& message, bool bulk) {
     lock_guard<decltype(socketMutex)> lock(socketMutex);
-    if (s) {
-        s->send(message.serialize());
+    if (bulk && dataSocketReady && dataSocket->state.load() == Socket::CONNECTED) {
+        dataSocket->send(serializeForPeer(message, acceptsCompression));
+    } else if (s) {
+        s->send(serializeForPeer(message, acceptsCompression));
     } else {
         SWARN("Tried to send " << message.methodLine << " to peer, but not available.");
     }
@@ -333,6 +517,11 @@ void STCPNode::Peer::sendMessage(const SData& message) {
 
 void STCPNode::Peer::closeSocket(STCPManager* manager) {
     lock_guard<decltype(socketMutex)> lock(socketMutex);
+    if (dataSocket) {
+        manager->closeSocket(dataSocket);
+        dataSocket = nullptr;
+        dataSocketReady = false;
+    }
     if (s) {
         manager->closeSocket(s);
         s = nullptr;
@@ -61,6 +61,35 @@ struct STCPNode : public STCPServer {
     static const string& stateName(State state);
     static State stateFromName(const string& name);
 
+    // Message verbs understood by the peer protocol. Each incoming message's methodLine is interned into one of these
+    // once, so the handlers can switch on it rather than doing a chain of case-insensitive string compares.
+    enum class Verb {
+        UNKNOWN,
+        PING,
+        PONG,
+        LOGIN,
+        STATE,
+        STANDUP_RESPONSE,
+        SYNCHRONIZE,
+        SYNCHRONIZE_RESPONSE,
+        SUBSCRIBE,
+        SUBSCRIPTION_APPROVED,
+        BEGIN_TRANSACTION,
+        COMMIT_TRANSACTION,
+        ROLLBACK_TRANSACTION,
+        APPROVE_TRANSACTION,
+        DENY_TRANSACTION,
+        ESCALATE,
+        ESCALATE_CANCEL,
+        ESCALATE_RESPONSE,
+        ESCALATE_ABORTED,
+        CRASH_COMMAND,
+        BROADCAST_COMMAND,
+        NUM_VERBS
+    };
+    static const string& verbName(Verb verb);
+    static Verb verbFromName(const string& name);
+
     // Updates all peers
     void prePoll(fd_map& fdm);
     void postPoll(fd_map& fdm, uint64_t& nextActivity);
@@ -80,31 +109,62 @@ struct STCPNode : public STCPServer {
         uint64_t id;
         int failedConnections;
 
+        // True once this peer has told us (at login) that it can receive gzipped message content. This is read by
+        // worker threads in `sendMessage`, so it's atomic.
+        atomic<bool> acceptsCompression;
+
+        // Count of messages from this peer with a verb we didn't recognize. Unlike the rest of the peer state, this
+        // survives reconnects, so it's useful for spotting a peer running an incompatible version.
+        uint64_t unknownMessages;
+
         // Helper methods
         Peer(const string& name_, const string& host_, const STable& params_, uint64_t id_)
           : name(name_), host(host_), params(params_), state(SEARCHING), latency(0), nextReconnect(0), id(id_),
-            failedConnections(0), s(nullptr)
+            failedConnections(0), acceptsCompression(false), unknownMessages(0), s(nullptr), dataSocket(nullptr), dataSocketReady(false)
         { }
         bool connected() { return (s && s->state.load() == STCPManager::Socket::CONNECTED); }
         void reset() {
             clear();
             state = SEARCHING;
             s = nullptr;
+            dataSocket = nullptr;
+            dataSocketReady = false;
+            connectionID.clear();
             latency = 0;
+            acceptsCompression = false;
         }
 
-        // Close the peer's socket. This is synchronized so that you can safely call closeSocket and sendMessage on
-        // different threads.
+        // Close the peer's sockets (both the control socket and the data socket, if any). This is synchronized so that
+        // you can safely call closeSocket and sendMessage on different threads.
         void closeSocket(STCPManager* manager);
 
-        // Send a message to this peer.
-        void sendMessage(const SData& message);
+        // Send a message to this peer. Bulk messages go over the data channel if one is connected, so that large
+        // payloads don't queue up in front of control traffic (PINGs, transaction approvals, etc). Only use `bulk` for
+        // messages that nothing else on the control channel needs to be ordered against.
+        void sendMessage(const SData& message, bool bulk = false);
 
       private:
+        // The control socket. All peer protocol traffic goes over this unless it's explicitly sent as bulk.
         Socket* s;
+
+        // The optional data socket. This is opened by whichever side opened the control socket, and is tied to it by
+        // `connectionID`. It's only used once `dataSocketReady` is set, which happens when the accepting side attaches
+        // it and replies NODE_DATA_READY. Until then (or forever, for peers that don't support it), bulk messages just
+        // go over the control socket.
+        Socket* dataSocket;
+        bool dataSocketReady;
+        string connectionID;
         recursive_mutex socketMutex;
     };
 
+    // Message content at least this large is gzipped when sent to a peer that accepts compression. Smaller messages
+    // (PINGs, state changes, approvals) aren't worth the CPU.
+    static const size_t COMPRESSION_THRESHOLD;
+
+    // Serializes a message for sending to a peer. If `compress` is set and the content is large enough, the content is
+    // gzipped and the message is tagged `Content-Encoding: gzip`, which `postPoll` undoes on the receiving end.
+    static string serializeForPeer(const SData& message, bool compress);
+
     // Connects to a peer in the database cluster
     void addPeer(const string& name, const string& host, const STable& params);
 
@@ -120,8 +180,8 @@ struct STCPNode : public STCPServer {
     // Called when we lose connection with a peer
     virtual void _onDisconnect(Peer* peer) = 0;
 
-    // Called when the peer sends us a message; throw an SException to reconnect.
-    virtual void _onMESSAGE(Peer* peer, const SData& message) = 0;
+    // Called when the peer sends us a message; throw an SException to reconnect. `verb` is the interned methodLine.
+    virtual void _onMESSAGE(Peer* peer, Verb verb, const SData& message) = 0;
 
   protected:
     // Returns a peer by it's ID. If the ID is invalid, returns nullptr.
@@ -137,6 +197,9 @@ struct STCPNode : public STCPServer {
     // Helper functions
     void _sendPING(Peer* peer);
 
+    // Handles a single message received from a peer on either of its sockets.
+    void _onPeerMessage(Peer* peer, SData& message);
+
     AutoTimer _deserializeTimer;
     AutoTimer _sConsumeFrontTimer;
     AutoTimer _sAppendTimer;
@@ -1,11 +1,47 @@
 #include "libstuff.h"
 
+// The coarse clocks are Linux-only; elsewhere, just use the precise ones.
+#ifndef CLOCK_REALTIME_COARSE
+#define CLOCK_REALTIME_COARSE CLOCK_REALTIME
+#endif
+#ifndef CLOCK_MONOTONIC_COARSE
+#define CLOCK_MONOTONIC_COARSE CLOCK_MONOTONIC
+#endif
+
+static inline uint64_t _SClockNow(clockid_t clock) {
+    timespec time;
+    clock_gettime(clock, &time);
+    return (uint64_t)time.tv_sec * STIME_US_PER_S + (uint64_t)time.tv_nsec / 1000;
+}
+
 // --------------------------------------------------------------------------
 uint64_t STimeNow() {
     // Get the time = microseconds since 00:00:00 UTC, January 1, 1970
-    timeval time;
-    gettimeofday(&time, 0);
-    return ((uint64_t)time.tv_sec * 1000000 + (uint64_t)time.tv_usec);
+    return _SClockNow(CLOCK_REALTIME);
+}
+
+uint64_t STimeNowCoarse() {
+    return _SClockNow(CLOCK_REALTIME_COARSE);
+}
+
+uint64_t SMonotonicNow() {
+    return _SClockNow(CLOCK_MONOTONIC);
+}
+
+uint64_t SMonotonicNowCoarse() {
+    return _SClockNow(CLOCK_MONOTONIC_COARSE);
+}
+
+// --------------------------------------------------------------------------
+static thread_local uint64_t _STimeCached = 0;
+
+uint64_t STimeRefresh() {
+    _STimeCached = STimeNow();
+    return _STimeCached;
+}
+
+uint64_t STimeCached() {
+    return _STimeCached ? _STimeCached : STimeNow();
 }
 
 // --------------------------------------------------------------------------
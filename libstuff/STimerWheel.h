@@ -0,0 +1,324 @@
+#pragma once
+
+// Identifies an entry in an `STimerWheel`. Handles are never reused, so cancelling one whose entry has already expired
+// or been cancelled is harmless. Zero is never a valid handle.
+typedef uint64_t STimerHandle;
+
+// A hierarchical timing wheel. It holds values that each expire at a given time, and hands back batches of expired
+// values when asked. Adding and cancelling are O(1) and, once the wheel has grown to its working size, don't allocate.
+//
+// Time is divided into ticks (1ms by default), and the wheel has six levels of 64 slots each. Level 0 holds entries
+// expiring in the next 64 ticks, one tick per slot, level 1 the next 64 * 64 ticks, 64 ticks per slot, and so on. As time
+// passes, the entries in a higher-level slot are re-sorted into lower levels, so each entry moves at most six times over
+// its lifetime. With 1ms ticks, the wheel covers a little over two years, and anything further out than that waits in the
+// last slot until it's in range.
+//
+// Times are whatever clock the caller uses, in microseconds, as long as it's used consistently. Entries never expire
+// early, and expire at most one tick late. Entries that expire in the same tick come back in the order they were added.
+//
+// This is not synchronized. Callers that share a wheel between threads lock around it.
+template <typename T>
+class STimerWheel {
+  public:
+    // `now` is the current time on whatever clock the caller will use.
+    STimerWheel(uint64_t tickUS = STIME_US_PER_MS, uint64_t now = STimeNow());
+
+    // Adds `value`, to expire at `expires`. Something that's already expired is returned by the next call to `expire`.
+    STimerHandle add(uint64_t expires, T value);
+
+    // Removes an entry. Returns false if there's no such entry (it's already expired or been cancelled).
+    bool cancel(STimerHandle handle);
+
+    // Advances the wheel to `now`, calling `callback` with each value that's expired, earliest first. The value's
+    // removed from the wheel before `callback` is called, so `callback` can move from it, or add new entries. Returns the
+    // number of values expired.
+    size_t expire(uint64_t now, const function<void(T& value)>& callback);
+
+    // Removes everything.
+    void clear();
+
+    // Number of entries not yet expired or cancelled.
+    size_t size() const { return _count; }
+    bool empty() const { return !_count; }
+
+  private:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+    static constexpr int LEVELS = 6;
+
+    // Every entry is on one list. There's one list per slot, plus one for entries that are due the next time `expire`
+    // is called, plus the free list.
+    static constexpr uint16_t DUE_LIST = LEVELS * SLOTS;
+    static constexpr uint16_t FREE_LIST = DUE_LIST + 1;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        T value;
+        uint64_t tick;
+        uint32_t previous;
+        uint32_t next;
+        uint32_t generation;
+        uint16_t list;
+    };
+
+    // Puts the node on the right list for its tick, relative to the current tick.
+    void _place(uint32_t index);
+
+    // Adds to the end of/removes from whichever list the node is on.
+    void _append(uint16_t list, uint32_t index);
+    void _unlink(uint32_t index);
+
+    // Takes the node off its list, returns it to the free list, and returns its value.
+    T _release(uint32_t index);
+
+    // Re-places everything in the higher-level slots we've just moved into. Call when the current tick is a multiple of
+    // `SLOTS`.
+    void _cascade();
+
+    // Returns the next tick at which `_cascade` has anything to do.
+    uint64_t _nextCascade() const;
+
+    // Expires everything on a list. Returns the count.
+    size_t _expireList(uint16_t list, const function<void(T& value)>& callback);
+
+    uint64_t _tickUS;
+    uint64_t _currentTick;
+    size_t _count = 0;
+
+    // All the nodes, in use or free, and the heads and tails of each list (including the free list, which only uses
+    // its head).
+    vector<Node> _nodes;
+    uint32_t _heads[FREE_LIST + 1];
+    uint32_t _tails[FREE_LIST + 1];
+
+    // A bit per slot at each level, set if the slot's not empty.
+    uint64_t _occupied[LEVELS];
+};
+
+template <typename T>
+STimerWheel<T>::STimerWheel(uint64_t tickUS, uint64_t now) : _tickUS(tickUS), _currentTick(now / tickUS) {
+    clear();
+}
+
+template <typename T>
+void STimerWheel<T>::clear() {
+    _nodes.clear();
+    fill(begin(_heads), end(_heads), NONE);
+    fill(begin(_tails), end(_tails), NONE);
+    fill(begin(_occupied), end(_occupied), 0);
+    _count = 0;
+}
+
+template <typename T>
+STimerHandle STimerWheel<T>::add(uint64_t expires, T value) {
+    uint32_t index = _heads[FREE_LIST];
+    if (index == NONE) {
+        index = _nodes.size();
+        _nodes.push_back(Node{T(), 0, NONE, NONE, 1, FREE_LIST});
+    } else {
+        _heads[FREE_LIST] = _nodes[index].next;
+    }
+
+    // Round up, so that nothing expires early.
+    Node& node = _nodes[index];
+    node.value = move(value);
+    node.tick = expires / _tickUS + (expires % _tickUS ? 1 : 0);
+    _place(index);
+    _count++;
+    return ((STimerHandle)node.generation << 32) | index;
+}
+
+template <typename T>
+bool STimerWheel<T>::cancel(STimerHandle handle) {
+    uint32_t index = handle & 0xFFFFFFFF;
+    if (index >= _nodes.size() || _nodes[index].generation != (handle >> 32) || _nodes[index].list == FREE_LIST) {
+        return false;
+    }
+    _release(index);
+    return true;
+}
+
+template <typename T>
+size_t STimerWheel<T>::expire(uint64_t now, const function<void(T& value)>& callback) {
+    uint64_t target = now / _tickUS;
+    size_t count = _expireList(DUE_LIST, callback);
+    while (_currentTick < target) {
+        if (!_count) {
+            // Nothing to expire, we can skip straight there.
+            _currentTick = target;
+            break;
+        }
+
+        // Everything in level 0 is later in the current window than the current tick, so the lowest occupied slot is
+        // the next thing to expire.
+        if (_occupied[0]) {
+            uint64_t next = (_currentTick & ~(uint64_t)(SLOTS - 1)) | __builtin_ctzll(_occupied[0]);
+            if (next <= target) {
+                _currentTick = next;
+                count += _expireList(next & (SLOTS - 1), callback);
+                continue;
+            }
+        }
+
+        // Nothing more in level 0. Move to the next tick where a higher-level slot needs re-sorting, unless we're done
+        // before then.
+        uint64_t next = _nextCascade();
+        if (target < next) {
+            _currentTick = target;
+            break;
+        }
+        _currentTick = next;
+        _cascade();
+        count += _expireList(DUE_LIST, callback);
+    }
+    return count;
+}
+
+template <typename T>
+void STimerWheel<T>::_place(uint32_t index) {
+    Node& node = _nodes[index];
+    if (node.tick <= _currentTick) {
+        _append(DUE_LIST, index);
+        return;
+    }
+
+    // The entry goes in the lowest level where it's in the same window as the current tick. The top level has no
+    // window above it, so it takes anything less than a full turn of the wheel away, wrapping around if need be.
+    int level = 0;
+    while (level < LEVELS - 1 &&
+           (node.tick >> (SLOT_BITS * (level + 1))) != (_currentTick >> (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint32_t slot;
+    if (level == LEVELS - 1 && (node.tick >> (SLOT_BITS * level)) - (_currentTick >> (SLOT_BITS * level)) >= SLOTS) {
+        // It's beyond the end of the wheel. Park it in the top-level slot we'll reach last; it gets re-placed from there.
+        slot = ((_currentTick >> (SLOT_BITS * level)) - 1) & (SLOTS - 1);
+    } else {
+        slot = (node.tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    }
+    _append(level * SLOTS + slot, index);
+}
+
+template <typename T>
+void STimerWheel<T>::_append(uint16_t list, uint32_t index) {
+    Node& node = _nodes[index];
+    node.list = list;
+    node.next = NONE;
+    node.previous = _tails[list];
+    if (node.previous == NONE) {
+        _heads[list] = index;
+    } else {
+        _nodes[node.previous].next = index;
+    }
+    _tails[list] = index;
+    if (list < DUE_LIST) {
+        _occupied[list / SLOTS] |= 1ull << (list % SLOTS);
+    }
+}
+
+template <typename T>
+void STimerWheel<T>::_unlink(uint32_t index) {
+    Node& node = _nodes[index];
+    if (node.previous == NONE) {
+        _heads[node.list] = node.next;
+    } else {
+        _nodes[node.previous].next = node.next;
+    }
+    if (node.next == NONE) {
+        _tails[node.list] = node.previous;
+    } else {
+        _nodes[node.next].previous = node.previous;
+    }
+    if (node.list < DUE_LIST && _heads[node.list] == NONE) {
+        _occupied[node.list / SLOTS] &= ~(1ull << (node.list % SLOTS));
+    }
+}
+
+template <typename T>
+T STimerWheel<T>::_release(uint32_t index) {
+    _unlink(index);
+    Node& node = _nodes[index];
+    T value = move(node.value);
+    node.value = T();
+    node.generation++;
+    node.list = FREE_LIST;
+    node.next = _heads[FREE_LIST];
+    _heads[FREE_LIST] = index;
+    _count--;
+    return value;
+}
+
+template <typename T>
+uint64_t STimerWheel<T>::_nextCascade() const {
+    uint64_t next = UINT64_MAX;
+    for (int level = 1; level < LEVELS; level++) {
+        if (!_occupied[level]) {
+            continue;
+        }
+
+        // Slots in this level are ahead of the current one, except at the top level, where they can wrap around into
+        // the next turn of the wheel.
+        uint64_t current = (_currentTick >> (SLOT_BITS * level)) & (SLOTS - 1);
+        uint64_t ahead = current == SLOTS - 1 ? 0 : _occupied[level] & (~0ull << (current + 1));
+        uint64_t windowStart = (_currentTick >> (SLOT_BITS * (level + 1))) << (SLOT_BITS * (level + 1));
+        uint64_t tick;
+        if (ahead) {
+            tick = windowStart + ((uint64_t)__builtin_ctzll(ahead) << (SLOT_BITS * level));
+        } else {
+            tick = windowStart + ((uint64_t)(__builtin_ctzll(_occupied[level]) + SLOTS) << (SLOT_BITS * level));
+        }
+        next = min(next, tick);
+    }
+    return next;
+}
+
+template <typename T>
+void STimerWheel<T>::_cascade() {
+    // Find the highest level whose slot we've just moved into. Every level below it has wrapped around to slot 0.
+    int top = 1;
+    while (top < LEVELS - 1 && !(_currentTick & ((1ull << (SLOT_BITS * (top + 1))) - 1))) {
+        top++;
+    }
+
+    // Start at the top, as its entries can land in the slots below that we're about to cascade.
+    for (int level = top; level > 0; level--) {
+        uint16_t list = level * SLOTS + ((_currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        uint32_t index = _heads[list];
+        _heads[list] = NONE;
+        _tails[list] = NONE;
+        _occupied[level] &= ~(1ull << (list % SLOTS));
+        while (index != NONE) {
+            uint32_t next = _nodes[index].next;
+            _place(index);
+            index = next;
+        }
+    }
+}
+
+template <typename T>
+size_t STimerWheel<T>::_expireList(uint16_t list, const function<void(T& value)>& callback) {
+    // Everything in a slot expires in the same tick, but entries that were added after they'd already expired can be
+    // from any tick, so those need sorting. There are rarely more than a couple.
+    if (list == DUE_LIST && _heads[list] != NONE && _nodes[_heads[list]].next != NONE) {
+        vector<uint32_t> due;
+        for (uint32_t index = _heads[list]; index != NONE; index = _nodes[index].next) {
+            due.push_back(index);
+        }
+        stable_sort(due.begin(), due.end(), [this](uint32_t a, uint32_t b) {
+            return _nodes[a].tick < _nodes[b].tick;
+        });
+        _heads[list] = NONE;
+        _tails[list] = NONE;
+        for (uint32_t index : due) {
+            _append(list, index);
+        }
+    }
+
+    size_t count = 0;
+    while (_heads[list] != NONE) {
+        T value = _release(_heads[list]);
+        callback(value);
+        count++;
+    }
+    return count;
+}
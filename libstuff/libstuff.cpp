@@ -16,6 +16,13 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <dirent.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __x86_64__
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 #ifdef __APPLE__
 // Apple specific tweaks
 #include <sys/types.h>
@@ -161,14 +168,35 @@ string SToHex(uint64_t value, int digits) {
 }
 
 string SToHex(const string& value) {
-    // Fill from front to back
+    static const char digits[] = "0123456789ABCDEF";
     string working;
-    working.reserve(value.size() * 2);
-    for (size_t c = 0; c < value.size(); ++c) {
+    working.resize(value.size() * 2);
+    const unsigned char* in = (const unsigned char*)value.data();
+    char* out = &working[0];
+    size_t c = 0;
+#ifdef __SSE2__
+    // 16 bytes at a time: split each byte into its two nibbles, interleave them high nibble first, and map 0-9 to
+    // '0'-'9' and 10-15 to 'A'-'F' by adding '0', plus 7 more for anything over 9.
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i letterOffset = _mm_set1_epi8('A' - '0' - 10);
+    for (; c + 16 <= value.size(); c += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(in + c));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), lowNibble);
+        __m128i low = _mm_and_si128(bytes, lowNibble);
+        __m128i first = _mm_unpacklo_epi8(high, low);
+        __m128i second = _mm_unpackhi_epi8(high, low);
+        first = _mm_add_epi8(_mm_add_epi8(first, zero), _mm_and_si128(_mm_cmpgt_epi8(first, nine), letterOffset));
+        second = _mm_add_epi8(_mm_add_epi8(second, zero), _mm_and_si128(_mm_cmpgt_epi8(second, nine), letterOffset));
+        _mm_storeu_si128((__m128i*)(out + c * 2), first);
+        _mm_storeu_si128((__m128i*)(out + c * 2 + 16), second);
+    }
+#endif
+    for (; c < value.size(); ++c) {
         // Add two digits per byte
-        unsigned char digit = (unsigned char)value[c];
-        working += ((digit >> 4) < 10 ? '0' + (digit >> 4) : 'A' + (digit >> 4) - 10);
-        working += ((digit & 0xF) < 10 ? '0' + (digit & 0xF) : 'A' + (digit & 0xF) - 10);
+        out[c * 2] = digits[in[c] >> 4];
+        out[c * 2 + 1] = digits[in[c] & 0xF];
     }
     return working;
 }
@@ -195,10 +223,32 @@ uint64_t SFromHex(const string& value) {
 }
 
 string SStrFromHex(const string& buffer) {
+    // Value of each hex digit, or -1 for anything else.
+    static const array<int8_t, 256> values = []() {
+        array<int8_t, 256> table;
+        table.fill(-1);
+        for (int i = 0; i < 10; i++) {
+            table['0' + i] = i;
+        }
+        for (int i = 0; i < 6; i++) {
+            table['a' + i] = 10 + i;
+            table['A' + i] = 10 + i;
+        }
+        return table;
+    }();
+
     string retVal;
-    retVal.reserve(buffer.size() / 2);
-    for(size_t i = 0; i < buffer.size(); i += 2) {
-        retVal.push_back((char)strtol(buffer.substr(i, 2).c_str(), 0, 16));
+    retVal.resize((buffer.size() + 1) / 2);
+    const unsigned char* in = (const unsigned char*)buffer.data();
+    for (size_t i = 0; i < buffer.size(); i += 2) {
+        int high = values[in[i]];
+        int low = i + 1 < buffer.size() ? values[in[i + 1]] : -1;
+        if (high >= 0 && low >= 0) {
+            retVal[i / 2] = (char)((high << 4) | low);
+        } else {
+            // Not a plain pair of digits (a trailing odd digit, or garbage). Let strtol decide, as it always has.
+            retVal[i / 2] = (char)strtol(buffer.substr(i, 2).c_str(), 0, 16);
+        }
     }
     return retVal;
 }
@@ -666,7 +716,19 @@ void _SParseHTTP_GetUpToEnd(const char* start, const char* end, string& out) {
 }
 
 // --------------------------------------------------------------------------
-int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& nameValueMap, string& content) {
+// Looks up a well-known header, using its precomputed hash if the table can.
+static STable::const_iterator _SParseHTTP_Find(const STable& nameValueMap, const SHeaderTable::Key& key) {
+    return nameValueMap.find(key.name);
+}
+
+static SHeaderTable::const_iterator _SParseHTTP_Find(const SHeaderTable& nameValueMap, const SHeaderTable::Key& key) {
+    return nameValueMap.find(key);
+}
+
+// --------------------------------------------------------------------------
+// Shared by the `STable` and `SHeaderTable` versions of `SParseHTTP`.
+template <typename TABLE>
+static int _SParseHTTP(const char* buffer, size_t length, string& methodLine, TABLE& nameValueMap, string& content) {
     // Clear the output
     methodLine.clear();
     nameValueMap.clear();
@@ -721,8 +783,9 @@ int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& na
                     int headerLength = (int)(parseEnd - buffer);
 
                     // If there is no content-length, just return the length of the headers
-                    int contentLength = (SContains(nameValueMap, "Content-Length")
-                                             ? atoi(nameValueMap["Content-Length"].c_str())
+                    auto contentLengthIt = _SParseHTTP_Find(nameValueMap, SHeaderTable::CONTENT_LENGTH);
+                    int contentLength = (contentLengthIt != nameValueMap.end()
+                                             ? atoi(contentLengthIt->second.c_str())
                                              : 0);
                     if (!contentLength)
                         return headerLength;
@@ -827,11 +890,13 @@ int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& na
                         // there just override, with the exception of
                         // Set-Cookie: generate a crappy list with 0xFF
                         // separation.  (See SComposeHTTP for explanation.)
-                        STable::iterator it = nameValueMap.find(name);
-                        if (it == nameValueMap.end() || !SIEquals(name, "Set-Cookie"))
+                        auto it = nameValueMap.find(name);
+                        if (it == nameValueMap.end())
                             nameValueMap[name] = SUnescape(value); // strip any slash-escaping
+                        else if (!SIEquals(name, "Set-Cookie"))
+                            it->second = SUnescape(value);
                         else
-                            nameValueMap[name] = it->second + S_COOKIE_SEPARATOR + value;
+                            it->second = it->second + S_COOKIE_SEPARATOR + value;
                     }
                 }
             }
@@ -858,6 +923,14 @@ int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& na
     return 0;
 }
 
+int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& nameValueMap, string& content) {
+    return _SParseHTTP(buffer, length, methodLine, nameValueMap, content);
+}
+
+int SParseHTTP(const char* buffer, size_t length, string& methodLine, SHeaderTable& nameValueMap, string& content) {
+    return _SParseHTTP(buffer, length, methodLine, nameValueMap, content);
+}
+
 // --------------------------------------------------------------------------
 bool SParseRequestMethodLine(const string& methodLine, string& method, string& uri) {
     // Clear the input
@@ -1024,13 +1097,18 @@ bool SParseURIPath(const char* buffer, int length, string& path, STable& nameVal
 }
 
 // --------------------------------------------------------------------------
-void SComposeHTTP(string& buffer, const string& methodLine, const STable& nameValueMap, const string& content) {
+// Shared by the `STable` and `SHeaderTable` versions of `SComposeHTTP`. `headers` is a list of pointers to name/value
+// pairs, in the order they should be written.
+template <typename ITEM>
+static void _SComposeHTTP(string& buffer, const string& methodLine, const vector<const ITEM*>& headers,
+                          const string& content) {
     bool tryGzip = false;
 
     // Just walk across and compose a valid HTTP-like message
     buffer.clear();
     buffer += methodLine + "\r\n";
-    for (pair<string, string> item : nameValueMap) {
+    for (const ITEM* header : headers) {
+        const ITEM& item = *header;
         if (SIEquals("Set-Cookie", item.first)) {
             // Parse this list and generate a separate cookie for each.
             // Technically, this shouldn't be necessary: RFC2109 section 4.2.2
@@ -1066,6 +1144,29 @@ void SComposeHTTP(string& buffer, const string& methodLine, const STable& nameVa
     buffer += finalContent;
 }
 
+void SComposeHTTP(string& buffer, const string& methodLine, const STable& nameValueMap, const string& content) {
+    vector<const STable::value_type*> headers;
+    headers.reserve(nameValueMap.size());
+    for (const auto& item : nameValueMap) {
+        headers.push_back(&item);
+    }
+    _SComposeHTTP(buffer, methodLine, headers, content);
+}
+
+void SComposeHTTP(string& buffer, const string& methodLine, const SHeaderTable& nameValueMap, const string& content) {
+    // Write the headers in the same order an STable would have them in.
+    vector<const SHeaderTable::value_type*> headers;
+    headers.reserve(nameValueMap.size());
+    for (const auto& item : nameValueMap) {
+        headers.push_back(&item);
+    }
+    STableComp comp;
+    sort(headers.begin(), headers.end(), [&comp](const SHeaderTable::value_type* a, const SHeaderTable::value_type* b) {
+        return comp(a->first, b->first);
+    });
+    _SComposeHTTP(buffer, methodLine, headers, content);
+}
+
 // --------------------------------------------------------------------------
 string SComposePOST(const STable& nameValueMap) {
     // Accumulate and convert
@@ -1170,25 +1271,74 @@ string SDecodeURIComponent(const char* buffer, int length) {
 // --------------------------------------------------------------------------
 extern const char* _SParseJSONValue(const char* ptr, const char* end, string& value, bool populateValue);
 
-string SToJSON(const string& value, const bool forceString) {
+// Returns true if `value` is exactly what SToStr(SToInt64(value)) would produce, without doing the conversions.
+static bool _SIsCanonicalInt64(const string& value) {
+    const char* ptr = value.c_str();
+    const char* end = ptr + value.size();
+    bool negative = (ptr < end && *ptr == '-');
+    if (negative) {
+        ++ptr;
+    }
+    size_t digits = end - ptr;
+    if (!digits || (*ptr == '0' && (digits > 1 || negative))) {
+        // Empty, leading zeros, or "-0".
+        return false;
+    }
+    for (const char* c = ptr; c < end; ++c) {
+        if (*c < '0' || *c > '9') {
+            return false;
+        }
+    }
+
+    // Anything out of range would have been clamped by the conversion, so compare against the limits.
+    if (digits != 19) {
+        return digits < 19;
+    }
+    return strcmp(ptr, negative ? "9223372036854775808" : "9223372036854775807") <= 0;
+}
+
+// Returns true if `value` only has characters that SToStr can produce for a number. Anything else can't possibly survive
+// the round trip through SToFloat, so there's no need to try.
+static bool _SCouldBeNumber(const string& value) {
+    if (value.empty()) {
+        return false;
+    }
+    for (char c : value) {
+        if (!isdigit(c) && !strchr(".-+eEinfa", c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SAppendJSON(string& out, const string& value, const bool forceString) {
     // Is it an integer?
-    if (SToStr(SToInt64(value.c_str())) == value) {
-        return value;
+    if (_SIsCanonicalInt64(value)) {
+        out += value;
+        return;
     }
+
     // Is it a float?
-    if (SToStr(SToFloat(value.c_str())) == value) {
-        return value;
+    if (_SCouldBeNumber(value) && SToStr(SToFloat(value.c_str())) == value) {
+        out += value;
+        return;
     }
 
-    // Is it boolean?
-    if (SIEquals(value, "true"))
-        return "true";
-    if (SIEquals(value, "false"))
-        return "false";
-
-    // Is it null?
-    if (SIEquals(value, "null"))
-        return "null";
+    // Is it boolean or null?
+    if (value.size() == 4 || value.size() == 5) {
+        if (SIEquals(value, "true")) {
+            out += "true";
+            return;
+        }
+        if (SIEquals(value, "false")) {
+            out += "false";
+            return;
+        }
+        if (SIEquals(value, "null")) {
+            out += "null";
+            return;
+        }
+    }
 
     // Is it already a JSON array or object?
     if (!forceString && value.size() >= 2 &&
@@ -1198,17 +1348,71 @@ string SToJSON(const string& value, const bool forceString) {
         const char* ptr = value.c_str();
         const char* end = ptr + value.size();
         const char* parseEnd = _SParseJSONValue(ptr, end, ignore, false);
-        if (parseEnd == end) // Parsed it all.
-            return value;
+        if (parseEnd == end) { // Parsed it all.
+            out += value;
+            return;
+        }
     }
 
-    // Otherwise, it's a string -- escape and return
-    // We need to escape all control characters in the string, not just the
-    // white-space control characters.
-    return "\"" + SEscape(value, "\x01\x02\x03\x04\x05\x06\x07\b\t\n\x0b\f\r\x0e\x0f\x10\x11"
-                                 "\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f\x7f\"\\/",
-                          '\\') +
-           "\"";
+    // Otherwise, it's a string -- escape it. We need to escape all control characters in the string, not just the
+    // white-space control characters, as well as DEL, quotes, backslashes and slashes. Like SEscape, this stops at the
+    // first NUL. Runs of characters that don't need escaping are appended in one go.
+    static const auto needsEscape = []() {
+        array<bool, 256> table{};
+        for (int c = 0x01; c < 0x20; c++) {
+            table[c] = true;
+        }
+        for (unsigned char c : {'\x7f', '"', '\\', '/'}) {
+            table[c] = true;
+        }
+        return table;
+    }();
+    out.reserve(out.size() + value.size() + 2);
+    out += '"';
+    const char* ptr = value.c_str();
+    const char* runStart = ptr;
+    for (; *ptr; ++ptr) {
+        unsigned char c = *ptr;
+        if (!needsEscape[c]) {
+            continue;
+        }
+        out.append(runStart, ptr - runStart);
+        runStart = ptr + 1;
+        out += '\\';
+        switch (c) {
+        case '\b':
+            out += 'b';
+            break;
+        case '\f':
+            out += 'f';
+            break;
+        case '\n':
+            out += 'n';
+            break;
+        case '\r':
+            out += 'r';
+            break;
+        case '\t':
+            out += 't';
+            break;
+        default:
+            if (c < 0x20) {
+                char utfCode[6] = {0};
+                snprintf(utfCode, sizeof(utfCode), "u%04x", c);
+                out += utfCode;
+            } else {
+                out += (char)c;
+            }
+        }
+    }
+    out.append(runStart, ptr - runStart);
+    out += '"';
+}
+
+string SToJSON(const string& value, const bool forceString) {
+    string out;
+    SAppendJSON(out, value, forceString);
+    return out;
 }
 
 // --------------------------------------------------------------------------
@@ -1216,18 +1420,50 @@ string SComposeJSONObject(const STable& nameValueMap, const bool forceString) {
     if (nameValueMap.empty())
         return "{}";
     string working = "{";
-    for (pair<string, string> item : nameValueMap) {
-        working += "\"" + item.first + "\":" + SToJSON(item.second, forceString) + ",";
-    }
-    working.resize(working.size() - 1);
-    working += "}";
+    for (const auto& item : nameValueMap) {
+        working += '"';
+        working += item.first;
+        working += "\":";
+        SAppendJSON(working, item.second, forceString);
+        working += ',';
+    }
+    working.back() = '}';
     return working;
 }
 
 // --------------------------------------------------------------------------
+// Same set of characters as `isspace` in the C locale, without the function call.
+static inline bool _SJSONIsSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Returns a pointer to the first quote, backslash or NUL at or after `ptr`, or `end` if there isn't one. This is the
+// inner loop of parsing every JSON string, so where SSE2 is available, it checks 16 bytes at a time.
+static inline const char* _SJSONFindStringSpecial(const char* ptr, const char* end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i nul = _mm_setzero_si128();
+    while (end - ptr >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmpeq_epi8(chunk, nul));
+        int mask = _mm_movemask_epi8(matches);
+        if (mask) {
+            return ptr + __builtin_ctz(mask);
+        }
+        ptr += 16;
+    }
+#endif
+    while (ptr < end && *ptr != '"' && *ptr != '\\' && *ptr) {
+        ++ptr;
+    }
+    return ptr;
+}
+
 #define _JSONWS()                                                                                                      \
     do {                                                                                                               \
-        while (ptr < end && isspace(*ptr))                                                                             \
+        while (ptr < end && _SJSONIsSpace(*ptr))                                                                       \
             ++ptr;                                                                                                     \
         if (ptr >= end)                                                                                                \
             return ptr;                                                                                                \
@@ -1260,21 +1496,32 @@ const char* _SParseJSONString(const char* ptr, const char* end, string& out, boo
     _JSONWS();
     _JSONTEST('"');
     const char* strStart = ptr;
-    for (; ptr < end && *ptr; ++ptr) {
-        // Found the end of this string
-        if (*ptr == '"')
+    bool escaped = false;
+    while (ptr < end) {
+        ptr = _SJSONFindStringSpecial(ptr, end);
+
+        // Found the end of this string (or a NUL, which is an error)
+        if (ptr >= end || *ptr != '\\')
             break;
 
         // We want to skip all escaped characters so we don't mistakenly count
         // an escaped double-quote as the actual end.
-        else if (*ptr == '\\')
-            ++ptr;
+        escaped = true;
+        ptr += 2;
+    }
+    if (ptr > end) {
+        ptr = end;
     }
     _JSONTEST('"');
 
     if (populateOut) {
-        string strOut(strStart, ptr - strStart - 1);
-        out += SUnescape(strOut.c_str(), '\\');
+        if (escaped) {
+            string strOut(strStart, ptr - strStart - 1);
+            out += SUnescape(strOut.c_str(), '\\');
+        } else {
+            // Nothing to unescape, just copy it.
+            out.append(strStart, ptr - strStart - 1);
+        }
     }
     return ptr;
 }
@@ -1297,7 +1544,7 @@ const char* _SParseJSONArray(const char* ptr, const char* end, list<string>& out
         ptr = _SParseJSONValue(ptr, end, value, populateOut);
         _JSONASSERTPTR(); // Make sure no parse error.
         if (populateOut)
-            out.push_back(value);
+            out.push_back(move(value));
         _JSONLOG();
 
         // See if we're done
@@ -1336,7 +1583,7 @@ const char* _SParseJSONObject(const char* ptr, const char* end, STable& out, boo
         if (populateOut) {
             // Got one more
             SDEBUG("Parsed: '" << name << "':'" << value << "'");
-            out[name] = value;
+            out[move(name)] = move(value);
         }
         _JSONLOG();
 
@@ -2253,7 +2500,194 @@ uint64_t SFileSize(const string& path) {
 // Cryptography stuff
 /////////////////////////////////////////////////////////////////////////////
 
+// SHA1, SHA256 and base64 are on the commit path (the journal hash chain) and all over request handling, so on x86 we
+// use the SHA extensions and SSSE3 when the CPU has them. These are checked once, at runtime, so the same binary runs
+// everywhere. Anything that isn't accelerated goes through mbedtls as before, and the output is identical either way.
+#ifdef __x86_64__
+struct SCPUFeatures {
+    SCPUFeatures() {
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            ssse3 = ecx & bit_SSSE3;
+            sse41 = ecx & bit_SSE4_1;
+        }
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            sha = ebx & bit_SHA;
+        }
+    }
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool sha = false;
+};
+static const SCPUFeatures _SCPU;
+
+// Both of these consume whole 64 byte blocks, and are straight translations of the round structure from Intel's SHA
+// extensions reference. The four message registers rotate, so `M[r % 4]` is the schedule for rounds 4r to 4r + 3.
+__attribute__((target("sha,sse4.1")))
+static void _SSHA1Blocks(uint32_t state[5], const unsigned char* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+    __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+    __m128i e1;
+    __m128i M[4];
+    for (; blocks; blocks--, data += 64) {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+        for (int i = 0; i < 4; i++) {
+            M[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), byteSwap);
+        }
+
+        // Each group of four rounds alternates between e0 and e1 for the `e` value, and the round function changes
+        // every 20 rounds. The immediate has to be a constant, hence the macro.
+        #define SHA1_ROUNDS(_R_, _F_) \
+            do { \
+                if (_R_ % 2 == 0) { \
+                    e0 = (_R_ == 0) ? _mm_add_epi32(e0, M[0]) : _mm_sha1nexte_epu32(e0, M[_R_ % 4]); \
+                    e1 = abcd; \
+                    abcd = _mm_sha1rnds4_epu32(abcd, e0, _F_); \
+                } else { \
+                    e1 = _mm_sha1nexte_epu32(e1, M[_R_ % 4]); \
+                    e0 = abcd; \
+                    abcd = _mm_sha1rnds4_epu32(abcd, e1, _F_); \
+                } \
+                if (_R_ >= 3 && _R_ <= 18) { \
+                    M[(_R_ + 1) % 4] = _mm_sha1msg2_epu32(M[(_R_ + 1) % 4], M[_R_ % 4]); \
+                } \
+                if (_R_ >= 1 && _R_ <= 16) { \
+                    M[(_R_ + 3) % 4] = _mm_sha1msg1_epu32(M[(_R_ + 3) % 4], M[_R_ % 4]); \
+                } \
+                if (_R_ >= 2 && _R_ <= 17) { \
+                    M[(_R_ + 2) % 4] = _mm_xor_si128(M[(_R_ + 2) % 4], M[_R_ % 4]); \
+                } \
+            } while (0)
+        SHA1_ROUNDS(0, 0);  SHA1_ROUNDS(1, 0);  SHA1_ROUNDS(2, 0);  SHA1_ROUNDS(3, 0);  SHA1_ROUNDS(4, 0);
+        SHA1_ROUNDS(5, 1);  SHA1_ROUNDS(6, 1);  SHA1_ROUNDS(7, 1);  SHA1_ROUNDS(8, 1);  SHA1_ROUNDS(9, 1);
+        SHA1_ROUNDS(10, 2); SHA1_ROUNDS(11, 2); SHA1_ROUNDS(12, 2); SHA1_ROUNDS(13, 2); SHA1_ROUNDS(14, 2);
+        SHA1_ROUNDS(15, 3); SHA1_ROUNDS(16, 3); SHA1_ROUNDS(17, 3); SHA1_ROUNDS(18, 3); SHA1_ROUNDS(19, 3);
+        #undef SHA1_ROUNDS
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+__attribute__((target("sha,sse4.1")))
+static void _SSHA256Blocks(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The instructions want the state as ABEF and CDGH.
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    __m128i M[4];
+    for (; blocks; blocks--, data += 64) {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        for (int i = 0; i < 4; i++) {
+            M[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), byteSwap);
+        }
+        for (int r = 0; r < 16; r++) {
+            __m128i message = _mm_add_epi32(M[r % 4], _mm_loadu_si128((const __m128i*)&K[r * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            if (r >= 3 && r <= 14) {
+                __m128i& next = M[(r + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(M[r % 4], M[(r + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, M[r % 4]);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+            if (r >= 1 && r <= 12) {
+                M[(r + 3) % 4] = _mm_sha256msg1_epu32(M[(r + 3) % 4], M[r % 4]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    // And back to ABCD and EFGH.
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+// Runs the standard Merkle-Damgard padding over `buffer` with the given block function, and writes the big-endian
+// state out as the digest.
+template <size_t WORDS>
+static string _SHashWithBlocks(void (*process)(uint32_t*, const unsigned char*, size_t), array<uint32_t, WORDS> state,
+                               const string& buffer) {
+    const unsigned char* data = (const unsigned char*)buffer.data();
+    size_t fullBlocks = buffer.size() / 64;
+    process(state.data(), data, fullBlocks);
+
+    // The last partial block, the 0x80 terminator, and the length in bits, in one or two more blocks.
+    unsigned char tail[128] = {0};
+    size_t remaining = buffer.size() % 64;
+    memcpy(tail, data + fullBlocks * 64, remaining);
+    tail[remaining] = 0x80;
+    size_t tailSize = remaining < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)buffer.size() * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailSize - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    process(state.data(), tail, tailSize / 64);
+
+    string result;
+    result.resize(WORDS * 4);
+    for (size_t i = 0; i < WORDS; i++) {
+        result[i * 4] = (char)(state[i] >> 24);
+        result[i * 4 + 1] = (char)(state[i] >> 16);
+        result[i * 4 + 2] = (char)(state[i] >> 8);
+        result[i * 4 + 3] = (char)state[i];
+    }
+    return result;
+}
+
+// Encodes as many whole 12 byte groups as it can, 16 output characters at a time, and returns how many input bytes it
+// consumed. See http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html for how this works.
+__attribute__((target("ssse3")))
+static size_t _SEncodeBase64Blocks(const unsigned char* in, size_t size, char* out) {
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shiftLUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t consumed = 0;
+
+    // Each load reads 16 bytes but only uses 12, so stop while there's still a full load left.
+    for (; consumed + 16 <= size; consumed += 12, out += 16) {
+        __m128i bytes = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + consumed)), spread);
+
+        // Pull the four six bit indices out of each three bytes, one per output byte.
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t0, t1);
+
+        // Map each index to the offset that turns it into its character: 0-25 to 13, 26-51 to 0, 52-63 to 1-12.
+        __m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        offsets = _mm_or_si128(offsets, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i*)out, _mm_add_epi8(indices, _mm_shuffle_epi8(shiftLUT, offsets)));
+    }
+    return consumed;
+}
+#endif
+
 string SHashSHA1(const string& buffer) {
+#ifdef __x86_64__
+    if (_SCPU.sha && _SCPU.sse41) {
+        return _SHashWithBlocks<5>(_SSHA1Blocks, {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0}, buffer);
+    }
+#endif
     string result;
     result.resize(20);
     mbedtls_sha1((unsigned char*)buffer.c_str(), buffer.size(), (unsigned char*)&result[0]);
@@ -2261,6 +2695,12 @@ string SHashSHA1(const string& buffer) {
 }
 
 string SHashSHA256(const string& buffer) {
+#ifdef __x86_64__
+    if (_SCPU.sha && _SCPU.sse41) {
+        return _SHashWithBlocks<8>(_SSHA256Blocks, {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+                                                    0x9b05688c, 0x1f83d9ab, 0x5be0cd19}, buffer);
+    }
+#endif
     string result;
     result.resize(32);
     mbedtls_sha256((unsigned char*)buffer.c_str(), buffer.size(), (unsigned char*)&result[0], 0);
@@ -2270,14 +2710,39 @@ string SHashSHA256(const string& buffer) {
 // --------------------------------------------------------------------------
 
 string SEncodeBase64(const unsigned char* buffer, int size) {
-    // First, get the required buffer size
-    size_t olen = 0;
-    mbedtls_base64_encode(0, 0, &olen, buffer, size);
-
-    // Next, do the encode
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     string out;
-    out.resize(olen - 1); // -1 because trailing 0 is implied
-    mbedtls_base64_encode((unsigned char*)&out[0], olen, &olen, buffer, size);
+    if (size <= 0) {
+        return out;
+    }
+    out.resize(((size_t)size + 2) / 3 * 4);
+    char* dest = &out[0];
+    size_t c = 0;
+#ifdef __x86_64__
+    if (_SCPU.ssse3) {
+        c = _SEncodeBase64Blocks(buffer, size, dest);
+        dest += c / 3 * 4;
+    }
+#endif
+    for (; c + 3 <= (size_t)size; c += 3, dest += 4) {
+        uint32_t group = (buffer[c] << 16) | (buffer[c + 1] << 8) | buffer[c + 2];
+        dest[0] = alphabet[group >> 18];
+        dest[1] = alphabet[(group >> 12) & 0x3F];
+        dest[2] = alphabet[(group >> 6) & 0x3F];
+        dest[3] = alphabet[group & 0x3F];
+    }
+
+    // And pad out whatever's left.
+    if (c < (size_t)size) {
+        uint32_t group = buffer[c] << 16;
+        if (c + 1 < (size_t)size) {
+            group |= buffer[c + 1] << 8;
+        }
+        dest[0] = alphabet[group >> 18];
+        dest[1] = alphabet[(group >> 12) & 0x3F];
+        dest[2] = c + 1 < (size_t)size ? alphabet[(group >> 6) & 0x3F] : '=';
+        dest[3] = '=';
+    }
     return out;
 }
 
@@ -2286,13 +2751,63 @@ string SEncodeBase64(const string& bufferString) {
 }
 
 // --------------------------------------------------------------------------
+// Decodes canonical base64 (full four character groups, padding only at the very end) into `out`. Returns false for
+// anything else, which is left to mbedtls so that whitespace, bad characters, and missing padding all behave exactly as
+// they always have.
+static bool _SDecodeBase64Canonical(const unsigned char* buffer, size_t size, string& out) {
+    static const array<int8_t, 256> values = []() {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        array<int8_t, 256> table;
+        table.fill(-1);
+        for (int i = 0; i < 64; i++) {
+            table[(unsigned char)alphabet[i]] = i;
+        }
+        return table;
+    }();
+
+    if (size == 0 || size % 4) {
+        return false;
+    }
+    size_t padding = (buffer[size - 1] == '=') + (buffer[size - 1] == '=' && buffer[size - 2] == '=');
+    out.resize(size / 4 * 3 - padding);
+    char* dest = &out[0];
+    size_t fullGroups = size / 4 - (padding ? 1 : 0);
+    for (size_t group = 0; group < fullGroups; group++, buffer += 4, dest += 3) {
+        int a = values[buffer[0]], b = values[buffer[1]], c = values[buffer[2]], d = values[buffer[3]];
+        if ((a | b | c | d) < 0) {
+            return false;
+        }
+        uint32_t bits = (a << 18) | (b << 12) | (c << 6) | d;
+        dest[0] = (char)(bits >> 16);
+        dest[1] = (char)(bits >> 8);
+        dest[2] = (char)bits;
+    }
+    if (padding) {
+        int a = values[buffer[0]], b = values[buffer[1]], c = padding == 1 ? values[buffer[2]] : 0;
+        if ((a | b | c) < 0) {
+            return false;
+        }
+        uint32_t bits = (a << 18) | (b << 12) | (c << 6);
+        dest[0] = (char)(bits >> 16);
+        if (padding == 1) {
+            dest[1] = (char)(bits >> 8);
+        }
+    }
+    return true;
+}
+
 string SDecodeBase64(const unsigned char* buffer, int size) {
+    string out;
+    if (size > 0 && _SDecodeBase64Canonical(buffer, size, out)) {
+        return out;
+    }
+
     // First, get the required buffer size
     size_t olen = 0;
     mbedtls_base64_decode(0, 0, &olen, buffer, size);
 
     // Next, do the decode
-    string out;
+    out.clear();
     out.resize(olen);
     mbedtls_base64_decode((unsigned char*)&out[0], olen, &olen, buffer, size);
     return out;
@@ -13,6 +13,9 @@
 #include <stdio.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 #include <sys/time.h> // for gettimeofday()
 #include <sys/types.h>
 #include <syslog.h>
@@ -30,7 +33,9 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <random>
 #include <set>
 #include <shared_mutex>
@@ -139,6 +144,7 @@ typedef map<string, SString, STableComp> STable;
 // Libstuff items that must be included here so they are available in the rest of the file
 // However it must be included AFTER the STable definition because SData uses this type.
 #include "SFastBuffer.h"
+#include "SHeaderTable.h"
 #include "SData.h"
 
 // An SException is an exception class that can represent an HTTP-like response, with a method line, headers, and a
@@ -184,7 +190,22 @@ vector<string> SGetCallstack(int depth = 0, void* const* callstack = nullptr) no
 #define STIME_HZ(_HZ_) (STIME_US_PER_S / (_HZ_))
 
 // Various helper time functions
+// Wall clock time, in microseconds since the epoch. Use this for timestamps that get stored, logged, or compared with
+// other machines. `STimeNowCoarse` is much cheaper but only as precise as the kernel tick (a few ms).
 uint64_t STimeNow();
+uint64_t STimeNowCoarse();
+
+// Monotonic time, in microseconds since some arbitrary point (usually boot). Use this for measuring intervals and for
+// local timeouts, as it never jumps when the wall clock is adjusted. These values mean nothing outside this process,
+// so don't mix them with `STimeNow` values or send them anywhere.
+uint64_t SMonotonicNow();
+uint64_t SMonotonicNowCoarse();
+
+// A per-thread cached wall clock time, for loops that check lots of timeouts per iteration. `STimeRefresh` updates the
+// cache (and returns the new value), and should be called once at the top of each iteration. `STimeCached` returns the
+// value as of the last refresh on this thread, or the current time if this thread has never refreshed.
+uint64_t STimeRefresh();
+uint64_t STimeCached();
 uint64_t STimeThisMorning(); // Timestamp for this morning at midnight GMT
 int SDaysInMonth(int year, int month);
 string SComposeTime(const string& format, uint64_t when);
@@ -198,7 +219,7 @@ struct SStopwatch {
 
     // Constructors -- If constructed with an alarm, starts out in the
     // ringing state.  If constructed without an alarm, starts out timing
-    // from construction.
+    // from construction. Times are monotonic, see `SMonotonicNow`.
     SStopwatch() {
         start();
         alarmDuration.store(0);
@@ -209,11 +230,11 @@ struct SStopwatch {
     }
 
     // Accessors
-    uint64_t elapsed() { return STimeNow() - startTime.load(); }
-    uint64_t ringing() { return alarmDuration.load() && (elapsed() > alarmDuration.load()); }
+    uint64_t elapsed() { return SMonotonicNow() - startTime.load(); }
+    uint64_t ringing() { return alarmDuration.load() && (!startTime.load() || elapsed() > alarmDuration.load()); }
 
     // Mutators
-    void start() { startTime.store(STimeNow()); }
+    void start() { startTime.store(SMonotonicNow()); }
     bool ding() {
         if (!ringing())
             return false;
@@ -258,20 +279,58 @@ inline void SLogLevel(int level) {
     setlogmask(_g_SLogMask);
 }
 
+// Returns whether a message at `priority` would currently be logged. This is checked before any of the work of
+// building the message is done, so it's just a relaxed load; a thread may see a level change slightly late.
+inline bool SLogEnabled(int priority) {
+    return _g_SLogMask.load(memory_order_relaxed) & (1 << priority);
+}
+
+// The least severe priority that's compiled in at all. Log lines less severe than this are removed by the compiler, and
+// can't be re-enabled at runtime. Defaults to everything; release builds can pass e.g. `-DSLOG_COMPILE_LEVEL=LOG_INFO`
+// to strip SDEBUG.
+#ifndef SLOG_COMPILE_LEVEL
+#define SLOG_COMPILE_LEVEL LOG_DEBUG
+#endif
+
 // Stack trace logging
 void SLogStackTrace();
 
+// Writes a single line to the log. If asynchronous logging has been started, this just queues the line for the logging
+// thread and returns; otherwise it's written directly, to the log file if one is open, or syslog.
+void SLogWrite(int priority, string&& line);
+
+// Starts asynchronous logging. After this, log lines are queued in a per-thread lock-free ring and written by a
+// background thread, to `filename` if given, or syslog otherwise. If a thread's ring fills up, lines less severe than
+// LOG_WARNING are dropped (and the number dropped is logged), and more severe lines are written synchronously.
+void SLogStartAsync(const string& filename = "");
+
+// Stops the logging thread, writes out anything still queued, and goes back to logging synchronously to syslog.
+void SLogStopAsync();
+
+// Sends log lines to `filename` (appending) instead of syslog, whether or not asynchronous logging is running. Returns
+// false, and keeps logging where it was, if the file can't be opened.
+bool SLogOpenFile(const string& filename);
+
+// Closes the log file, if any, and goes back to syslog.
+void SLogCloseFile();
+
+// Writes out anything queued for the logging thread, from the calling thread.
+void SLogFlush();
+
+// Number of log lines dropped because a queue was full, since the last time the logging thread reported it.
+uint64_t SLogDroppedCount();
+
 // **NOTE: rsyslog default max line size is 8k bytes. We split on 7k byte boundaries in order to fit the syslog line prefix and the expanded \r\n to #015#012
 #define SWHEREAMI SThreadLogPrefix + "(" + basename((char*)__FILE__) + ":" + SToStr(__LINE__) + ") " + __FUNCTION__ + " [" + SThreadLogName + "] "
 #define SSYSLOG(_PRI_, _MSG_)                                              \
     do {                                                                   \
-        if (_g_SLogMask & (1 << (_PRI_))) {                                \
+        if ((_PRI_) <= SLOG_COMPILE_LEVEL && SLogEnabled(_PRI_)) {         \
             ostringstream __out;                                           \
             __out << _MSG_ << endl;                                        \
             const string s = __out.str();                                  \
             const string prefix = SWHEREAMI;                               \
             for (size_t i = 0; i < s.size(); i += 7168) {                  \
-                syslog(_PRI_, "%s", (prefix + s.substr(i, 7168)).c_str()); \
+                SLogWrite(_PRI_, prefix + s.substr(i, 7168));              \
             }                                                              \
         }                                                                  \
     } while (false)
@@ -286,6 +345,7 @@ void SLogStackTrace();
     do {                                                    \
         SSYSLOG(LOG_ERR, "[eror] " << SLOGPREFIX << _MSG_); \
         SLogStackTrace();                                   \
+        SLogFlush();                                        \
         abort();                                            \
     } while (false)
 
@@ -489,6 +549,10 @@ int SParseHTTP(const char* buffer, size_t length, string& methodLine, STable& na
 inline int SParseHTTP(const string& buffer, string& methodLine, STable& nameValueMap, string& content) {
     return SParseHTTP(buffer.c_str(), (int)buffer.size(), methodLine, nameValueMap, content);
 }
+int SParseHTTP(const char* buffer, size_t length, string& methodLine, SHeaderTable& nameValueMap, string& content);
+inline int SParseHTTP(const string& buffer, string& methodLine, SHeaderTable& nameValueMap, string& content) {
+    return SParseHTTP(buffer.c_str(), (int)buffer.size(), methodLine, nameValueMap, content);
+}
 bool SParseRequestMethodLine(const string& methodLine, string& method, string& uri);
 bool SParseResponseMethodLine(const string& methodLine, string& protocol, int& code, string& reason);
 bool SParseURI(const char* buffer, int length, string& host, string& path);
@@ -505,6 +569,12 @@ inline string SComposeHTTP(const string& methodLine, const STable& nameValueMap,
     SComposeHTTP(buffer, methodLine, nameValueMap, content);
     return buffer;
 }
+void SComposeHTTP(string& buffer, const string& methodLine, const SHeaderTable& nameValueMap, const string& content);
+inline string SComposeHTTP(const string& methodLine, const SHeaderTable& nameValueMap, const string& content) {
+    string buffer;
+    SComposeHTTP(buffer, methodLine, nameValueMap, content);
+    return buffer;
+}
 string SComposePOST(const STable& nameValueMap);
 inline string SComposeHost(const string& host, int port) { return (host + ":" + SToStr(port)); }
 bool SParseHost(const string& host, string& domain, uint16_t& port);
@@ -560,17 +630,21 @@ template <typename T> string SComposeList(const T& valueList, const string& sepa
 // JSON message management
 string SToJSON(const string& value, const bool forceString = false);
 
+// Same as SToJSON, but appends to `out` rather than returning a new string, so composing a large object or array
+// doesn't build a temporary for every value.
+void SAppendJSON(string& out, const string& value, const bool forceString = false);
+
 template <typename T>
 string SComposeJSONArray(const T& valueList) {
     if (valueList.empty()) {
         return "[]";
     }
     string working = "[";
-    for (auto value : valueList) {
-        working += SToJSON(value) + ",";
+    for (const auto& value : valueList) {
+        SAppendJSON(working, value);
+        working += ',';
     }
-    working.resize(working.size() - 1);
-    working += "]";
+    working.back() = ']';
     return working;
 }
 
@@ -789,5 +863,6 @@ struct STestTimer {
 #include "SRandom.h"
 #include "SPerformanceTimer.h"
 #include "SSynchronizedQueue.h"
+#include "STimerWheel.h"
 
 #endif	// LIBSTUFF_H
@@ -198,6 +198,9 @@ int main(int argc, char* argv[]) {
         cout << "-version                    Outputs version and exits" << endl;
         cout << "-v                          Enables verbose logging" << endl;
         cout << "-q                          Enables quiet logging" << endl;
+        cout << "-syncLogging                Write each log line from the thread that logs it (default: background thread)"
+             << endl;
+        cout << "-logFile        <filename>  Log to this file instead of syslog (with or without -syncLogging)" << endl;
         cout << "-clean                      Recreate a new database from scratch" << endl;
         cout << "-enableMultiWrite           Enable multi-write mode (default: true)" << endl;
         cout << "-versionOverride <version>  Pretends to be a different version when talking to peers" << endl;
@@ -255,11 +258,21 @@ int main(int argc, char* argv[]) {
         // Verbose logging
         SINFO("Enabling verbose logging");
         SLogLevel(LOG_DEBUG);
+        if (SLOG_COMPILE_LEVEL < LOG_DEBUG) {
+            SWARN("Verbose logging requested, but this build was compiled without debug logging.");
+        }
     } else if (args.isSet("-q")) {
         // Quiet logging
         SLogLevel(LOG_WARNING);
     }
 
+    // Unless asked not to, move log writing off of the threads doing the work. Either way, `-logFile` applies.
+    if (!args.isSet("-syncLogging")) {
+        SLogStartAsync(args["-logFile"]);
+    } else if (!args["-logFile"].empty()) {
+        SLogOpenFile(args["-logFile"]);
+    }
+
 // Set the defaults
 #define SETDEFAULT(_NAME_, _VAL_)                                                                                      \
     do {                                                                                                               \
@@ -339,7 +352,7 @@ int main(int argc, char* argv[]) {
             const uint64_t now = STimeNow();
             auto timeBeforePoll = chrono::steady_clock::now();
             S_poll(fdm, max(nextActivity, now) - now);
-            nextActivity = STimeNow() + STIME_US_PER_S; // 1s max period
+            nextActivity = STimeRefresh() + STIME_US_PER_S; // 1s max period
             auto timeAfterPoll = chrono::steady_clock::now();
             server.postPoll(fdm, nextActivity);
             auto timeAfterPostPoll = chrono::steady_clock::now();
@@ -366,5 +379,6 @@ int main(int argc, char* argv[]) {
 
     // All done
     SINFO("Graceful process shutdown complete");
+    SLogStopAsync();
     return 0;
 }
@@ -19,16 +19,21 @@ const set<string, STableComp> BedrockPlugin_Jobs::supportedRequestVerbs = {
     "CancelJob",
     "UpdateJob",
     "RetryJob",
+    "RetryJobs",
     "FinishJob",
+    "FinishJobs",
     "FailJob",
     "DeleteJob",
     "RequeueJobs",
+    "PurgeJobs",
+    "GetJobStats",
+    "BackfillMockRequest",
 };
 
 bool BedrockJobsCommand::canEscalateImmediately(SQLiteCommand& baseCommand) {
     // This is a set of commands that we will escalate to leader without waiting. It's not intended to be complete but
     // to solve the biggest issues we have with slow escalation times (i.e., this is usually a problem for `FinishJob`).
-    static const set<string> commands = {"CreateJob", "CreateJobs", "FinishJob"};
+    static const set<string> commands = {"CreateJob", "CreateJobs", "FinishJob", "FinishJobs"};
     return commands.count(baseCommand.request.methodLine);
 }
 
@@ -52,14 +57,67 @@ class scopedDisableNoopMode {
 };
 
 BedrockJobsCommand::BedrockJobsCommand(SQLiteCommand&& baseCommand, BedrockPlugin_Jobs* plugin) :
-  BedrockCommand(move(baseCommand), plugin, canEscalateImmediately(baseCommand))
+  BedrockCommand(move(baseCommand), plugin, canEscalateImmediately(baseCommand)),
+  _purgedCount(0),
+  _mockRequestBackfillDone(false)
 {
 }
 
+// How many seconds before `now` a "YYYY-MM-DD HH:MM:SS" timestamp is.
+static int64_t secondsSince(const string& timestamp, uint64_t now) {
+    struct tm time = {};
+    if (!strptime(timestamp.c_str(), "%Y-%m-%d %H:%M:%S", &time)) {
+        return 0;
+    }
+    return (int64_t)(now / STIME_US_PER_S) - timegm(&time);
+}
+
+BedrockJobsCommand::~BedrockJobsCommand() {
+    // We can only count a purge once it's been committed, as until then, it might not happen at all (or be processed
+    // again after a conflict).
+    if (complete && _purgedCount) {
+        BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+        plugin->_purgedJobs += _purgedCount;
+        plugin->_purgeBatches++;
+        plugin->_lastPurge = STimeNow();
+    }
+    if (complete && _mockRequestBackfillDone) {
+        static_cast<BedrockPlugin_Jobs*>(_plugin)->_mockRequestBackfilled = true;
+    }
+
+    // The same goes for the round-robin position, which only moves on once the jobs have actually been taken. A
+    // command that fails is complete too, but nothing it did was committed.
+    if (complete && !_roundRobinLastNames.empty() && SStartsWith(response.methodLine, "200")) {
+        BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+        lock_guard<decltype(plugin->_roundRobinMutex)> lock(plugin->_roundRobinMutex);
+        for (const auto& lastName : _roundRobinLastNames) {
+            plugin->_roundRobinLastNames[lastName.first] = lastName.second;
+        }
+    }
+}
+
 BedrockPlugin_Jobs::BedrockPlugin_Jobs(BedrockServer& s) :
     BedrockPlugin(s),
-    isLive(server.args.isSet("-live"))
+    isLive(server.args.isSet("-live")),
+    _readyIndex([this]() { _jobsAdded(); }),
+    _releasePending(false),
+    _waitingCommandTimer(STIME_US_PER_S),
+    _purgeRetention(min(max(SToInt64(server.args["-jobs.retention"]), (int64_t)0), (int64_t)(STimeNow() / STIME_US_PER_S))),
+    _purgeBatchSize(server.args.isSet("-jobs.purgeBatchSize") ? max(SToInt64(server.args["-jobs.purgeBatchSize"]), (int64_t)1) : 1000),
+    _purgeTimer((server.args.isSet("-jobs.purgeInterval") ? max(SToInt64(server.args["-jobs.purgeInterval"]), (int64_t)1) : 10) * STIME_US_PER_S),
+    _purgedJobs(0),
+    _purgeBatches(0),
+    _lastPurge(0),
+    _mockRequestBackfilled(false),
+    _mockRequestBackfillTimer(STIME_US_PER_S)
 {
+    timers.insert(&_waitingCommandTimer);
+    timers.insert(&_mockRequestBackfillTimer);
+    if (_purgeRetention) {
+        SINFO("Purging jobs finished more than " << _purgeRetention << "s ago, up to " << _purgeBatchSize
+              << " at a time.");
+        timers.insert(&_purgeTimer);
+    }
 }
 
 unique_ptr<BedrockCommand> BedrockPlugin_Jobs::getCommand(SQLiteCommand&& baseCommand) {
@@ -71,7 +129,9 @@ unique_ptr<BedrockCommand> BedrockPlugin_Jobs::getCommand(SQLiteCommand&& baseCo
 
 int64_t BedrockPlugin_Jobs::getNextID(SQLite& db)
 {
-    int64_t newID = 0;
+    // If we can't get an ID from a reserved block, we fall back to picking random ones until we find one that isn't in
+    // use.
+    int64_t newID = _idAllocator.next(db);
     while (!newID) {
         // Make sure this fits even in a signed int64_t, and is positive.
         newID = SRandom::rand64();
@@ -92,24 +152,598 @@ int64_t BedrockPlugin_Jobs::getNextID(SQLite& db)
 void BedrockPlugin_Jobs::upgradeDatabase(SQLite& db) {
     // Create or verify the jobs table
     bool ignore;
-    SASSERT(db.verifyTable("jobs",
-                           "CREATE TABLE jobs ( "
-                               "created     TIMESTAMP NOT NULL, "
-                               "jobID       INTEGER NOT NULL PRIMARY KEY, "
-                               "state       TEXT NOT NULL, "
-                               "name        TEXT NOT NULL, "
-                               "nextRun     TIMESTAMP NOT NULL, "
-                               "lastRun     TIMESTAMP, "
-                               "repeat      TEXT NOT NULL, "
-                               "data        TEXT NOT NULL, "
-                               "priority    INTEGER NOT NULL DEFAULT " + SToStr(JOBS_DEFAULT_PRIORITY) + ", "
-                               "parentJobID INTEGER NOT NULL DEFAULT 0, "
-                               "retryAfter  TEXT NOT NULL DEFAULT \"\")",
-                           ignore));
+    const string jobsSchema = "CREATE TABLE jobs ( "
+                              "created     TIMESTAMP NOT NULL, "
+                              "jobID       INTEGER NOT NULL PRIMARY KEY, "
+                              "state       TEXT NOT NULL, "
+                              "name        TEXT NOT NULL, "
+                              "nextRun     TIMESTAMP NOT NULL, "
+                              "lastRun     TIMESTAMP, "
+                              "repeat      TEXT NOT NULL, "
+                              "data        TEXT NOT NULL, "
+                              "priority    INTEGER NOT NULL DEFAULT " + SToStr(JOBS_DEFAULT_PRIORITY) + ", "
+                              "parentJobID INTEGER NOT NULL DEFAULT 0, "
+                              "retryAfter  TEXT NOT NULL DEFAULT \"\", "
+                              "mockRequest INTEGER NOT NULL DEFAULT 0)";
+
+    // A one row, one column table with the jobID to carry on filling in `mockRequest` from, while there are still jobs
+    // it hasn't been filled in for.
+    SASSERT(db.verifyTable("jobsMockRequestBackfill", "CREATE TABLE jobsMockRequestBackfill ( nextJobID INTEGER NOT NULL )", ignore));
+    if (!db.verifyTable("jobs", jobsSchema, ignore)) {
+        // Older tables don't have the `mockRequest` column, which caches whether each job's data says it's mocked, so
+        // GetJob doesn't need to parse the data of every job it looks at. Add it, and fill it in for existing jobs.
+        SASSERT(db.addColumn("jobs", "mockRequest", "INTEGER NOT NULL DEFAULT 0"));
+        SASSERT(db.verifyTable("jobs", jobsSchema, ignore));
+        SASSERT(db.write("INSERT INTO jobsMockRequestBackfill VALUES ( 0 );"));
+    }
+
+    // Filling in `mockRequest` scans the whole table, so like building indexes, we don't do that here on live
+    // databases. Instead, leader does it a batch at a time with BackfillMockRequest.
+    if (!BedrockPlugin_Jobs::isLive && !db.read("SELECT 1 FROM jobsMockRequestBackfill;").empty()) {
+        SASSERT(db.write("UPDATE jobs SET mockRequest = 1 WHERE JSON_EXTRACT(data, '$.mockRequest') IS NOT NULL;"));
+        SASSERT(db.write("DELETE FROM jobsMockRequestBackfill;"));
+    }
+
     // verify and conditionally create indexes
     SASSERT(db.verifyIndex("jobsName", "jobs", "( name )", false, !BedrockPlugin_Jobs::isLive));
     SASSERT(db.verifyIndex("jobsParentJobIDState", "jobs", "( parentJobID, state ) WHERE parentJobID != 0", false, !BedrockPlugin_Jobs::isLive));
-    SASSERT(db.verifyIndex("jobsStatePriorityNextRunName", "jobs", "( state, priority, nextRun, name )", false, !BedrockPlugin_Jobs::isLive));
+
+    // GetJob filters on `mockRequest` along with these, so it's in the index too. This replaces
+    // jobsStatePriorityNextRunName, which didn't have it, but we don't build indexes on live databases, so until someone
+    // creates the new one by hand, we keep using the old one.
+    if (db.verifyIndex("jobsStatePriorityMockRequestNextRunName", "jobs", "( state, priority, mockRequest, nextRun, name )", false, !BedrockPlugin_Jobs::isLive)) {
+        SASSERT(db.write("DROP INDEX IF EXISTS jobsStatePriorityNextRunName;"));
+    } else {
+        SWARN("Missing index jobsStatePriorityMockRequestNextRunName, using jobsStatePriorityNextRunName instead.");
+        SASSERT(db.verifyIndex("jobsStatePriorityNextRunName", "jobs", "( state, priority, nextRun, name )", false, false));
+    }
+
+    // PurgeJobs looks up jobs that are done by when they last ran, so each batch only looks at jobs that are old enough
+    // to purge, however many newer ones there are. Only jobs that are done are in it, so changes to the rest don't
+    // touch it.
+    if (!db.verifyIndex("jobsDoneStateLastRun", "jobs", "( state, COALESCE(lastRun, created) ) WHERE state IN ('FINISHED', 'FAILED', 'CANCELLED')", false, !BedrockPlugin_Jobs::isLive)) {
+        SWARN("Missing index jobsDoneStateLastRun, PurgeJobs will look at every job that's done.");
+    }
+
+    // Add a one row, one column table with the start of the next block of job IDs to reserve.
+    SASSERT(db.verifyTable("jobIDSequence", "CREATE TABLE jobIDSequence ( nextJobID INTEGER NOT NULL )", ignore));
+    SQResult result;
+    SASSERT(db.read("SELECT * FROM jobIDSequence;", result));
+    if (result.empty()) {
+        SASSERT(db.write("INSERT INTO jobIDSequence VALUES ( 1 );"));
+    }
+}
+
+void BedrockPlugin_Jobs::onDatabaseOpen(SQLite& db) {
+    _idAllocator.open(db);
+    if (_readyIndex.open(db)) {
+        SINFO("Built ready job index with " << _readyIndex.size() << " jobs.");
+    } else {
+        SWARN("Couldn't read jobs, not using ready job index.");
+    }
+    if (!_stats.open(db)) {
+        SWARN("Couldn't count jobs, job stats unavailable.");
+    }
+}
+
+void BedrockPlugin_Jobs::onDatabaseClose(SQLite& db) {
+    _stats.close(db);
+    _readyIndex.close(db);
+    _idAllocator.close(db);
+}
+
+void BedrockPlugin_Jobs::timerFired(SStopwatch* timer) {
+    if (timer == &_waitingCommandTimer) {
+        _releaseWaitingCommands();
+    } else if (timer == &_purgeTimer && server.getState() == SQLiteNode::LEADING) {
+        // Only leader purges, and it does so like any other write, so the deletes are replicated. Each batch is its own
+        // small transaction, so it never holds up other commands for long, and the interval between them limits how
+        // much of the commit rate we use.
+        SData purge("PurgeJobs");
+        purge["olderThan"] = to_string(_purgeRetention);
+        purge["limit"] = to_string(_purgeBatchSize);
+        auto cmd = make_unique<SQLiteCommand>(move(purge));
+        cmd->initiatingClientID = -1;
+        server.acceptCommand(move(cmd));
+    } else if (timer == &_mockRequestBackfillTimer && !_mockRequestBackfilled && server.getState() == SQLiteNode::LEADING) {
+        // Like purging, each batch is its own small replicated transaction. This stops once one of them finds there's
+        // nothing left to fill in.
+        SData backfill("BackfillMockRequest");
+        backfill["limit"] = to_string(MOCK_REQUEST_BACKFILL_BATCH_SIZE);
+        auto cmd = make_unique<SQLiteCommand>(move(backfill));
+        cmd->initiatingClientID = -1;
+        server.acceptCommand(move(cmd));
+    }
+}
+
+STable BedrockPlugin_Jobs::getInfo() {
+    STable info;
+    info["purgedJobs"] = to_string(_purgedJobs.load());
+    info["purgeBatches"] = to_string(_purgeBatches.load());
+    uint64_t lastPurge = _lastPurge.load();
+    info["lastPurge"] = lastPurge ? SComposeTime("%Y-%m-%d %H:%M:%S", lastPurge) : "";
+
+    // The number of jobs in each state, and how long the job that's been ready to run the longest has been waiting, for
+    // monitoring. GetJobStats breaks these down by name.
+    map<BedrockJobsStats::Key, int64_t> counts;
+    if (_stats.get("", counts)) {
+        map<string, int64_t> stateCounts;
+        for (const auto& count : counts) {
+            stateCounts[get<1>(count.first)] += count.second;
+        }
+        STable jobCounts;
+        for (const auto& count : stateCounts) {
+            jobCounts[count.first] = to_string(count.second);
+        }
+        info["jobCounts"] = SComposeJSONObject(jobCounts);
+    }
+    const uint64_t now = STimeNow();
+    map<string, string> nextRuns;
+    if (_readyIndex.findOldestReady("", SComposeTime("%Y-%m-%d %H:%M:%S", now), nextRuns)) {
+        int64_t oldest = 0;
+        for (const auto& nextRun : nextRuns) {
+            oldest = max(oldest, secondsSince(nextRun.second, now));
+        }
+        info["oldestReadyJobAge"] = to_string(oldest);
+    }
+    return info;
+}
+
+void BedrockPlugin_Jobs::_jobsAdded() {
+    if (!_releasePending.exchange(true)) {
+        server.runOnSyncThread([this]() {
+            _releasePending = false;
+            _releaseWaitingCommands();
+        });
+    }
+}
+
+void BedrockPlugin_Jobs::_releaseWaitingCommands() {
+    // Every command we release is going to take at least one job, so each one claims the jobs it would take, and the
+    // rest only see what's left. That way, one new job wakes one command, rather than all of them.
+    set<int64_t> claimed;
+    server.releaseHeldCommands(*this, [&claimed](BedrockCommand& command) {
+        return static_cast<BedrockJobsCommand&>(command)._claimReadyJobs(claimed);
+    });
+}
+
+// ==========================================================================
+// The columns of `jobs` the ready index watches, by their position in the table: state, name, nextRun, priority,
+// mockRequest.
+static const vector<int> READY_INDEX_COLUMNS = {2, 3, 4, 8, 11};
+
+// What goes in the `mockRequest` column for a job with this data. The same test as
+// `JSON_EXTRACT(data, '$.mockRequest') IS NOT NULL`, but without parsing the data in the usual case that it can't
+// possibly match.
+static bool isMockedJobData(const string& data) {
+    if (data.find("mockRequest") == string::npos) {
+        return false;
+    }
+    STable parsed = SParseJSONObject(data);
+    auto it = parsed.find("mockRequest");
+    return it != parsed.end() && it->second != "null";
+}
+
+BedrockJobsReadyIndex::BedrockJobsReadyIndex(function<void()> jobsAdded) : _ready(false), _jobsAdded(move(jobsAdded))
+{
+}
+
+bool BedrockJobsReadyIndex::open(SQLite& db) {
+    close(db);
+    db.addRowChangeListener(*this, "jobs", READY_INDEX_COLUMNS);
+
+    // We read inside a transaction, which we roll back, so that the (possibly very large) result doesn't stay in the
+    // query cache. Until leader creates the jobs table, there's nothing to index, but once it exists, we'll see jobs
+    // as they're added. This happens before the DB is upgraded, so we can't rely on the `mockRequest` column yet.
+    SQResult result;
+    if (!db.beginTransaction()) {
+        return false;
+    }
+    bool exists = !db.read("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'jobs';").empty();
+    bool success = !exists || db.read("SELECT jobID, name, priority, nextRun, JSON_EXTRACT(data, '$.mockRequest') IS NOT NULL "
+                                      "FROM jobs "
+                                      "WHERE state IN ('QUEUED', 'RUNQUEUED');",
+                                      result);
+    db.rollback();
+    if (!success) {
+        return false;
+    }
+    unique_lock<decltype(_indexMutex)> lock(_indexMutex);
+    for (auto& row : result.rows) {
+        _add(SToInt64(row[0]), {row[1], SToInt64(row[2]), row[3], row[4] == "1"});
+    }
+    _ready = true;
+    return true;
+}
+
+void BedrockJobsReadyIndex::close(SQLite& db) {
+    _ready = false;
+    db.removeRowChangeListener(*this);
+    {
+        lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+        _pendingChanges.clear();
+    }
+    unique_lock<decltype(_indexMutex)> lock(_indexMutex);
+    _jobs.clear();
+    _queues.clear();
+}
+
+size_t BedrockJobsReadyIndex::size() const {
+    shared_lock<decltype(_indexMutex)> lock(_indexMutex);
+    return _jobs.size();
+}
+
+bool BedrockJobsReadyIndex::findReady(const list<string>& names, int64_t priority, bool includeMocked,
+                                      const map<int64_t, string>* roundRobinAfter, const string& now, size_t limit,
+                                      list<int64_t>& jobIDs) const {
+    if (!_ready.load()) {
+        return false;
+    }
+    shared_lock<decltype(_indexMutex)> lock(_indexMutex);
+
+    // Find the queues for all the names we're looking for, in name order.
+    list<const pair<const string, map<pair<bool, int64_t>, Queue>>*> nameQueues;
+    if (names.size() > 1) {
+        for (const auto& name : set<string>(names.begin(), names.end())) {
+            auto it = _queues.find(name);
+            if (it != _queues.end()) {
+                nameQueues.push_back(&*it);
+            }
+        }
+    } else if (!names.empty()) {
+        const string& pattern = names.front();
+        if (pattern.find_first_of("*?[") == string::npos) {
+            auto it = _queues.find(pattern);
+            if (it != _queues.end()) {
+                nameQueues.push_back(&*it);
+            }
+        } else {
+            for (const auto& queues : _queues) {
+                if (!sqlite3_strglob(pattern.c_str(), queues.first.c_str())) {
+                    nameQueues.push_back(&queues);
+                }
+            }
+        }
+    }
+
+    // Take the earliest ready jobs at each priority, highest first, across all the queues.
+    list<int64_t> priorities = {1000, 500, 0};
+    if (priority >= 0) {
+        priorities = {priority};
+    }
+    for (int64_t queuePriority : priorities) {
+        // The earliest ready jobs of each name, in nextRun order, by name.
+        vector<pair<const string*, vector<pair<string, int64_t>>>> readyByName;
+        size_t remaining = limit - jobIDs.size();
+        for (auto queues : nameQueues) {
+            vector<pair<string, int64_t>> nameReady;
+            for (bool mocked : {false, true}) {
+                if (mocked && !includeMocked) {
+                    continue;
+                }
+                auto queueIt = queues->second.find(make_pair(mocked, queuePriority));
+                if (queueIt == queues->second.end()) {
+                    continue;
+                }
+                size_t count = 0;
+                for (auto entry = queueIt->second.begin(); entry != queueIt->second.end() && entry->first <= now && count < remaining; entry++, count++) {
+                    nameReady.push_back(*entry);
+                }
+            }
+            if (!nameReady.empty()) {
+                sort(nameReady.begin(), nameReady.end());
+                readyByName.emplace_back(&queues->first, move(nameReady));
+            }
+        }
+
+        // Round-robin takes a turn from each name before any name gets a second one, so that one name with a big
+        // backlog can't hold up all the others. The names take their turns in order, starting after the last one that
+        // had one, so that even taking one job at a time, every name gets its turn. Otherwise, it's just the earliest of
+        // all of them.
+        vector<pair<string, int64_t>> ready;
+        if (roundRobinAfter) {
+            auto afterIt = roundRobinAfter->find(queuePriority);
+            if (afterIt != roundRobinAfter->end()) {
+                auto first = find_if(readyByName.begin(), readyByName.end(), [&afterIt](const auto& nameReady) {
+                    return *nameReady.first > afterIt->second;
+                });
+                rotate(readyByName.begin(), first, readyByName.end());
+            }
+            for (size_t turn = 0; ready.size() < remaining; turn++) {
+                size_t roundStart = ready.size();
+                for (const auto& nameReady : readyByName) {
+                    if (turn < nameReady.second.size()) {
+                        ready.push_back(nameReady.second[turn]);
+                    }
+                }
+                if (ready.size() == roundStart) {
+                    break;
+                }
+            }
+        } else {
+            for (const auto& nameReady : readyByName) {
+                ready.insert(ready.end(), nameReady.second.begin(), nameReady.second.end());
+            }
+            sort(ready.begin(), ready.end());
+        }
+        for (size_t i = 0; i < ready.size() && jobIDs.size() < limit; i++) {
+            jobIDs.push_back(ready[i].second);
+        }
+        if (jobIDs.size() == limit) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool BedrockJobsReadyIndex::findOldestReady(const string& pattern, const string& now, map<string, string>& nextRuns) const {
+    if (!_ready.load()) {
+        return false;
+    }
+    shared_lock<decltype(_indexMutex)> lock(_indexMutex);
+    for (const auto& queues : _queues) {
+        if (!pattern.empty() && sqlite3_strglob(pattern.c_str(), queues.first.c_str())) {
+            continue;
+        }
+
+        // Each queue is in nextRun order, so we only need to look at the first job in each.
+        const string* oldest = nullptr;
+        for (const auto& queue : queues.second) {
+            const string& nextRun = queue.second.begin()->first;
+            if (nextRun <= now && (!oldest || nextRun < *oldest)) {
+                oldest = &nextRun;
+            }
+        }
+        if (oldest) {
+            nextRuns[queues.first] = *oldest;
+        }
+    }
+    return true;
+}
+
+void BedrockJobsReadyIndex::rowChanged(SQLite& db, int64_t rowID, const vector<string>& values) {
+    optional<Job> job;
+    if (!values.empty() && (values[0] == "QUEUED" || values[0] == "RUNQUEUED")) {
+        job = Job{values[1], SToInt64(values[3]), values[2], values[4] == "1"};
+    }
+    lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+    _pendingChanges[&db][rowID] = move(job);
+}
+
+void BedrockJobsReadyIndex::transactionComplete(SQLite& db, bool committed) {
+    map<int64_t, optional<Job>> changes;
+    {
+        lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+        auto it = _pendingChanges.find(&db);
+        if (it == _pendingChanges.end()) {
+            return;
+        }
+        changes = move(it->second);
+        _pendingChanges.erase(it);
+    }
+    if (!committed) {
+        return;
+    }
+    bool added = false;
+    {
+        unique_lock<decltype(_indexMutex)> lock(_indexMutex);
+        for (auto& change : changes) {
+            _remove(change.first);
+            if (change.second) {
+                _add(change.first, move(*change.second));
+                added = true;
+            }
+        }
+    }
+    if (added && _jobsAdded) {
+        _jobsAdded();
+    }
+}
+
+// The columns of `jobs` that are counted, by their position in the table: state, name, priority.
+static const vector<int> STATS_COLUMNS = {2, 3, 8};
+
+BedrockJobsStats::BedrockJobsStats() : _ready(false)
+{
+}
+
+bool BedrockJobsStats::open(SQLite& db) {
+    close(db);
+    db.addRowChangeListener(*this, "jobs", STATS_COLUMNS, true);
+
+    // This is the one time we count the whole table. As with the ready index, until leader creates the table, there's
+    // nothing to count.
+    SQResult result;
+    if (!db.beginTransaction()) {
+        return false;
+    }
+    bool exists = !db.read("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'jobs';").empty();
+    bool success = !exists || db.read("SELECT name, state, priority, COUNT(*) FROM jobs GROUP BY name, state, priority;", result);
+    db.rollback();
+    if (!success) {
+        return false;
+    }
+    lock_guard<decltype(_countsMutex)> lock(_countsMutex);
+    for (auto& row : result.rows) {
+        _counts[make_tuple(row[0], row[1], SToInt64(row[2]))] = SToInt64(row[3]);
+    }
+    _ready = true;
+    return true;
+}
+
+void BedrockJobsStats::close(SQLite& db) {
+    _ready = false;
+    db.removeRowChangeListener(*this);
+    {
+        lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+        _pendingChanges.clear();
+    }
+    lock_guard<decltype(_countsMutex)> lock(_countsMutex);
+    _counts.clear();
+}
+
+bool BedrockJobsStats::get(const string& pattern, map<Key, int64_t>& counts) const {
+    if (!_ready.load()) {
+        return false;
+    }
+    lock_guard<decltype(_countsMutex)> lock(_countsMutex);
+    if (pattern.empty()) {
+        counts = _counts;
+        return true;
+    }
+    for (const auto& count : _counts) {
+        if (!sqlite3_strglob(pattern.c_str(), std::get<0>(count.first).c_str())) {
+            counts.insert(count);
+        }
+    }
+    return true;
+}
+
+void BedrockJobsStats::rowReplaced(SQLite& db, int64_t rowID, const vector<string>& oldValues, const vector<string>& values) {
+    // Most updates don't change any of the columns we count by.
+    if (oldValues == values) {
+        return;
+    }
+    lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+    map<Key, int64_t>& changes = _pendingChanges[&db];
+    if (!oldValues.empty()) {
+        changes[make_tuple(oldValues[1], oldValues[0], SToInt64(oldValues[2]))]--;
+    }
+    if (!values.empty()) {
+        changes[make_tuple(values[1], values[0], SToInt64(values[2]))]++;
+    }
+}
+
+void BedrockJobsStats::transactionComplete(SQLite& db, bool committed) {
+    map<Key, int64_t> changes;
+    {
+        lock_guard<decltype(_pendingChangesMutex)> lock(_pendingChangesMutex);
+        auto it = _pendingChanges.find(&db);
+        if (it == _pendingChanges.end()) {
+            return;
+        }
+        changes = move(it->second);
+        _pendingChanges.erase(it);
+    }
+    if (!committed) {
+        return;
+    }
+    lock_guard<decltype(_countsMutex)> lock(_countsMutex);
+    for (const auto& change : changes) {
+        if (!change.second) {
+            continue;
+        }
+        auto it = _counts.emplace(change.first, 0).first;
+        it->second += change.second;
+        if (!it->second) {
+            _counts.erase(it);
+        }
+    }
+}
+
+void BedrockJobsIDAllocator::open(SQLite& db) {
+    close(db);
+    db.addRowChangeListener(*this, "jobIDSequence", {0});
+}
+
+void BedrockJobsIDAllocator::close(SQLite& db) {
+    db.removeRowChangeListener(*this);
+    lock_guard<decltype(_blocksMutex)> lock(_blocksMutex);
+    _blocks.clear();
+    _pendingBlocks.clear();
+}
+
+int64_t BedrockJobsIDAllocator::next(SQLite& db) {
+    {
+        lock_guard<decltype(_blocksMutex)> lock(_blocksMutex);
+        for (auto blocks : {&_pendingBlocks, &_blocks}) {
+            auto it = blocks->find(&db);
+            if (it != blocks->end()) {
+                int64_t id = _take(it->second);
+                if (id) {
+                    return id;
+                }
+            }
+        }
+    }
+
+    // We need a new block. Nothing else uses this handle while we're reserving it, so we don't need the lock.
+    SQResult result;
+    if (!db.read("SELECT nextJobID FROM jobIDSequence;", result) || result.empty()) {
+        return 0;
+    }
+    Block block;
+    block.next = SToInt64(result[0][0]);
+    if (block.next <= 0 || block.next > INT64_MAX - BLOCK_SIZE) {
+        return 0;
+    }
+    block.end = block.next + BLOCK_SIZE;
+    if (!db.writeIdempotent("UPDATE jobIDSequence SET nextJobID = " + SQ(block.end) + ";")) {
+        return 0;
+    }
+
+    // Jobs created before we used the sequence have random IDs, and could be in this block.
+    SQResult taken;
+    if (!db.read("SELECT jobID FROM jobs WHERE jobID >= " + SQ(block.next) + " AND jobID < " + SQ(block.end) + ";",
+                 taken)) {
+        return 0;
+    }
+    for (const auto& row : taken.rows) {
+        block.taken.insert(SToInt64(row[0]));
+    }
+    int64_t id = _take(block);
+    {
+        lock_guard<decltype(_blocksMutex)> lock(_blocksMutex);
+        _pendingBlocks[&db] = move(block);
+    }
+
+    // If every ID in the block was already in use, we just move on to the next one.
+    return id ? id : next(db);
+}
+
+void BedrockJobsIDAllocator::transactionComplete(SQLite& db, bool committed) {
+    lock_guard<decltype(_blocksMutex)> lock(_blocksMutex);
+    auto it = _pendingBlocks.find(&db);
+    if (it == _pendingBlocks.end()) {
+        return;
+    }
+    if (committed) {
+        _blocks[&db] = move(it->second);
+    }
+    _pendingBlocks.erase(it);
+}
+
+int64_t BedrockJobsIDAllocator::_take(Block& block) {
+    while (block.next < block.end) {
+        int64_t id = block.next++;
+        if (!block.taken.count(id)) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+void BedrockJobsReadyIndex::_add(int64_t jobID, Job&& job) {
+    _queues[job.name][make_pair(job.mocked, job.priority)].emplace(job.nextRun, jobID);
+    _jobs.emplace(jobID, move(job));
+}
+
+void BedrockJobsReadyIndex::_remove(int64_t jobID) {
+    auto jobIt = _jobs.find(jobID);
+    if (jobIt == _jobs.end()) {
+        return;
+    }
+    const Job& job = jobIt->second;
+    auto nameIt = _queues.find(job.name);
+    auto queueIt = nameIt->second.find(make_pair(job.mocked, job.priority));
+    queueIt->second.erase(make_pair(job.nextRun, jobID));
+    if (queueIt->second.empty()) {
+        nameIt->second.erase(queueIt);
+        if (nameIt->second.empty()) {
+            _queues.erase(nameIt);
+        }
+    }
+    _jobs.erase(jobIt);
 }
 
 // ==========================================================================
@@ -135,6 +769,9 @@ bool BedrockJobsCommand::peek(SQLite& db) {
         //     - numResults - (optional) Optional for GetJob, required for GetJobs. Maximum number of jobs to dequeue.
         //     - connection - (optional) If "wait" will pause up to "timeout" for a match
         //     - jobPriority - (optional) Only check for jobs with this priority
+        //     - order - (optional) "roundRobin" to take jobs of each priority one name at a time, carrying on from
+        //               where the last one left off, rather than strictly in nextRun order, so that no one name can
+        //               starve the rest
         //     - timeout - (optional) maximum time (in ms) to wait, default forever
         //
         //     Returns:
@@ -161,6 +798,20 @@ bool BedrockJobsCommand::peek(SQLite& db) {
             int64_t priority = request.calc64("jobPriority");
             _validatePriority(priority);
         }
+        if (request.isSet("order") && !SIEquals(request["order"], "roundRobin")) {
+            STHROW("402 Invalid order");
+        }
+
+        // If there's nothing ready to run, we can say so without going any further. With "Connection: wait", we wait
+        // until there is instead, and the plugin releases us to be peeked again when a job we could take is ready.
+        list<int64_t> readyJobIDs;
+        if (_isMockRequestBackfilled(db) && _findReadyJobs(1, readyJobIDs) && readyJobIDs.empty()) {
+            if (SIEquals(request["Connection"], "wait") && !initiatingPeerID) {
+                hold("303 Timeout");
+                return true;
+            }
+            STHROW("404 No job found");
+        }
 
         return false;
     }
@@ -212,33 +863,58 @@ bool BedrockJobsCommand::peek(SQLite& db) {
         return true; // Successfully processed
     }
 
+    // ----------------------------------------------------------------------
+    else if (SIEquals(requestVerb, "GetJobStats")) {
+        // - GetJobStats( [name] )
+        //
+        //     Returns how many jobs there are of each name, state and priority, and how long the oldest job of each
+        //     name that's ready to run has been waiting. These are kept up to date in memory as jobs change, so this
+        //     doesn't read the jobs table, and is cheap enough to call while there's a backlog.
+        //
+        //     Parameters:
+        //     - name - (optional) Only include jobs with names matching this GLOB pattern
+        //
+        //     Returns:
+        //     - 200 - OK
+        //         . stats - Array of JSON objects, one for each name, state and priority that has jobs, with the count
+        //         . oldestReady - JSON object of names to the number of seconds since the nextRun of the oldest job of
+        //           that name that's ready to run
+        //     - 502 - Job stats aren't available
+        //
+        BedrockPlugin::verifyAttributeSize(request, "name", 0, BedrockPlugin_Jobs::MAX_SIZE_NAME);
+        BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+        map<BedrockJobsStats::Key, int64_t> counts;
+        const uint64_t now = STimeNow();
+        map<string, string> nextRuns;
+        if (!plugin->_stats.get(request["name"], counts) ||
+            !plugin->_readyIndex.findOldestReady(request["name"], SComposeTime("%Y-%m-%d %H:%M:%S", now), nextRuns)) {
+            STHROW("502 Job stats unavailable");
+        }
+        list<string> stats;
+        for (const auto& count : counts) {
+            STable stat;
+            stat["name"] = get<0>(count.first);
+            stat["state"] = get<1>(count.first);
+            stat["priority"] = to_string(get<2>(count.first));
+            stat["count"] = to_string(count.second);
+            stats.push_back(SComposeJSONObject(stat));
+        }
+        STable oldestReady;
+        for (const auto& nextRun : nextRuns) {
+            oldestReady[nextRun.first] = to_string(secondsSince(nextRun.second, now));
+        }
+        jsonContent["stats"] = SComposeJSONArray(stats);
+        jsonContent["oldestReady"] = SComposeJSONObject(oldestReady);
+        return true;
+    }
+
     // ----------------------------------------------------------------------
     else if (SIEquals(requestVerb, "CreateJob") || SIEquals(requestVerb, "CreateJobs")) {
-        list<STable> jsonJobs;
         if (SIEquals(requestVerb, "CreateJob")) {
             BedrockPlugin::verifyAttributeSize(request, "name", 1, BedrockPlugin_Jobs::MAX_SIZE_SMALL);
-            jsonJobs.push_back(request.nameValueMap);
-        } else {
-            list<string> multipleJobs;
-            multipleJobs = SParseJSONArray(request["jobs"]);
-            if (multipleJobs.empty()) {
-                STHROW("401 Invalid JSON");
-            }
-
-            for (auto& job : multipleJobs) {
-                STable jobObject = SParseJSONObject(job);
-                if (jobObject.empty()) {
-                    STHROW("401 Invalid JSON");
-                }
-
-                // Verify that name is present for every job
-                if (!SContains(job, "name")) {
-                    STHROW("402 Missing name");
-                }
-
-                jsonJobs.push_back(jobObject);
-            }
         }
+        list<STable> jsonJobs = _getJobs();
+        map<int64_t, vector<string>> parentJobs = _readParentJobs(db, jsonJobs, "state, data");
 
         for (auto& job : jsonJobs) {
             // If no priority set, set it
@@ -267,15 +943,13 @@ bool BedrockJobsCommand::peek(SQLite& db) {
             int64_t parentJobID = SContains(job, "parentJobID") ? SToInt64(job["parentJobID"]) : 0;
             if (parentJobID) {
                 SINFO("parentJobID passed, checking existing job with ID " << parentJobID);
-                SQResult result;
-                if (!db.read("SELECT state, data FROM jobs WHERE jobID=" + SQ(parentJobID) + ";", result)) {
-                    STHROW("502 Select failed");
-                }
-                if (result.empty()) {
+                auto parentIt = parentJobs.find(parentJobID);
+                if (parentIt == parentJobs.end()) {
                     STHROW("404 parentJobID does not exist");
                 }
-                if (!SIEquals(result[0][0], "RUNNING") && !SIEquals(result[0][0], "RUNQUEUED") && !SIEquals(result[0][0], "PAUSED")) {
-                    SWARN("Trying to create child job with parent jobID#" << parentJobID << ", but parent isn't RUNNING or PAUSED (" << result[0][0] << ")");
+                const vector<string>& parent = parentIt->second;
+                if (!SIEquals(parent[0], "RUNNING") && !SIEquals(parent[0], "RUNQUEUED") && !SIEquals(parent[0], "PAUSED")) {
+                    SWARN("Trying to create child job with parent jobID#" << parentJobID << ", but parent isn't RUNNING or PAUSED (" << parent[0] << ")");
                     STHROW("405 Can only create child job when parent is RUNNING, RUNQUEUED or PAUSED");
                 }
 
@@ -283,8 +957,7 @@ bool BedrockJobsCommand::peek(SQLite& db) {
                 // not. Note that this is the first place we'll look at `mockRequest` while handling this command so
                 // any change made here will happen early enough for all of our existing checks to work correctly, and
                 // everything should be good when we get to `processCommand`.
-                STable parentData = SParseJSONObject(result[0][1]);
-                bool parentIsMocked = parentData.find("mockRequest") != parentData.end();
+                bool parentIsMocked = isMockedJobData(parent[1]);
                 bool childIsMocked = request.isSet("mockRequest");
 
                 if (parentIsMocked && !childIsMocked) {
@@ -301,11 +974,10 @@ bool BedrockJobsCommand::peek(SQLite& db) {
                 SQResult result;
                 SINFO("Unique flag was passed, checking existing job with name " << job["name"] << ", mocked? "
                       << (mockRequest ? "true" : "false"));
-                string operation = mockRequest ? "IS NOT" : "IS";
                 if (!db.read("SELECT jobID, data "
                              "FROM jobs "
                              "WHERE name=" + SQ(job["name"]) +
-                             "  AND JSON_EXTRACT(data, '$.mockRequest') " + operation + " NULL;",
+                             "  AND " + _mockedSQL(db) + " = " + (mockRequest ? "1" : "0") + ";",
                              result)) {
                     STHROW("502 Select failed");
                 }
@@ -428,33 +1100,53 @@ void BedrockJobsCommand::process(SQLite& db) {
         //     - jobIDs - array with the unique identifier of the jobs
         //
 
-        list<STable> jsonJobs;
-        if (SIEquals(requestVerb, "CreateJob")) {
-            jsonJobs.push_back(request.nameValueMap);
-        } else {
-            list<string> multipleJobs;
-            multipleJobs = SParseJSONArray(request["jobs"]);
-            if (multipleJobs.empty()) {
-                STHROW("401 Invalid JSON");
-            }
-
-            for (auto& job : multipleJobs) {
-                STable jobObject = SParseJSONObject(job);
-                if (jobObject.empty()) {
-                    STHROW("401 Invalid JSON");
-                }
+        list<STable> jsonJobs = _getJobs();
 
-                jsonJobs.push_back(jobObject);
+        // Look up everything we need to know about existing jobs up front, with one query for each kind of thing
+        // rather than one per job: the parents of any child jobs, and the jobs that already have the names of any
+        // unique ones.
+        map<int64_t, vector<string>> parentJobs = _readParentJobs(db, jsonJobs, "state, parentJobID, data");
+        set<string> uniqueNames;
+        for (auto& job : jsonJobs) {
+            if (SContains(job, "unique") && job["unique"] == "true") {
+                uniqueNames.insert(job["name"]);
+            }
+        }
+        map<string, pair<int64_t, string>> existingJobsByName;
+        if (!uniqueNames.empty()) {
+            SQResult result;
+            SINFO("Unique flag was passed, checking existing jobs with " << uniqueNames.size() << " names, mocked? "
+                  << (mockRequest ? "true" : "false"));
+            if (!db.read("SELECT name, jobID, data "
+                         "FROM jobs "
+                         "WHERE name IN (" + SQList(uniqueNames) + ") "
+                         "  AND " + _mockedSQL(db) + " = " + (mockRequest ? "1" : "0") + ";",
+                         result)) {
+                STHROW("502 Select failed");
+            }
+            for (auto& row : result.rows) {
+                existingJobsByName.emplace(row[0], make_pair(SToInt64(row[1]), move(row[2])));
             }
         }
 
+        // New jobs are inserted this many at a time, with one multi-row INSERT, which is much less work than an
+        // INSERT for each, and a much smaller journal entry.
+        static const size_t INSERT_BATCH_SIZE = 500;
+        const string created = SCURRENT_TIMESTAMP();
+        string insertValues;
+        size_t insertCount = 0;
+        auto insertJobs = [&]() {
+            if (insertCount && !db.writeIdempotent("INSERT INTO jobs ( jobID, created, state, name, nextRun, repeat, data, priority, parentJobID, retryAfter, mockRequest ) "
+                                                   "VALUES " + insertValues + ";")) {
+                STHROW("502 insert query failed");
+            }
+            insertValues.clear();
+            insertCount = 0;
+        };
+
         list<string> jobIDs;
         for (auto& job : jsonJobs) {
-            // If unique flag was passed and the job exist in the DB, then we can finish the command without escalating to
-            // leader.
-
             // If this is a mock request, we insert that into the data.
-            string originalData = job["data"];
             if (mockRequest) {
                 // Mocked jobs should never repeat.
                 job.erase("repeat");
@@ -468,56 +1160,30 @@ void BedrockJobsCommand::process(SQLite& db) {
                 }
             }
 
+            // If unique flag was passed and the job exists in the DB with the same data, then we just return it.
             int64_t updateJobID = 0;
+            auto existingJob = existingJobsByName.end();
             if (SContains(job, "unique") && job["unique"] == "true") {
-                SQResult result;
-                SINFO("Unique flag was passed, checking existing job with name " << job["name"] << ", mocked? "
-                      << (mockRequest ? "true" : "false"));
-                string operation = mockRequest ? "IS NOT" : "IS";
-                if (!db.read("SELECT jobID, data "
-                             "FROM jobs "
-                             "WHERE name=" + SQ(job["name"]) +
-                             "  AND JSON_EXTRACT(data, '$.mockRequest') " + operation + " NULL;",
-                             result)) {
-                    STHROW("502 Select failed");
+                existingJob = existingJobsByName.find(job["name"]);
+                if (existingJob != existingJobsByName.end()) {
+                    const string& existingData = existingJob->second.second;
+                    if ((job["data"].empty() && existingData == "{}") || (!job["data"].empty() && existingData == job["data"])) {
+                        SINFO("Job already existed with matching data, and unique flag was passed, reusing existing job "
+                              << existingJob->second.first << ", mocked? " << (mockRequest ? "true" : "false"));
+                        jobIDs.push_back(SToStr(existingJob->second.first));
+                        continue;
+                    }
+
+                    // If we found a job, but the data was different, we'll need to update it.
+                    updateJobID = existingJob->second.first;
                 }
-
-                // If we got a result, and it's data is the same as passed, we won't change anything.
-                if (!result.empty() && ((job["data"].empty() && result[0][1] == "{}") || (!job["data"].empty() && result[0][1] == job["data"]))) {
-                    SINFO("Job already existed with matching data, and unique flag was passed, reusing existing job "
-                          << result[0][0] << ", mocked? " << (mockRequest ? "true" : "false"));
-
-                    // If we are calling CreateJob, return early, there are no more jobs to create.
-                    if (SIEquals(requestVerb, "CreateJob")) {
-                        jsonContent["jobID"] = result[0][0];
-                        return;
-                    }
-
-                    // Append new jobID to list of created jobs.
-                    jobIDs.push_back(result[0][0]);
-                    continue;
-                }
-
-                // If we found a job, but the data was different, we'll need to update it.
-                if (!result.empty()) {
-                    updateJobID = SToInt64(result[0][0]);
-                }
-            }
-
-            // Record whether or not this job is scheduling itself in the future. If so, it's not suitable for
-            // immediate scheduling and won't benefit from disk-access-free assignment to waiting workers.
-            if ((!SContains(job, "repeat") || job["repeat"].empty()) && (!SContains(job, "firstRun") && job["firstRun"].empty())) {
-                SINFO("Job has no run time, can be scheduled immediately.");
-            } else {
-                SINFO("Job specified run time or repeat, not suitable for immediate scheduling.");
-            }
+            }
 
             // If no "firstRun" was provided, use right now
-            const string& safeFirstRun = !SContains(job, "firstRun") || job["firstRun"].empty() ? SCURRENT_TIMESTAMP() : SQ(job["firstRun"]);
+            const string& safeFirstRun = !SContains(job, "firstRun") || job["firstRun"].empty() ? created : SQ(job["firstRun"]);
 
             // If no data was provided, use an empty object
             const string& safeData = !SContains(job, "data") || job["data"].empty() ? SQ("{}") : SQ(job["data"]);
-            const string& safeOriginalData = originalData.empty() ? SQ("{}") : SQ(originalData);
 
             // If a repeat is provided, validate it
             if (SContains(job, "repeat")) {
@@ -538,27 +1204,24 @@ void BedrockJobsCommand::process(SQLite& db) {
 
             // Validate that the parentJobID exists and is in the right state if one was passed.
             int64_t parentJobID = SContains(job, "parentJobID") ? SToInt64(job["parentJobID"]) : 0;
+            auto parentIt = parentJobs.find(parentJobID);
             if (parentJobID) {
-                SQResult result;
-                if (!db.read("SELECT state, parentJobID, data FROM jobs WHERE jobID=" + SQ(parentJobID) + ";", result)) {
-                    STHROW("502 Select failed");
-                }
-                if (result.empty()) {
+                if (parentIt == parentJobs.end()) {
                     STHROW("404 parentJobID does not exist");
                 }
-                if (!SIEquals(result[0][0], "RUNNING") && !SIEquals(result[0][0], "RUNQUEUED") && !SIEquals(result[0][0], "PAUSED")) {
-                    SWARN("Trying to create child job with parent jobID#" << parentJobID << ", but parent isn't RUNNING, RUNQUEUED or PAUSED (" << result[0][0] << ")");
+                const vector<string>& parent = parentIt->second;
+                if (!SIEquals(parent[0], "RUNNING") && !SIEquals(parent[0], "RUNQUEUED") && !SIEquals(parent[0], "PAUSED")) {
+                    SWARN("Trying to create child job with parent jobID#" << parentJobID << ", but parent isn't RUNNING, RUNQUEUED or PAUSED (" << parent[0] << ")");
                     STHROW("405 Can only create child job when parent is RUNNING, RUNQUEUED or PAUSED");
                 }
 
                 // Verify that the parent and child job have the same `mockRequest` setting.
-                STable parentData = SParseJSONObject(result[0][2]);
-                if (mockRequest != (parentData.find("mockRequest") != parentData.end())) {
+                if (mockRequest != isMockedJobData(parent[2])) {
                     STHROW("405 Parent and child jobs must have matching mockRequest setting");
                 }
 
                 // Prevent jobs from creating grandchildren
-                if (!SIEquals(result[0][1], "0")) {
+                if (!SIEquals(parent[1], "0")) {
                     SWARN("Trying to create grandchild job with parent jobID#" << parentJobID);
                     STHROW("405 Cannot create grandchildren");
                 }
@@ -566,21 +1229,25 @@ void BedrockJobsCommand::process(SQLite& db) {
 
             // Are we creating a new job, or updating an existing job?
             if (updateJobID) {
-                // Update the existing job.
+                // The job we're updating might have been created earlier in this same request, in which case it's
+                // still waiting to be inserted, so get it into the table first.
+                insertJobs();
+
+                // Update the existing job. The patch only changes whether it's mocked if it mentions mockRequest.
+                STable patch = SParseJSONObject(job["data"]);
+                bool mocked = patch.count("mockRequest") ? isMockedJobData(job["data"]) : isMockedJobData(existingJob->second.second);
                 if(!db.writeIdempotent("UPDATE jobs SET "
-                                         "repeat   = " + SQ(SToUpper(job["repeat"])) + ", " +
-                                         "data     = JSON_PATCH(data, " + safeData + "), " +
-                                         "priority = " + SQ(priority) + " " +
+                                         "repeat      = " + SQ(SToUpper(job["repeat"])) + ", " +
+                                         "data        = JSON_PATCH(data, " + safeData + "), " +
+                                         "priority    = " + SQ(priority) + ", " +
+                                         "mockRequest = " + (mocked ? "1" : "0") + " " +
                                        "WHERE jobID = " + SQ(updateJobID) + ";"))
                 {
                     STHROW("502 update query failed");
                 }
 
-                // If we are calling CreateJob, return early, there are no more jobs to create.
-                if (SIEquals(requestVerb, "CreateJob")) {
-                    jsonContent["jobID"] = SToStr(updateJobID);
-                    return;
-                }
+                // Later jobs with the same name need to compare against what it is now.
+                existingJob->second.second = db.read("SELECT data FROM jobs WHERE jobID = " + SQ(updateJobID) + ";");
 
                 // Append new jobID to list of created jobs.
                 jobIDs.push_back(SToStr(updateJobID));
@@ -591,52 +1258,51 @@ void BedrockJobsCommand::process(SQLite& db) {
                 // the child is created (indicating a child is creating a sibling) then the new child starts
                 // in the QUEUED state.
                 auto initialState = "QUEUED";
-                if (parentJobID) {
-                    auto parentState = db.read("SELECT state FROM jobs WHERE jobID=" + SQ(parentJobID) + ";");
-                    if (SIEquals(parentState, "RUNNING") || SIEquals(parentState, "RUNQUEUED")) {
-                        initialState = "PAUSED";
-                    }
+                if (parentJobID && (SIEquals(parentIt->second[0], "RUNNING") || SIEquals(parentIt->second[0], "RUNQUEUED"))) {
+                    initialState = "PAUSED";
                 }
 
                 // If no data was provided, use an empty object
                 const string& safeRetryAfter = SContains(job, "retryAfter") && !job["retryAfter"].empty() ? SQ(job["retryAfter"]) : SQ("");
 
                 // Create this new job with a new generated ID
-                const int64_t jobIDToUse = BedrockPlugin_Jobs::getNextID(db);
-                SINFO("Next jobID to be used " << jobIDToUse);
-                if (!db.writeIdempotent("INSERT INTO jobs ( jobID, created, state, name, nextRun, repeat, data, priority, parentJobID, retryAfter ) "
-                         "VALUES( " +
-                            SQ(jobIDToUse) + ", " +
-                            SCURRENT_TIMESTAMP() + ", " +
-                            SQ(initialState) + ", " +
-                            SQ(job["name"]) + ", " +
-                            safeFirstRun + ", " +
-                            SQ(SToUpper(job["repeat"])) + ", " +
-                            safeData + ", " +
-                            SQ(priority) + ", " +
-                            SQ(parentJobID) + ", " +
-                            safeRetryAfter + " " +
-                         " );"))
-                {
-                    STHROW("502 insert query failed");
+                const int64_t jobIDToUse = static_cast<BedrockPlugin_Jobs*>(_plugin)->getNextID(db);
+                insertValues += (insertCount ? ", ( " : "( ") +
+                                SQ(jobIDToUse) + ", " +
+                                created + ", " +
+                                SQ(initialState) + ", " +
+                                SQ(job["name"]) + ", " +
+                                safeFirstRun + ", " +
+                                SQ(SToUpper(job["repeat"])) + ", " +
+                                safeData + ", " +
+                                SQ(priority) + ", " +
+                                SQ(parentJobID) + ", " +
+                                safeRetryAfter + ", " +
+                                (isMockedJobData(job["data"]) ? "1" : "0") + " )";
+                if (++insertCount == INSERT_BATCH_SIZE) {
+                    insertJobs();
                 }
 
-                if (SIEquals(requestVerb, "CreateJob")) {
-                    jsonContent["jobID"] = SToStr(jobIDToUse);
-                    return;
+                // Later unique jobs with the same name will find this one, as they would if it was already there.
+                if (uniqueNames.count(job["name"])) {
+                    existingJobsByName.emplace(job["name"], make_pair(jobIDToUse, job["data"].empty() ? "{}"s : string(job["data"])));
                 }
 
                 // Append new jobID to list of created jobs.
                 jobIDs.push_back(SToStr(jobIDToUse));
             }
         }
+        insertJobs();
 
+        if (SIEquals(requestVerb, "CreateJob")) {
+            SINFO("Created or reused jobID " << jobIDs.front());
+            jsonContent["jobID"] = jobIDs.front();
+            return;
+        }
+        SINFO("Created or reused " << jobIDs.size() << " jobs.");
         jsonContent["jobIDs"] = SComposeJSONArray(jobIDs);
 
-        // Release workers waiting on this state
-        // TODO: No "HeldBy" anymore. If a plugin wants to hold a command, it should own it until it's done.
-        // node->clearCommandHolds("Jobs:" + request["name"]);
-
+        // Any GetJob commands waiting on these jobs are released when this commits, by the ready index.
         return; // Successfully processed
     }
 
@@ -653,20 +1319,45 @@ void BedrockJobsCommand::process(SQLite& db) {
         const list<string> nameList = SParseList(request["name"]);
         string safeNumResults = SQ(max(request.calc("numResults"),1));
         mockRequest = mockRequest || request.isSet("getMockedJobs");
+        const string notMocked = !mockRequest ? " AND " + _mockedSQL(db) + " = 0 " : "";
+        const bool roundRobin = SIEquals(request["order"], "roundRobin");
         string selectQuery;
-        if (request.isSet("jobPriority")) {
+        if (roundRobin) {
+            // Number each name's ready jobs at each priority in nextRun order, and take the first of each name before
+            // the second of any, with the names in order, starting after the last one that had a turn. This has to look
+            // at every ready job that matches, but we only get here if the ready index can't answer.
+            string afterLastNames;
+            for (const auto& lastName : _getRoundRobinLastNames()) {
+                afterLastNames += "WHEN " + SQ(lastName.first) + " THEN name <= " + SQ(lastName.second) + " ";
+            }
+            afterLastNames = afterLastNames.empty() ? "" : "CASE priority " + afterLastNames + "ELSE 0 END ASC, ";
             selectQuery =
-                "SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun "
+                "SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun, priority FROM ( "
+                    "SELECT jobID, name, data, priority, parentJobID, retryAfter, created, repeat, lastRun, nextRun, "
+                        "ROW_NUMBER() OVER (PARTITION BY priority, name ORDER BY nextRun, jobID) AS turn "
+                    "FROM jobs "
+                    "WHERE state IN ('QUEUED', 'RUNQUEUED') "
+                        "AND priority " + (request.isSet("jobPriority") ? "=" + SQ(request.calc("jobPriority")) : "IN (1000, 500, 0)") + " "
+                        "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
+                        "AND name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
+                        notMocked +
+                ") "
+                "WHERE turn <= " + safeNumResults + " "
+                "ORDER BY priority DESC, turn ASC, " + afterLastNames + "name ASC "
+                "LIMIT " + safeNumResults + ";";
+        } else if (request.isSet("jobPriority")) {
+            selectQuery =
+                "SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun, priority "
                 "FROM jobs "
                 "WHERE state IN ('QUEUED', 'RUNQUEUED') "
                     "AND priority=" + SQ(request.calc("jobPriority")) + " "
                     "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
                     "AND +name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
-                    string(!mockRequest ? " AND JSON_EXTRACT(data, '$.mockRequest') IS NULL " : "") +
+                    notMocked +
                 "ORDER BY nextRun ASC LIMIT " + safeNumResults + ";";
         } else {
             selectQuery =
-                "SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun FROM ( "
+                "SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun, priority FROM ( "
                     "SELECT * FROM ("
                         "SELECT jobID, name, data, priority, parentJobID, retryAfter, created, repeat, lastRun, nextRun "
                         "FROM jobs "
@@ -674,7 +1365,7 @@ void BedrockJobsCommand::process(SQLite& db) {
                             "AND priority=1000 "
                             "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
                             "AND name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
-                            string(!mockRequest ? " AND JSON_EXTRACT(data, '$.mockRequest') IS NULL " : "") +
+                            notMocked +
                         "ORDER BY nextRun ASC LIMIT " + safeNumResults +
                     ") "
                 "UNION ALL "
@@ -685,7 +1376,7 @@ void BedrockJobsCommand::process(SQLite& db) {
                             "AND priority=500 "
                             "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
                             "AND name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
-                            string(!mockRequest ? " AND JSON_EXTRACT(data, '$.mockRequest') IS NULL " : "") +
+                            notMocked +
                         "ORDER BY nextRun ASC LIMIT " + safeNumResults +
                     ") "
                 "UNION ALL "
@@ -696,25 +1387,57 @@ void BedrockJobsCommand::process(SQLite& db) {
                             "AND priority=0 "
                             "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
                             "AND name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
-                            string(!mockRequest ? " AND JSON_EXTRACT(data, '$.mockRequest') IS NULL " : "") +
+                            notMocked +
                         "ORDER BY nextRun ASC LIMIT " + safeNumResults +
                     ") "
                 ") "
                 "ORDER BY priority DESC "
                 "LIMIT " + safeNumResults + ";";
         }
-        if (!db.read(selectQuery, result)) {
+
+        // If we can, we look up the jobs the ready index says we should return, rather than searching for them. The
+        // index is only as current as the last commit, which isn't necessarily what this transaction sees, so we make
+        // sure they're all still ready, and if they're not, search the table after all.
+        list<int64_t> readyJobIDs;
+        bool foundReadyJobs = false;
+        if (_isMockRequestBackfilled(db) && _findReadyJobs(max(request.calc("numResults"), 1), readyJobIDs)) {
+            if (readyJobIDs.empty()) {
+                STHROW("404 No job found");
+            }
+            SQResult readyJobs;
+            if (!db.read("SELECT jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun, priority "
+                         "FROM jobs "
+                         "WHERE jobID IN (" + SQList(readyJobIDs) + ") "
+                             "AND state IN ('QUEUED', 'RUNQUEUED') "
+                             "AND " + SCURRENT_TIMESTAMP() + ">=nextRun "
+                             "AND +name " + (nameList.size() > 1 ? "IN (" + SQList(nameList) + ")" : "GLOB " + SQ(request["name"])) + " " +
+                             notMocked + ";",
+                         readyJobs)) {
+                STHROW("502 Query failed");
+            }
+            if (readyJobs.size() == readyJobIDs.size()) {
+                // Put them back in the order the index gave them to us.
+                map<string, vector<string>> rowsByJobID;
+                for (auto& row : readyJobs.rows) {
+                    rowsByJobID[row[0]] = move(row);
+                }
+                for (int64_t jobID : readyJobIDs) {
+                    result.rows.push_back(move(rowsByJobID[to_string(jobID)]));
+                }
+                foundReadyJobs = true;
+            } else {
+                SINFO("Ready job index is behind, searching jobs instead.");
+            }
+        }
+        if (!foundReadyJobs && !db.read(selectQuery, result)) {
             STHROW("502 Query failed");
         }
 
         // Are there any results?
         if (result.empty()) {
-            // Ah, there were before, but aren't now -- nothing found
-            // **FIXME: If "Connection: wait" should re-apply the hold.  However, this is super edge
-            //          as we could only get here if the job somehow got consumed between the peek
-            //          and process -- which could happen during heavy load.  But it'd just return
-            //          no results (which is correct) faster than it would otherwise time out.  Either
-            //          way the worker will likely just loop, so it doesn't really matter.
+            // Ah, there were before, but aren't now -- nothing found. Commands can only be held from `peek`, so even
+            // with "Connection: wait", we just answer. We can only get here if the job was taken between peek and
+            // process, and the caller will just ask again.
             STHROW("404 No job found");
         }
 
@@ -726,7 +1449,7 @@ void BedrockJobsCommand::process(SQLite& db) {
         list<STable> retriableJobs;
         list<string> jobList;
         for (size_t c=0; c<result.size(); ++c) {
-            SASSERT(result[c].size() == 9); // jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun
+            SASSERT(result[c].size() == 10); // jobID, name, data, parentJobID, retryAfter, created, repeat, lastRun, nextRun, priority
 
             // Add this object to our output
             STable job;
@@ -811,6 +1534,15 @@ void BedrockJobsCommand::process(SQLite& db) {
             }
         }
 
+        // The next round-robin command starts with the names after the last ones we're taking jobs from, once this one
+        // has committed.
+        if (roundRobin) {
+            _roundRobinLastNames.clear();
+            for (const auto& row : result.rows) {
+                _roundRobinLastNames[SToInt64(row[9])] = row[1];
+            }
+        }
+
         // Format the results as is appropriate for what was requested
         if (SIEquals(requestVerb, "GetJob")) {
             // Single response
@@ -882,7 +1614,7 @@ void BedrockJobsCommand::process(SQLite& db) {
         // Update the data
         if (!db.writeIdempotent("UPDATE jobs "
                                 "SET data=" +
-                                SQ(request["data"]) + " " +
+                                SQ(request["data"]) + ", mockRequest=" + (isMockedJobData(request["data"]) ? "1" : "0") + " " +
                                 (request["repeat"].size() ? ", repeat=" + SQ(SToUpper(request["repeat"])) : "") +
                                 (!newNextRun.empty() ? ", nextRun=" + newNextRun : "") +
                                 (request.isSet("jobPriority") ? ", priority=" + SQ(request.calc64("jobPriority")) + " " : "") +
@@ -928,182 +1660,59 @@ void BedrockJobsCommand::process(SQLite& db) {
         //     - data   - Data to associate with this finsihed job
         //
         BedrockPlugin::verifyAttributeInt64(request, "jobID", 1);
-        int64_t jobID = request.calc64("jobID");
-
-        // Verify there is a job like this and it's running
-        SQResult result;
-        if (!db.read("SELECT state, nextRun, lastRun, repeat, parentJobID, json_extract(data, '$.mockRequest') "
-                     "FROM jobs "
-                     "WHERE jobID=" + SQ(jobID) + ";",
-                     result)) {
-            STHROW("502 Select failed");
-        }
-        if (result.empty()) {
-            STHROW("404 No job with this jobID");
-        }
-
-        const string& state = result[0][0];
-        const string& nextRun = result[0][1];
-        const string& lastRun = result[0][2];
-        string repeat = result[0][3];
-        int64_t parentJobID = SToInt64(result[0][4]);
-        mockRequest = result[0][5] == "1";
-
-        // Make sure we're finishing a job that's actually running
-        if (state != "RUNNING" && state != "RUNQUEUED" && !mockRequest) {
-            SINFO("Trying to finish job#" << jobID << ", but isn't RUNNING or RUNQUEUED (" << state << ")");
-            STHROW("405 Can only retry/finish RUNNING and RUNQUEUED jobs");
-        }
-
-        // If we have a parent, make sure it is PAUSED.  This is to just
-        // double-check that child jobs aren't somehow running in parallel to
-        // the parent.
-        if (parentJobID) {
-            auto parentState = db.read("SELECT state FROM jobs WHERE jobID=" + SQ(parentJobID) + ";");
-            if (!SIEquals(parentState, "PAUSED")) {
-                SINFO("Trying to finish/retry job#" << jobID << ", but parent isn't PAUSED (" << parentState << ")");
-                STHROW("405 Can only retry/finish child job when parent is PAUSED");
-            }
-        }
-
-        // Delete any FINISHED/CANCELLED child jobs, but leave any PAUSED children alone (as those will signal that
-        // we just want to re-PAUSE this job so those new children can run)
-        if (!db.writeIdempotent("DELETE FROM jobs WHERE parentJobID != 0 AND parentJobID=" + SQ(jobID) + " AND state IN ('FINISHED', 'CANCELLED');")) {
-            STHROW("502 Failed deleting finished/cancelled child jobs");
-        }
-
-        // If we've been asked to update the data, let's do that
-        auto data = request["data"];
-        if (!data.empty()) {
-            // See if the new data says it's mocked.
-            STable newData = SParseJSONObject(data);
-            bool newMocked = newData.find("mockRequest") != newData.end();
-
-            // If both sets of data don't match each other, this is an error, we don't know who to trust.
-            // We don't worry about the state of the request header for mockRequest here, as we expect that the Bedrock
-            // client won't always set it when finishing or retrying a job. We'll just use what's in the data.
-            if (mockRequest != newMocked) {
-                SWARN("Not updating mockRequest field of job data.");
-                STHROW("500 Mock Mismatch");
-            }
-
-            // If the Job data indicates that this job should be deleted, clear the repeat value so that we delete this job further down.
-            if (SContains(newData, "delete") && newData["delete"] == "true") {
-                SINFO("Job was marked for deletion in the data object, clearing repeat value.");
-                repeat = "";
-            }
+        list<STable> jobs = _getJobs();
+        _finishJob(db, _planFinishJob(db, SIEquals(requestVerb, "RetryJob"), jobs.front()));
 
-            // Update the data to the new value.
-            if (!db.writeIdempotent("UPDATE jobs SET data=" + SQ(data) + " WHERE jobID=" + SQ(jobID) + ";")) {
-                STHROW("502 Failed to update job data");
-            }
-        }
-
-        // If we are finishing a job that has child jobs, set its state to paused.
-        if (SIEquals(requestVerb, "FinishJob") && _hasPendingChildJobs(db, jobID)) {
-            // Update the parent job to PAUSED. Also update its nextRun: in case it has a retryAfter, GetJobs set the nextRun too far in the future (to account for retryAfter), so set it to what it should
-            // be now that it is waiting on its children to complete.
-            SINFO("Job has child jobs, PAUSING parent, QUEUING children");
-            if (!db.writeIdempotent("UPDATE jobs SET state='PAUSED', nextRun=" + SQ(lastRun) + " WHERE jobID=" + SQ(jobID) + ";")) {
-                STHROW("502 Parent update failed");
-            }
-
-            // Also un-pause any child jobs such that they can run
-            if (!db.writeIdempotent("UPDATE jobs SET state='QUEUED' "
-                          "WHERE state='PAUSED' "
-                            "AND parentJobID != 0 AND parentJobID=" + SQ(jobID) + ";")) {
-                STHROW("502 Child update failed");
-            }
-
-            // All done processing this command
-            return;
-        }
-
-        // If this is RetryJob and we want to update the name and/or priority, let's do that
-        const string& name = request["name"];
-        if (SIEquals(requestVerb, "RetryJob")) {
-            list<string> updates;
-            if (!name.empty()) {
-                updates.push_back("name=" + SQ(name) + " ");
-            }
-            if (request.isSet("jobPriority")) {
-                _validatePriority(request.calc64("jobPriority"));
-                updates.push_back("priority=" + SQ(request["jobPriority"]) + " ");
-            }
-            if (!updates.empty()) {
-                bool success = db.writeIdempotent("UPDATE jobs SET " + SComposeList(updates, ", ") + " WHERE jobID=" + SQ(jobID) + ";");
-                if (!success) {
-                    STHROW("502 Failed to update job name/priority");
-                }
-            }
-        }
-
-        string safeNewNextRun = "";
-        // If this is set to repeat, get the nextRun value
-        if (!repeat.empty()) {
-            safeNewNextRun = _constructNextRunDATETIME(nextRun, lastRun, repeat);
-        } else if (SIEquals(requestVerb, "RetryJob")) {
-            const string& newNextRun = request["nextRun"];
+        // Successfully processed
+        return;
+    }
 
-            if (newNextRun.empty()) {
-                SINFO("nextRun isn't set, using delay");
-                int64_t delay = request.calc64("delay");
-                if (delay < 0) {
-                    STHROW("402 Must specify a non-negative delay when retrying");
-                }
-                repeat = "FINISHED, +" + SToStr(delay) + " SECONDS";
-                safeNewNextRun = _constructNextRunDATETIME(nextRun, lastRun, repeat);
-                if (safeNewNextRun.empty()) {
-                    STHROW("402 Malformed delay");
+    // ----------------------------------------------------------------------
+    else if (SIEquals(requestVerb, "RetryJobs") || SIEquals(requestVerb, "FinishJobs")) {
+        // - RetryJobs( jobs )
+        // - FinishJobs( jobs )
+        //
+        //     Retries or finishes several jobs in one transaction, as if RetryJob or FinishJob had been called for
+        //     each of them in turn. A job that can't be retried or finished doesn't stop the rest; its error is
+        //     returned with its result instead, and nothing is changed for it.
+        //
+        //     Parameters:
+        //     - jobs - JSON array of objects, one for each job, with the parameters RetryJob or FinishJob takes
+        //
+        //     Returns:
+        //     - 200 - OK
+        //         . results - JSON array of objects, one for each job, in the same order as `jobs`:
+        //           o jobID  - ID of the job
+        //           o result - "200 OK", or the error RetryJob or FinishJob would have returned for this job
+        //     - 401 - Invalid JSON
+        //     - 402 - Missing jobID
+        //
+        const bool retry = SIEquals(requestVerb, "RetryJobs");
+        list<STable> jobs = _getJobs();
+        list<string> results;
+        for (auto& job : jobs) {
+            STable jobResult;
+            jobResult["jobID"] = job["jobID"];
+            FinishJobPlan plan;
+            try {
+                plan = _planFinishJob(db, retry, job);
+            } catch (const SException& e) {
+                // A query failing isn't about this job in particular, so that fails the whole batch.
+                if (SStartsWith(e.method, "502")) {
+                    throw;
                 }
-            } else {
-                safeNewNextRun = SQ(newNextRun);
-            }
-        }
-
-        // The job is set to be rescheduled.
-        if (!safeNewNextRun.empty()) {
-            // The "nextRun" at this point is still
-            // storing the last time this job was *scheduled* to be run;
-            // lastRun contains when it was *actually* run.
-            SINFO("Rescheduling job#" << jobID << ": " << safeNewNextRun);
-
-            // Update this job
-            if (!db.writeIdempotent("UPDATE jobs SET nextRun=" + safeNewNextRun + ", state='QUEUED' WHERE jobID=" + SQ(jobID) + ";")) {
-                STHROW("502 Update failed");
+                jobResult["result"] = e.method;
+                results.push_back(SComposeJSONObject(jobResult));
+                continue;
             }
-        } else {
-            // We are done with this job.  What do we do with it?
-            SASSERT(!SIEquals(requestVerb, "RetryJob"));
-            if (parentJobID) {
-                // This is a child job.  Mark it as finished.
-                if (!db.writeIdempotent("UPDATE jobs SET state='FINISHED' WHERE jobID=" + SQ(jobID) + ";")) {
-                    STHROW("502 Failed to mark job as FINISHED");
-                }
-
-                // Resume the parent if this is the last pending child
-                if (!_hasPendingChildJobs(db, parentJobID)) {
-                    SINFO("Job has parentJobID: " + SToStr(parentJobID) +
-                          " and no other pending children, resuming parent job");
-                    if (!db.writeIdempotent("UPDATE jobs SET state='QUEUED' where jobID=" + SQ(parentJobID) + ";")) {
-                        STHROW("502 Update failed");
-                    }
-                }
-            } else {
-                // This is a standalone (not a child) job; delete it.
-                if (!db.writeIdempotent("DELETE FROM jobs WHERE jobID=" + SQ(jobID) + ";")) {
-                    STHROW("502 Delete failed");
-                }
 
-                // At this point, all child jobs should already be deleted, but
-                // let's double check.
-                if (!db.read("SELECT 1 FROM jobs WHERE parentJobID != 0 AND parentJobID=" + SQ(jobID) + " LIMIT 1;").empty()) {
-                    STHROW("405 Failed to delete a job with outstanding children");
-                }
-            }
+            // Once we start changing a job, anything that goes wrong fails the whole batch, so that we never commit
+            // half of what one job needed.
+            _finishJob(db, plan);
+            jobResult["result"] = "200 OK";
+            results.push_back(SComposeJSONObject(jobResult));
         }
-
-        // Successfully processed
+        jsonContent["results"] = SComposeJSONArray(results);
         return;
     }
     // ----------------------------------------------------------------------
@@ -1186,6 +1795,7 @@ void BedrockJobsCommand::process(SQLite& db) {
         if (request.isSet("data")) {
             // Update the data too
             updateList.push_back("data=" + SQ(request["data"]));
+            updateList.push_back("mockRequest=" + string(isMockedJobData(request["data"]) ? "1" : "0"));
         }
 
         // Not repeating; just finish
@@ -1257,58 +1867,443 @@ void BedrockJobsCommand::process(SQLite& db) {
 
         return;
     }
+
+    // ----------------------------------------------------------------------
+
+    else if (SIEquals(requestVerb, "PurgeJobs")) {
+        // - PurgeJobs( olderThan, [limit] )
+        //
+        //     Deletes FINISHED, FAILED and CANCELLED jobs that last ran (or, if they never ran, were created) more than
+        //     `olderThan` seconds ago. Children of parents that are still running are left alone, as the parent needs
+        //     them. Sent by the plugin itself when `-jobs.retention` is set.
+        //
+        //     Parameters:
+        //     - olderThan - Age in seconds of the jobs to delete
+        //     - limit - (optional) Maximum number of jobs to delete (default 1000)
+        //
+        //     Returns:
+        //     - purgedJobs - The number of jobs deleted
+        //
+        BedrockPlugin::verifyAttributeInt64(request, "olderThan", 1);
+        if (request.calc64("olderThan") < 0) {
+            STHROW("402 Invalid olderThan");
+        }
+        BedrockPlugin::verifyAttributeInt64(request, "limit", 0);
+        int64_t limit = request.isSet("limit") ? request.calc64("limit") : 1000;
+        if (limit < 1) {
+            STHROW("402 Invalid limit");
+        }
+
+        // Anything older than the epoch is just "forever", and mustn't wrap around to a cutoff in the far future.
+        const uint64_t now = STimeNow();
+        const uint64_t olderThan = min(request.calcU64("olderThan"), now / STIME_US_PER_S);
+        const string cutoff = SComposeTime("%Y-%m-%d %H:%M:%S", now - olderThan * STIME_US_PER_S);
+
+        // The state and COALESCE() here need to match jobsDoneStateLastRun for it to be used.
+        if (!db.writeIdempotent("DELETE FROM jobs WHERE jobID IN ("
+                                    "SELECT jobID FROM jobs "
+                                    "WHERE state IN ('FINISHED', 'FAILED', 'CANCELLED') "
+                                      "AND COALESCE(lastRun, created) < " + SQ(cutoff) + " "
+                                      "AND (parentJobID = 0 OR NOT EXISTS ("
+                                          "SELECT 1 FROM jobs AS parent "
+                                          "WHERE parent.jobID = jobs.parentJobID "
+                                            "AND parent.state NOT IN ('FINISHED', 'FAILED', 'CANCELLED'))) "
+                                    "LIMIT " + SQ(limit) + ");")) {
+            STHROW("502 Purge failed");
+        }
+        _purgedCount = db.getLastWriteChangeCount();
+        SINFO("Purged " << _purgedCount << " jobs older than " << cutoff);
+        response["purgedJobs"] = to_string(_purgedCount);
+        return;
+    }
+
+    // ----------------------------------------------------------------------
+
+    else if (SIEquals(requestVerb, "BackfillMockRequest")) {
+        // - BackfillMockRequest( [limit] )
+        //
+        //     Fills in the `mockRequest` column for the next jobs, in jobID order, that were there before the column
+        //     was added to a live database. Jobs written since then already have it. Sent by the plugin itself until
+        //     there's nothing left to fill in.
+        //
+        //     Parameters:
+        //     - limit - (optional) Maximum number of jobs to look at (default 1000)
+        //
+        //     Returns:
+        //     - done - "true" if every job has it now
+        //
+        BedrockPlugin::verifyAttributeInt64(request, "limit", 0);
+        int64_t limit = request.isSet("limit") ? request.calc64("limit") : 1000;
+        if (limit < 1) {
+            STHROW("402 Invalid limit");
+        }
+
+        SQResult result;
+        if (!db.read("SELECT nextJobID FROM jobsMockRequestBackfill;", result)) {
+            STHROW("502 Select failed");
+        }
+        if (result.empty()) {
+            _mockRequestBackfillDone = true;
+            response["done"] = "true";
+            return;
+        }
+
+        // This batch ends where the next one starts, or, if there are no jobs past it, at the end of the table.
+        const int64_t firstJobID = SToInt64(result[0][0]);
+        const int64_t nextJobID = SToInt64(db.read("SELECT jobID FROM jobs WHERE jobID >= " + SQ(firstJobID) + " ORDER BY jobID LIMIT 1 OFFSET " + SQ(limit) + ";"));
+        if (!db.writeIdempotent("UPDATE jobs SET mockRequest = 1 "
+                                "WHERE jobID >= " + SQ(firstJobID) + " " +
+                                  (nextJobID ? "AND jobID < " + SQ(nextJobID) + " " : "") +
+                                  "AND mockRequest = 0 "
+                                  "AND JSON_EXTRACT(data, '$.mockRequest') IS NOT NULL;")) {
+            STHROW("502 Backfill failed");
+        }
+        SINFO("Filled in mockRequest for " << db.getLastWriteChangeCount() << " mocked jobs from jobID " << firstJobID);
+        if (!nextJobID) {
+            if (!db.writeIdempotent("DELETE FROM jobsMockRequestBackfill;")) {
+                STHROW("502 Backfill failed");
+            }
+            _mockRequestBackfillDone = true;
+        } else if (!db.writeIdempotent("UPDATE jobsMockRequestBackfill SET nextJobID = " + SQ(nextJobID) + ";")) {
+            STHROW("502 Backfill failed");
+        }
+        response["done"] = _mockRequestBackfillDone ? "true" : "false";
+        return;
+    }
 }
 
 string BedrockJobsCommand::_constructNextRunDATETIME(const string& lastScheduled, const string& lastRun, const string& repeat) {
     if (repeat.empty()) {
         return "";
     }
-
-    // Some "canned" times for convenience
-    if (SIEquals(repeat, "HOURLY"))
-        return "STRFTIME( '%Y-%m-%d %H:00:00', DATETIME( " + SCURRENT_TIMESTAMP() + ", '+1 HOUR' ) )";
-    if (SIEquals(repeat, "DAILY"))
-        return "DATETIME( " + SCURRENT_TIMESTAMP() + ", '+1 DAY', 'START OF DAY'  )";
-    if (SIEquals(repeat, "WEEKLY"))
-        return "DATETIME( " + SCURRENT_TIMESTAMP() + ", '+1 DAY', 'WEEKDAY 0', 'START OF DAY' )";
-
-    // Not canned, split the advanced repeat into its parts
-    list<string> parts = SParseList(SToUpper(repeat));
-    if (parts.size() < 2) {
-        SWARN("Syntax error, failed parsing repeat '" << repeat << "': too short.");
+    auto schedule = BedrockJobsRepeat::get(repeat);
+    if (!schedule) {
         return "";
     }
 
-    // Make sure the first part indicates the base (eg, what we are modifying)
-    list<string> safeParts;
-    string base = parts.front();
-    parts.pop_front();
-    if (base == "SCHEDULED") {
-        safeParts.push_back(SQ(lastScheduled));
-    } else if (base == "STARTED") {
-        safeParts.push_back(SQ(lastRun));
-    } else if (base == "FINISHED") {
-        safeParts.push_back(SCURRENT_TIMESTAMP());
-    } else {
-        SWARN("Syntax error, failed parsing repeat '" << repeat << "': missing base (" << base << ")");
-        return "";
+    // We normally work out the next run ourselves, but if we can't, SQLite can.
+    uint64_t now = STimeNow();
+    string nextRun = schedule->nextRun(lastScheduled, lastRun, now);
+    if (nextRun.empty()) {
+        return schedule->nextRunSQL(lastScheduled, lastRun, now);
     }
+    return SQ(nextRun);
+}
 
-    for (const string& part : parts) {
-        // Validate the sqlite date modifiers
-        if (!SIsValidSQLiteDateModifier(part)){
-            SWARN("Syntax error, failed parsing repeat "+part);
-            return "";
+// ==========================================================================
+
+bool BedrockJobsCommand::_findReadyJobs(size_t limit, list<int64_t>& jobIDs) {
+    // These match the names, priorities, and mocked jobs that GetJob and GetJobs look for.
+    list<string> names = SParseList(request["name"]);
+    if (names.size() <= 1) {
+        names = {request["name"]};
+    }
+    int64_t priority = request.isSet("jobPriority") ? request.calc64("jobPriority") : -1;
+    bool includeMocked = mockRequest || request.isSet("getMockedJobs");
+    map<int64_t, string> roundRobinAfter;
+    bool roundRobin = SIEquals(request["order"], "roundRobin");
+    if (roundRobin) {
+        roundRobinAfter = _getRoundRobinLastNames();
+    }
+    BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+    if (!plugin->_mockRequestBackfilled) {
+        return false;
+    }
+    return plugin->_readyIndex.findReady(names, priority, includeMocked, roundRobin ? &roundRobinAfter : nullptr,
+                           SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow()), limit, jobIDs);
+}
+
+bool BedrockJobsCommand::_isMockRequestBackfilled(SQLite& db) {
+    BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+    if (!plugin->_mockRequestBackfilled) {
+        // The table doesn't exist until leader upgrades the DB, and until then, nor does the column. This can only go
+        // from not done to done, and only by committing, so if it's done as far as we can see, it's done for good.
+        bool exists = !db.read("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'jobsMockRequestBackfill';").empty();
+        if (exists && db.read("SELECT 1 FROM jobsMockRequestBackfill;").empty()) {
+            plugin->_mockRequestBackfilled = true;
         }
+    }
+    return plugin->_mockRequestBackfilled;
+}
+
+string BedrockJobsCommand::_mockedSQL(SQLite& db) {
+    return _isMockRequestBackfilled(db) ? "mockRequest" : "(JSON_EXTRACT(data, '$.mockRequest') IS NOT NULL)";
+}
+
+map<int64_t, string> BedrockJobsCommand::_getRoundRobinLastNames() {
+    BedrockPlugin_Jobs* plugin = static_cast<BedrockPlugin_Jobs*>(_plugin);
+    lock_guard<decltype(plugin->_roundRobinMutex)> lock(plugin->_roundRobinMutex);
+    return plugin->_roundRobinLastNames;
+}
+
+const list<STable>& BedrockJobsCommand::_getJobs() {
+    if (!_jobs.empty()) {
+        return _jobs;
+    }
+    const string& requestVerb = request.getVerb();
+    if (SIEquals(requestVerb, "CreateJob") || SIEquals(requestVerb, "FinishJob") || SIEquals(requestVerb, "RetryJob")) {
+        _jobs.push_back(request.nameValueMap);
+        return _jobs;
+    }
 
-        safeParts.push_back(SQ(part));
+    list<string> multipleJobs = SParseJSONArray(request["jobs"]);
+    if (multipleJobs.empty()) {
+        STHROW("401 Invalid JSON");
     }
+    list<STable> jobs;
+    for (auto& job : multipleJobs) {
+        STable jobObject = SParseJSONObject(job);
+        if (jobObject.empty()) {
+            STHROW("401 Invalid JSON");
+        }
 
-    // Combine the parts together and return the full DATETIME statement
-    return "DATETIME( " + SComposeList(safeParts) + " )";
+        // Verify that name is present for every job we're creating, and jobID for every job we're finishing or
+        // retrying
+        if (SIEquals(requestVerb, "CreateJobs") && !SContains(jobObject, "name")) {
+            STHROW("402 Missing name");
+        }
+        if (!SIEquals(requestVerb, "CreateJobs") && !SContains(jobObject, "jobID")) {
+            STHROW("402 Missing jobID");
+        }
+
+        jobs.push_back(move(jobObject));
+    }
+    _jobs = move(jobs);
+    return _jobs;
 }
 
-// ==========================================================================
+BedrockJobsCommand::FinishJobPlan BedrockJobsCommand::_planFinishJob(SQLite& db, bool retry, STable& job) {
+    FinishJobPlan plan;
+    plan.jobID = SToInt64(job["jobID"]);
+    plan.retry = retry;
+    if (plan.jobID <= 0 || job["jobID"] != SToStr(plan.jobID)) {
+        STHROW("402 Malformed jobID");
+    }
+    const int64_t jobID = plan.jobID;
+
+    // Verify there is a job like this and it's running
+    SQResult result;
+    if (!db.read("SELECT state, nextRun, lastRun, repeat, parentJobID, " + _mockedSQL(db) + " "
+                 "FROM jobs "
+                 "WHERE jobID=" + SQ(jobID) + ";",
+                 result)) {
+        STHROW("502 Select failed");
+    }
+    if (result.empty()) {
+        STHROW("404 No job with this jobID");
+    }
+
+    const string& state = result[0][0];
+    const string& nextRun = result[0][1];
+    plan.lastRun = result[0][2];
+    string repeat = result[0][3];
+    plan.parentJobID = SToInt64(result[0][4]);
+    const bool mocked = result[0][5] == "1";
+
+    // Make sure we're finishing a job that's actually running
+    if (state != "RUNNING" && state != "RUNQUEUED" && !mocked) {
+        SINFO("Trying to finish job#" << jobID << ", but isn't RUNNING or RUNQUEUED (" << state << ")");
+        STHROW("405 Can only retry/finish RUNNING and RUNQUEUED jobs");
+    }
+
+    // If we have a parent, make sure it is PAUSED.  This is to just
+    // double-check that child jobs aren't somehow running in parallel to
+    // the parent.
+    if (plan.parentJobID) {
+        auto parentState = db.read("SELECT state FROM jobs WHERE jobID=" + SQ(plan.parentJobID) + ";");
+        if (!SIEquals(parentState, "PAUSED")) {
+            SINFO("Trying to finish/retry job#" << jobID << ", but parent isn't PAUSED (" << parentState << ")");
+            STHROW("405 Can only retry/finish child job when parent is PAUSED");
+        }
+    }
+
+    // If we've been asked to update the data, make sure we can
+    plan.data = job["data"];
+    if (!plan.data.empty()) {
+        // See if the new data says it's mocked.
+        STable newData = SParseJSONObject(plan.data);
+        bool newMocked = isMockedJobData(plan.data);
+
+        // If both sets of data don't match each other, this is an error, we don't know who to trust.
+        // We don't worry about the state of the request header for mockRequest here, as we expect that the Bedrock
+        // client won't always set it when finishing or retrying a job. We'll just use what's in the data.
+        if (mocked != newMocked) {
+            SWARN("Not updating mockRequest field of job data.");
+            STHROW("500 Mock Mismatch");
+        }
+
+        // If the Job data indicates that this job should be deleted, clear the repeat value so that we delete this job further down.
+        if (SContains(newData, "delete") && newData["delete"] == "true") {
+            SINFO("Job was marked for deletion in the data object, clearing repeat value.");
+            repeat = "";
+        }
+    }
+
+    // If this is RetryJob, we might also update the name and/or priority
+    if (retry) {
+        plan.name = job["name"];
+        if (SContains(job, "jobPriority")) {
+            _validatePriority(SToInt64(job["jobPriority"]));
+            plan.priority = job["jobPriority"];
+        }
+    }
+
+    // If this is set to repeat, get the nextRun value
+    if (!repeat.empty()) {
+        plan.safeNextRun = _constructNextRunDATETIME(nextRun, plan.lastRun, repeat);
+    } else if (retry) {
+        const string& newNextRun = job["nextRun"];
+
+        if (newNextRun.empty()) {
+            SINFO("nextRun isn't set, using delay");
+            int64_t delay = SToInt64(job["delay"]);
+            if (delay < 0) {
+                STHROW("402 Must specify a non-negative delay when retrying");
+            }
+            repeat = "FINISHED, +" + SToStr(delay) + " SECONDS";
+            plan.safeNextRun = _constructNextRunDATETIME(nextRun, plan.lastRun, repeat);
+            if (plan.safeNextRun.empty()) {
+                STHROW("402 Malformed delay");
+            }
+        } else {
+            plan.safeNextRun = SQ(newNextRun);
+        }
+    }
+    return plan;
+}
+
+void BedrockJobsCommand::_finishJob(SQLite& db, const FinishJobPlan& plan) {
+    const int64_t jobID = plan.jobID;
+
+    // Delete any FINISHED/CANCELLED child jobs, but leave any PAUSED children alone (as those will signal that
+    // we just want to re-PAUSE this job so those new children can run)
+    if (!db.writeIdempotent("DELETE FROM jobs WHERE parentJobID != 0 AND parentJobID=" + SQ(jobID) + " AND state IN ('FINISHED', 'CANCELLED');")) {
+        STHROW("502 Failed deleting finished/cancelled child jobs");
+    }
+
+    // If we've been asked to update the data, let's do that
+    if (!plan.data.empty()) {
+        if (!db.writeIdempotent("UPDATE jobs SET data=" + SQ(plan.data) + " WHERE jobID=" + SQ(jobID) + ";")) {
+            STHROW("502 Failed to update job data");
+        }
+    }
+
+    // If we are finishing a job that has child jobs, set its state to paused.
+    if (!plan.retry && _hasPendingChildJobs(db, jobID)) {
+        // Update the parent job to PAUSED. Also update its nextRun: in case it has a retryAfter, GetJobs set the nextRun too far in the future (to account for retryAfter), so set it to what it should
+        // be now that it is waiting on its children to complete.
+        SINFO("Job has child jobs, PAUSING parent, QUEUING children");
+        if (!db.writeIdempotent("UPDATE jobs SET state='PAUSED', nextRun=" + SQ(plan.lastRun) + " WHERE jobID=" + SQ(jobID) + ";")) {
+            STHROW("502 Parent update failed");
+        }
+
+        // Also un-pause any child jobs such that they can run
+        if (!db.writeIdempotent("UPDATE jobs SET state='QUEUED' "
+                      "WHERE state='PAUSED' "
+                        "AND parentJobID != 0 AND parentJobID=" + SQ(jobID) + ";")) {
+            STHROW("502 Child update failed");
+        }
+
+        // All done with this job
+        return;
+    }
+
+    // If this is RetryJob and we want to update the name and/or priority, let's do that
+    list<string> updates;
+    if (!plan.name.empty()) {
+        updates.push_back("name=" + SQ(plan.name) + " ");
+    }
+    if (!plan.priority.empty()) {
+        updates.push_back("priority=" + SQ(plan.priority) + " ");
+    }
+    if (!updates.empty()) {
+        bool success = db.writeIdempotent("UPDATE jobs SET " + SComposeList(updates, ", ") + " WHERE jobID=" + SQ(jobID) + ";");
+        if (!success) {
+            STHROW("502 Failed to update job name/priority");
+        }
+    }
+
+    // The job is set to be rescheduled.
+    if (!plan.safeNextRun.empty()) {
+        // The "nextRun" at this point is still
+        // storing the last time this job was *scheduled* to be run;
+        // lastRun contains when it was *actually* run.
+        SINFO("Rescheduling job#" << jobID << ": " << plan.safeNextRun);
+
+        // Update this job
+        if (!db.writeIdempotent("UPDATE jobs SET nextRun=" + plan.safeNextRun + ", state='QUEUED' WHERE jobID=" + SQ(jobID) + ";")) {
+            STHROW("502 Update failed");
+        }
+    } else {
+        // We are done with this job.  What do we do with it?
+        SASSERT(!plan.retry);
+        if (plan.parentJobID) {
+            // This is a child job.  Mark it as finished.
+            if (!db.writeIdempotent("UPDATE jobs SET state='FINISHED' WHERE jobID=" + SQ(jobID) + ";")) {
+                STHROW("502 Failed to mark job as FINISHED");
+            }
+
+            // Resume the parent if this is the last pending child
+            if (!_hasPendingChildJobs(db, plan.parentJobID)) {
+                SINFO("Job has parentJobID: " + SToStr(plan.parentJobID) +
+                      " and no other pending children, resuming parent job");
+                if (!db.writeIdempotent("UPDATE jobs SET state='QUEUED' where jobID=" + SQ(plan.parentJobID) + ";")) {
+                    STHROW("502 Update failed");
+                }
+            }
+        } else {
+            // This is a standalone (not a child) job; delete it.
+            if (!db.writeIdempotent("DELETE FROM jobs WHERE jobID=" + SQ(jobID) + ";")) {
+                STHROW("502 Delete failed");
+            }
+
+            // At this point, all child jobs should already be deleted, but
+            // let's double check.
+            if (!db.read("SELECT 1 FROM jobs WHERE parentJobID != 0 AND parentJobID=" + SQ(jobID) + " LIMIT 1;").empty()) {
+                STHROW("405 Failed to delete a job with outstanding children");
+            }
+        }
+    }
+}
+
+map<int64_t, vector<string>> BedrockJobsCommand::_readParentJobs(SQLite& db, const list<STable>& jobs, const string& columns) {
+    set<int64_t> parentJobIDs;
+    for (const auto& job : jobs) {
+        auto it = job.find("parentJobID");
+        if (it != job.end() && SToInt64(it->second)) {
+            parentJobIDs.insert(SToInt64(it->second));
+        }
+    }
+    map<int64_t, vector<string>> parentJobs;
+    if (parentJobIDs.empty()) {
+        return parentJobs;
+    }
+    SQResult result;
+    if (!db.read("SELECT jobID, " + columns + " FROM jobs WHERE jobID IN (" + SQList(parentJobIDs) + ");", result)) {
+        STHROW("502 Select failed");
+    }
+    for (auto& row : result.rows) {
+        int64_t jobID = SToInt64(row[0]);
+        row.erase(row.begin());
+        parentJobs.emplace(jobID, move(row));
+    }
+    return parentJobs;
+}
+
+bool BedrockJobsCommand::_claimReadyJobs(set<int64_t>& claimed) {
+    size_t numResults = max(request.calc("numResults"), 1);
+    list<int64_t> jobIDs;
+    if (!_findReadyJobs(numResults + claimed.size(), jobIDs)) {
+        return true;
+    }
+    size_t count = 0;
+    for (int64_t jobID : jobIDs) {
+        if (claimed.insert(jobID).second && ++count == numResults) {
+            break;
+        }
+    }
+    return count > 0;
+}
 
 bool BedrockJobsCommand::_hasPendingChildJobs(SQLite& db, int64_t jobID) {
     // Returns true if there are any children of this jobID in a "pending" (eg,
@@ -1366,3 +2361,255 @@ void BedrockJobsCommand::handleFailedReply() {
         _plugin->server.acceptCommand(move(cmd));
     }
 }
+
+// ==========================================================================
+// Schedules aren't parsed by any one plugin or command, so they don't have a name to log with.
+#undef SLOGPREFIX
+#define SLOGPREFIX "{Jobs} "
+
+map<string, shared_ptr<const BedrockJobsRepeat>> BedrockJobsRepeat::_cache;
+mutex BedrockJobsRepeat::_cacheMutex;
+
+shared_ptr<const BedrockJobsRepeat> BedrockJobsRepeat::get(const string& repeat) {
+    // There are normally only a handful of distinct schedules, but in case someone's generating them, we don't let the
+    // cache grow forever.
+    static const size_t MAX_CACHE_SIZE = 10000;
+    lock_guard<mutex> lock(_cacheMutex);
+    auto it = _cache.find(repeat);
+    if (it != _cache.end()) {
+        return it->second;
+    }
+    if (_cache.size() >= MAX_CACHE_SIZE) {
+        _cache.clear();
+    }
+    return _cache.emplace(repeat, _parse(repeat)).first->second;
+}
+
+shared_ptr<const BedrockJobsRepeat> BedrockJobsRepeat::_parse(const string& repeat) {
+    auto schedule = make_shared<BedrockJobsRepeat>();
+    schedule->_startOfHour = false;
+
+    // Some "canned" times for convenience
+    list<string> parts;
+    if (SIEquals(repeat, "HOURLY")) {
+        parts = {"FINISHED", "+1 HOUR"};
+        schedule->_startOfHour = true;
+    } else if (SIEquals(repeat, "DAILY")) {
+        parts = {"FINISHED", "+1 DAY", "START OF DAY"};
+    } else if (SIEquals(repeat, "WEEKLY")) {
+        parts = {"FINISHED", "+1 DAY", "WEEKDAY 0", "START OF DAY"};
+    } else {
+        // Not canned, split the advanced repeat into its parts
+        parts = SParseList(SToUpper(repeat));
+        if (parts.size() < 2) {
+            SWARN("Syntax error, failed parsing repeat '" << repeat << "': too short.");
+            return nullptr;
+        }
+    }
+
+    // Make sure the first part indicates the base (eg, what we are modifying)
+    string base = parts.front();
+    parts.pop_front();
+    if (base == "SCHEDULED") {
+        schedule->_base = Base::SCHEDULED;
+    } else if (base == "STARTED") {
+        schedule->_base = Base::STARTED;
+    } else if (base == "FINISHED") {
+        schedule->_base = Base::FINISHED;
+    } else {
+        SWARN("Syntax error, failed parsing repeat '" << repeat << "': missing base (" << base << ")");
+        return nullptr;
+    }
+
+    static const map<string, int64_t> secondsPerUnit = {{"SECOND", 1}, {"MINUTE", 60}, {"HOUR", 60 * 60}, {"DAY", 24 * 60 * 60}};
+    for (const string& part : parts) {
+        // Validate the sqlite date modifiers
+        if (!SIsValidSQLiteDateModifier(part)){
+            SWARN("Syntax error, failed parsing repeat "+part);
+            return nullptr;
+        }
+        schedule->_modifiers.push_back(part);
+
+        // Now that we know it's valid, it's one of "+/-N UNIT[S]", "START OF UNIT", or "WEEKDAY N".
+        if (part == "START OF DAY") {
+            schedule->_steps.push_back({StepType::START_OF_DAY, 0});
+        } else if (part == "START OF MONTH") {
+            schedule->_steps.push_back({StepType::START_OF_MONTH, 0});
+        } else if (part == "START OF YEAR") {
+            schedule->_steps.push_back({StepType::START_OF_YEAR, 0});
+        } else if (SStartsWith(part, "WEEKDAY ")) {
+            schedule->_steps.push_back({StepType::WEEKDAY, SToInt64(part.substr(8))});
+        } else {
+            size_t space = part.find(' ');
+            int64_t count = SToInt64(part.substr(1, space - 1)) * (part[0] == '-' ? -1 : 1);
+            string unit = part.substr(space + 1);
+            if (SEndsWith(unit, "S")) {
+                unit.pop_back();
+            }
+            if (unit == "MONTH") {
+                schedule->_steps.push_back({StepType::ADD_MONTHS, count});
+            } else if (unit == "YEAR") {
+                schedule->_steps.push_back({StepType::ADD_MONTHS, count * 12});
+            } else {
+                schedule->_steps.push_back({StepType::ADD_SECONDS, count * secondsPerUnit.at(unit)});
+            }
+        }
+    }
+    if (schedule->_startOfHour) {
+        schedule->_steps.push_back({StepType::START_OF_HOUR, 0});
+    }
+    return schedule;
+}
+
+string BedrockJobsRepeat::_baseTime(const string& lastScheduled, const string& lastRun, uint64_t now) const {
+    switch (_base) {
+        case Base::SCHEDULED:
+            return lastScheduled;
+        case Base::STARTED:
+            return lastRun;
+        default:
+            return SComposeTime("%Y-%m-%d %H:%M:%S", now);
+    }
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar, and back.
+static int64_t daysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yearOfEra = year - era * 400;
+    const int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t& year, int64_t& month, int64_t& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+string BedrockJobsRepeat::nextRun(const string& lastScheduled, const string& lastRun, uint64_t now) const {
+    // We only handle the timestamps we write ourselves, "YYYY-MM-DD HH:MM:SS", or just the date. SQLite accepts all
+    // sorts of other things, which we leave to it.
+    const string base = _baseTime(lastScheduled, lastRun, now);
+    // Every field must be plain digits: sscanf would also take a sign or a space ("2020-01-01 -1:00:00"), which SQLite
+    // rejects, so we check the shape first and read the digits ourselves.
+    static const string fullPattern = "####-##-## ##:##:##";
+    const string pattern = fullPattern.substr(0, base.size() == 10 ? 10 : fullPattern.size());
+    if (base.size() != pattern.size()) {
+        return "";
+    }
+    for (size_t i = 0; i < base.size(); i++) {
+        if (pattern[i] == '#' ? !isdigit(base[i]) : base[i] != pattern[i]) {
+            return "";
+        }
+    }
+    auto field = [&base](size_t start, size_t length) {
+        int value = 0;
+        for (size_t i = start; i < start + length; i++) {
+            value = value * 10 + (base[i] - '0');
+        }
+        return value;
+    };
+    const int year = field(0, 4);
+    const int month = field(5, 2);
+    const int day = field(8, 2);
+    const int hour = base.size() == 19 ? field(11, 2) : 0;
+    const int minute = base.size() == 19 ? field(14, 2) : 0;
+    const int second = base.size() == 19 ? field(17, 2) : 0;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+        return "";
+    }
+
+    // We keep the time as whole days since the epoch, and seconds into the day. SQLite gives up (returning NULL) if
+    // the year goes outside what it can represent, in which case we let it give up.
+    int64_t days = daysFromCivil(year, month, day);
+    int64_t seconds = hour * 3600 + minute * 60 + second;
+
+    // SQLite carries a day past the end of the month (like "2020-02-30") through month arithmetic as-is, and only rolls
+    // it over at the end. That's rare enough to leave to it, too.
+    int64_t y, m, d;
+    civilFromDays(days, y, m, d);
+    if (d != day) {
+        return "";
+    }
+    const int64_t minDays = daysFromCivil(1, 1, 1);
+    const int64_t maxDays = daysFromCivil(9999, 12, 31);
+    for (const Step& step : _steps) {
+        switch (step.type) {
+            case StepType::ADD_SECONDS:
+                seconds += step.value;
+                days += seconds / 86400;
+                seconds %= 86400;
+                if (seconds < 0) {
+                    seconds += 86400;
+                    days--;
+                }
+                break;
+            case StepType::ADD_MONTHS: {
+                // The day of the month stays the same, even if that's past the end of the new month.
+                civilFromDays(days, y, m, d);
+                int64_t months = y * 12 + (m - 1) + step.value;
+                y = months >= 0 ? months / 12 : (months - 11) / 12;
+                m = months - y * 12 + 1;
+                if (y < 1 || y > 9999) {
+                    return "";
+                }
+                days = daysFromCivil(y, m, d);
+                break;
+            }
+            case StepType::START_OF_HOUR:
+                seconds -= seconds % 3600;
+                break;
+            case StepType::START_OF_DAY:
+                seconds = 0;
+                break;
+            case StepType::START_OF_MONTH:
+                civilFromDays(days, y, m, d);
+                days = daysFromCivil(y, m, 1);
+                seconds = 0;
+                break;
+            case StepType::START_OF_YEAR:
+                civilFromDays(days, y, m, d);
+                days = daysFromCivil(y, 1, 1);
+                seconds = 0;
+                break;
+            case StepType::WEEKDAY: {
+                // Moves forward to the next day that's this day of the week (0 is Sunday), unless it already is.
+                // 1970-01-01 was a Thursday.
+                int64_t weekday = ((days + 4) % 7 + 7) % 7;
+                days += (step.value - weekday + 7) % 7;
+                break;
+            }
+        }
+        if (days < minDays || days > maxDays) {
+            return "";
+        }
+    }
+
+    civilFromDays(days, y, m, d);
+    char result[20];
+    snprintf(result, sizeof(result), "%04d-%02d-%02d %02d:%02d:%02d", (int)y, (int)m, (int)d, (int)(seconds / 3600),
+             (int)(seconds / 60 % 60), (int)(seconds % 60));
+    return result;
+}
+
+string BedrockJobsRepeat::nextRunSQL(const string& lastScheduled, const string& lastRun, uint64_t now) const {
+    list<string> safeParts = {SQ(_baseTime(lastScheduled, lastRun, now))};
+    for (const string& modifier : _modifiers) {
+        safeParts.push_back(SQ(modifier));
+    }
+
+    // Combine the parts together and return the full DATETIME statement
+    string datetime = "DATETIME( " + SComposeList(safeParts) + " )";
+    if (_startOfHour) {
+        return "STRFTIME( '%Y-%m-%d %H:00:00', " + datetime + " )";
+    }
+    return datetime;
+}
@@ -1,6 +1,209 @@
 #include <libstuff/libstuff.h>
 #include "../BedrockPlugin.h"
 
+// An in-memory index of the jobs that are ready to run, or will be once their nextRun arrives (i.e., those that are
+// QUEUED or RUNQUEUED), by name, priority and nextRun. It's built when the database is opened, and then kept up to date
+// by watching every change to the jobs table as it's committed (see `SQLite::RowChangeListener`), so it sees changes
+// made by any command, as well as those replicated from peers. GetJob and GetJobs use it to answer "nothing to do"
+// without touching the database, and to look up the jobs they'll return by ID rather than searching the table for
+// them.
+class BedrockJobsReadyIndex : public SQLite::RowChangeListener {
+  public:
+    // `jobsAdded` is called whenever a commit adds jobs to the index (or changes ones that are in it), after the index
+    // has been updated, from whichever thread committed. That's while the commit is still holding its locks, so it
+    // needs to be quick.
+    BedrockJobsReadyIndex(function<void()> jobsAdded);
+
+    // Builds the index from `db` and starts watching it for changes. Nothing else can be committing to `db` while this
+    // runs. Returns false if it couldn't read the jobs, in which case the index stays unavailable.
+    bool open(SQLite& db);
+
+    // Stops watching `db`, and empties the index.
+    void close(SQLite& db);
+
+    // Number of jobs in the index.
+    size_t size() const;
+
+    // Finds up to `limit` jobs that are ready to run at `now` (as "YYYY-MM-DD HH:MM:SS"), in the order GetJobs returns
+    // them: highest priority first, then earliest nextRun. With `roundRobinAfter`, jobs of the same priority are
+    // instead taken one of each name at a time: the earliest job of every name, then the next of every name, and so
+    // on, with the names in order, starting after the one `roundRobinAfter` has for that priority. If there's more
+    // than one name in `names`, jobs must match one of them exactly, otherwise the one name is a GLOB pattern. A
+    // negative `priority` matches any of the priorities GetJobs looks at. Returns false if the index isn't available,
+    // in which case the caller needs to search the table itself.
+    bool findReady(const list<string>& names, int64_t priority, bool includeMocked,
+                   const map<int64_t, string>* roundRobinAfter, const string& now, size_t limit,
+                   list<int64_t>& jobIDs) const;
+
+    // Finds the earliest nextRun of the jobs of each name that are ready to run at `now`, for names matching the GLOB
+    // `pattern` (or all names, if it's empty). Names with nothing ready are left out. Returns false if the index isn't
+    // available.
+    bool findOldestReady(const string& pattern, const string& now, map<string, string>& nextRuns) const;
+
+    // Implement the base class to track changes to jobs.
+    void rowChanged(SQLite& db, int64_t rowID, const vector<string>& values) override;
+    void transactionComplete(SQLite& db, bool committed) override;
+
+  private:
+    struct Job {
+        string name;
+        int64_t priority;
+        string nextRun;
+        bool mocked;
+    };
+
+    // Jobs ordered by nextRun, then jobID, to keep them unique.
+    typedef set<pair<string, int64_t>> Queue;
+
+    // Add and remove jobs from `_jobs` and `_queues`. Call with `_indexMutex` locked exclusively.
+    void _add(int64_t jobID, Job&& job);
+    void _remove(int64_t jobID);
+
+    // Every job in the index, and the same jobs by name, then whether they're mocked and their priority.
+    unordered_map<int64_t, Job> _jobs;
+    map<string, map<pair<bool, int64_t>, Queue>> _queues;
+    mutable shared_timed_mutex _indexMutex;
+
+    // Set once the index has been built.
+    atomic<bool> _ready;
+
+    // Passed to the constructor.
+    function<void()> _jobsAdded;
+
+    // Changes made by transactions that haven't finished yet, by DB handle, then jobID. Jobs that aren't ready to run
+    // anymore, or have been deleted, are `nullopt`.
+    map<SQLite*, map<int64_t, optional<Job>>> _pendingChanges;
+    mutex _pendingChangesMutex;
+};
+
+// Counts of jobs by name, state and priority, for GetJobStats, so that nobody needs to count them with a `GROUP BY` over
+// the whole table. Like the ready index, they're read when the database is opened, and then kept up to date by
+// watching every change to the jobs table. Changes are only counted once they're committed, and replicated changes are
+// counted the same way as local ones, so every node has the same counts once it's caught up, whichever is leading.
+class BedrockJobsStats : public SQLite::RowChangeListener {
+  public:
+    // Name, state, priority.
+    typedef tuple<string, string, int64_t> Key;
+
+    BedrockJobsStats();
+
+    // Counts the jobs in `db` and starts watching it for changes. Nothing else can be committing to `db` while this
+    // runs. Returns false if it couldn't read the jobs, in which case the counts stay unavailable.
+    bool open(SQLite& db);
+
+    // Stops watching `db`, and discards the counts.
+    void close(SQLite& db);
+
+    // Gets the counts for names matching the GLOB `pattern` (or all names, if it's empty). Returns false if the counts
+    // aren't available.
+    bool get(const string& pattern, map<Key, int64_t>& counts) const;
+
+    // Implement the base class to count changes to jobs. We need to see what each job was before it changed, so we
+    // only use `rowReplaced`.
+    void rowChanged(SQLite& db, int64_t rowID, const vector<string>& values) override { }
+    void rowReplaced(SQLite& db, int64_t rowID, const vector<string>& oldValues, const vector<string>& values) override;
+    void transactionComplete(SQLite& db, bool committed) override;
+
+  private:
+    map<Key, int64_t> _counts;
+    mutable mutex _countsMutex;
+
+    // Set once the jobs have been counted.
+    atomic<bool> _ready;
+
+    // How much each count is changed by transactions that haven't finished yet, by DB handle.
+    map<SQLite*, map<Key, int64_t>> _pendingChanges;
+    mutex _pendingChangesMutex;
+};
+
+// Hands out job IDs from blocks reserved in the `jobIDSequence` table, so that creating a job doesn't need to look for
+// an ID that isn't in use. A block is reserved by advancing the sequence in the transaction that needs it, which is
+// replicated like any other write, so no two nodes can ever reserve the same block, even across a change of leader.
+//
+// Each DB handle gets its own block, so jobs created concurrently by different threads get IDs far enough apart that
+// they don't conflict with each other by landing on the same page. A handle can use the block it reserved in the same
+// transaction right away, but it's only kept for later transactions once that one commits, as otherwise the
+// reservation never happened.
+class BedrockJobsIDAllocator : public SQLite::RowChangeListener {
+  public:
+    // How many IDs are reserved at a time.
+    static constexpr int64_t BLOCK_SIZE = 1000;
+
+    // Starts watching `db` for reservations being committed.
+    void open(SQLite& db);
+
+    // Stops watching `db`, and discards all the blocks.
+    void close(SQLite& db);
+
+    // Returns an ID that's not in use by any job, reserving a new block in `db`'s current transaction if there's
+    // nothing left in this handle's block. Returns 0 if no block can be reserved (i.e., the sequence has run out).
+    int64_t next(SQLite& db);
+
+    // Implement the base class to find out when reservations are committed.
+    void rowChanged(SQLite& db, int64_t rowID, const vector<string>& values) override { }
+    void transactionComplete(SQLite& db, bool committed) override;
+
+  private:
+    struct Block {
+        int64_t next;
+        int64_t end;
+
+        // IDs in the block that were already in use when it was reserved.
+        set<int64_t> taken;
+    };
+
+    // Takes the next ID from `block`, or returns 0 if there isn't one.
+    static int64_t _take(Block& block);
+
+    // Blocks reserved by committed transactions, and by transactions that haven't finished yet, by DB handle.
+    map<SQLite*, Block> _blocks;
+    map<SQLite*, Block> _pendingBlocks;
+    mutex _blocksMutex;
+};
+
+// A job's `repeat`, parsed into the steps that compute its next run from when it was last scheduled, started or
+// finished. Computing the next run this way gives the same result as the DATETIME() expression SQLite would evaluate
+// for it, but each distinct `repeat` is only parsed once, and the result is written to the DB as a literal, rather
+// than as an expression for every node to evaluate.
+class BedrockJobsRepeat {
+  public:
+    // Returns the parsed `repeat`, or nullptr if it's not valid.
+    static shared_ptr<const BedrockJobsRepeat> get(const string& repeat);
+
+    // Returns the next run, as "YYYY-MM-DD HH:MM:SS", for a job that was last scheduled for `lastScheduled` and started
+    // at `lastRun`, and finished at `now`. Returns an empty string if it can't be computed here (if the time it starts
+    // from isn't a "YYYY-MM-DD[ HH:MM:SS]" timestamp, or the result is out of range), in which case `nextRunSQL`
+    // gives an expression for SQLite to compute it (or fail) instead.
+    string nextRun(const string& lastScheduled, const string& lastRun, uint64_t now) const;
+    string nextRunSQL(const string& lastScheduled, const string& lastRun, uint64_t now) const;
+
+  private:
+    enum class Base { SCHEDULED, STARTED, FINISHED };
+    enum class StepType { ADD_SECONDS, ADD_MONTHS, START_OF_HOUR, START_OF_DAY, START_OF_MONTH, START_OF_YEAR, WEEKDAY };
+    struct Step {
+        StepType type;
+        int64_t value;
+    };
+
+    // Parses `repeat`, returning nullptr if it's not valid.
+    static shared_ptr<const BedrockJobsRepeat> _parse(const string& repeat);
+
+    // Returns the time the next run is computed from.
+    string _baseTime(const string& lastScheduled, const string& lastRun, uint64_t now) const;
+
+    Base _base;
+    vector<Step> _steps;
+
+    // The SQLite date modifiers `_steps` were parsed from, and whether to truncate the result to the hour (which isn't
+    // a modifier, but is what HOURLY does).
+    list<string> _modifiers;
+    bool _startOfHour;
+
+    // Everything `get` has parsed, by `repeat`.
+    static map<string, shared_ptr<const BedrockJobsRepeat>> _cache;
+    static mutex _cacheMutex;
+};
+
 class BedrockPlugin_Jobs : public BedrockPlugin {
   friend class BedrockJobsCommand;
   public:
@@ -8,6 +211,10 @@ class BedrockPlugin_Jobs : public BedrockPlugin {
     virtual unique_ptr<BedrockCommand> getCommand(SQLiteCommand&& baseCommand);
     virtual const string& getName() const;
     virtual void upgradeDatabase(SQLite& db);
+    virtual void onDatabaseOpen(SQLite& db);
+    virtual void onDatabaseClose(SQLite& db);
+    virtual void timerFired(SStopwatch* timer);
+    virtual STable getInfo();
 
     // We were using MAX_SIZE_SMALL in GetJob to check the job name, but now GetJobs accepts more than one job name,
     // because of that, we need to increase the size of the param to be able to accept around 50 job names.
@@ -19,14 +226,70 @@ class BedrockPlugin_Jobs : public BedrockPlugin {
     const bool isLive;
 
   private:
-    static int64_t getNextID(SQLite& db);
+    int64_t getNextID(SQLite& db);
     static const string name;
     static const int64_t JOBS_DEFAULT_PRIORITY;
+
+    // Jobs that are ready to run, for GetJob and GetJobs.
+    BedrockJobsReadyIndex _readyIndex;
+
+    // Where new jobs get their IDs.
+    BedrockJobsIDAllocator _idAllocator;
+
+    // Counts of jobs, for GetJobStats.
+    BedrockJobsStats _stats;
+
+    // For GetJob and GetJobs with `order: roundRobin`, the last name that had a job taken at each priority, so that
+    // the next command starts with the name after it. This is only kept in memory, by whichever node processed the
+    // commands, so it isn't replicated: when leadership changes, the new leader starts from its own, usually empty,
+    // position, and every name gets its turn from the first one again.
+    map<int64_t, string> _roundRobinLastNames;
+    mutex _roundRobinMutex;
+
+    // Releases any held "Connection: wait" GetJob and GetJobs commands that there are now jobs for, highest priority
+    // first, and only as many as there are jobs to go around.
+    void _releaseWaitingCommands();
+
+    // Called by the ready index when a commit adds jobs. Releasing commands means peeking at the index for each held
+    // command, which is too much to do inside a commit, so this has the sync thread do it instead. However many commits
+    // add jobs before it gets to it, it only does it once, as `_releasePending` stays set until then.
+    void _jobsAdded();
+    atomic<bool> _releasePending;
+
+    // Jobs can become ready without any commit, when their nextRun arrives, so we also check for waiting commands to
+    // release each time this fires.
+    SStopwatch _waitingCommandTimer;
+
+    // How long, in seconds, finished jobs are kept before they're purged (0 to keep them forever), and the most to purge
+    // at once. Set by `-jobs.retention` and `-jobs.purgeBatchSize`.
+    const int64_t _purgeRetention;
+    const int64_t _purgeBatchSize;
+
+    // When this fires, if we're leading, we queue a PurgeJobs command to delete the next batch of finished jobs. Set by
+    // `-jobs.purgeInterval`.
+    SStopwatch _purgeTimer;
+
+    // Progress of the purge, for `getInfo`: the number of jobs and batches purged since we started, and when the last
+    // batch that purged anything was committed.
+    atomic<uint64_t> _purgedJobs;
+    atomic<uint64_t> _purgeBatches;
+    atomic<uint64_t> _lastPurge;
+
+    // Whether the `mockRequest` column has been filled in for every job. When the column is added to a live database,
+    // leader fills it in a batch at a time, sending a BackfillMockRequest each time `_mockRequestBackfillTimer` fires,
+    // and until that's done, whether a job is mocked comes from its data, as it did before there was a column. Once
+    // it's done, it stays done, so each node only needs to find out once (see
+    // `BedrockJobsCommand::_isMockRequestBackfilled`).
+    atomic<bool> _mockRequestBackfilled;
+    SStopwatch _mockRequestBackfillTimer;
+    static constexpr int64_t MOCK_REQUEST_BACKFILL_BATCH_SIZE = 1000;
 };
 
 class BedrockJobsCommand : public BedrockCommand {
+  friend class BedrockPlugin_Jobs;
   public:
     BedrockJobsCommand(SQLiteCommand&& baseCommand, BedrockPlugin_Jobs* plugin);
+    virtual ~BedrockJobsCommand();
     virtual bool peek(SQLite& db);
     virtual void process(SQLite& db);
     virtual void handleFailedReply();
@@ -34,12 +297,75 @@ class BedrockJobsCommand : public BedrockCommand {
   private:
     // Helper functions
     string _constructNextRunDATETIME(const string& lastScheduled, const string& lastRun, const string& repeat);
-    bool _validateRepeat(const string& repeat) { return !_constructNextRunDATETIME("", "", repeat).empty(); }
+    bool _validateRepeat(const string& repeat) { return BedrockJobsRepeat::get(repeat) != nullptr; }
     bool _hasPendingChildJobs(SQLite& db, int64_t jobID);
+
+    // Looks up jobs this GetJob or GetJobs could return in the ready index. Returns false if the index isn't available,
+    // or can't tell which jobs are mocked yet, as `mockRequest` hasn't been filled in.
+    bool _findReadyJobs(size_t limit, list<int64_t>& jobIDs);
+
+    // Returns a copy of the plugin's last round-robin names, by priority.
+    map<int64_t, string> _getRoundRobinLastNames();
+
+    // For a held GetJob or GetJobs, looks for ready jobs that aren't in `claimed`, and adds the ones it would take to
+    // it. Returns true if there were any (or if the index isn't available, and so we can't tell).
+    bool _claimReadyJobs(set<int64_t>& claimed);
     void _validatePriority(const int64_t priority);
 
+    // Returns true if the `mockRequest` column has been filled in for every job, so it can be trusted.
+    bool _isMockRequestBackfilled(SQLite& db);
+
+    // Returns the SQL for whether a job is mocked: the `mockRequest` column, if it can be trusted, otherwise, whatever
+    // the job's data says.
+    string _mockedSQL(SQLite& db);
+
+    // Returns the jobs to create for CreateJob or CreateJobs, or to finish or retry for FinishJob(s) or RetryJob(s),
+    // parsing them the first time it's called, so that peek and process don't both need to. Throws if they're not
+    // valid.
+    const list<STable>& _getJobs();
+
+    // What FinishJob or RetryJob is going to do to one job.
+    struct FinishJobPlan {
+        int64_t jobID;
+        int64_t parentJobID;
+        string lastRun;
+        bool retry;
+
+        // The job's new data, and for RetryJob, its new name and priority, if they're being changed.
+        string data;
+        string name;
+        string priority;
+
+        // When to run the job next, as SQL, if it's being rescheduled.
+        string safeNextRun;
+    };
+
+    // Checks that the job in `job` (which has the parameters FinishJob or RetryJob take) can be finished or retried,
+    // and works out what to do to it, without writing anything. Throws if it can't be. `_finishJob` then does it. This
+    // way, FinishJobs and RetryJobs can skip a job that fails any of the checks without having changed anything.
+    FinishJobPlan _planFinishJob(SQLite& db, bool retry, STable& job);
+    void _finishJob(SQLite& db, const FinishJobPlan& plan);
+
+    // Reads `columns` of the parents of any of `jobs` that have one, all in one query, by parent jobID. Parents that
+    // don't exist are left out.
+    static map<int64_t, vector<string>> _readParentJobs(SQLite& db, const list<STable>& jobs, const string& columns);
+
+    // Set by `_getJobs`.
+    list<STable> _jobs;
+
     bool mockRequest;
 
+    // The number of jobs deleted by PurgeJobs, which are added to the plugin's totals once it's committed.
+    size_t _purgedCount;
+
+    // The last name a round-robin GetJob or GetJobs took a job from at each priority, which the plugin's position is
+    // moved to once it's committed.
+    map<int64_t, string> _roundRobinLastNames;
+
+    // Set when BackfillMockRequest has filled in the last of the jobs, which the plugin only relies on once it's
+    // committed.
+    bool _mockRequestBackfillDone;
+
     // Returns true if this command can skip straight to leader for process.
     bool canEscalateImmediately(SQLiteCommand& baseCommand);
 };
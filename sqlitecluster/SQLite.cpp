@@ -184,6 +184,9 @@ void SQLite::commonConstructorInitialization() {
     // Do our own checkpointing.
     sqlite3_wal_hook(_db, _sqliteWALCallback, this);
 
+    // Report row changes to anything keeping in-memory state derived from them.
+    sqlite3_preupdate_hook(_db, _sqlitePreUpdateCallback, this);
+
     // Enable tracing for performance analysis.
     sqlite3_trace_v2(_db, SQLITE_TRACE_STMT, _sqliteTraceCallback, this);
 
@@ -241,7 +244,9 @@ SQLite::SQLite(const SQLite& from) :
 
 int SQLite::_progressHandlerCallback(void* arg) {
     SQLite* sqlite = static_cast<SQLite*>(arg);
-    uint64_t now = STimeNow();
+
+    // This is called constantly while a query runs, so use the cheap clock. Being a tick late to time out is fine.
+    uint64_t now = SMonotonicNowCoarse();
     if (sqlite->_timeoutLimit && now > sqlite->_timeoutLimit) {
         // Timeout! We don't throw here, we let `read` and `write` do it so we don't throw out of the middle of a
         // sqlite3 operation.
@@ -272,6 +277,14 @@ int SQLite::_sqliteTraceCallback(unsigned int traceCode, void* c, void* p, void*
     return 0;
 }
 
+void SQLite::_sqlitePreUpdateCallback(void* data, sqlite3* db, int operation, const char* dbName,
+                                      const char* tableName, sqlite3_int64 oldRowID, sqlite3_int64 newRowID) {
+    SQLite* object = static_cast<SQLite*>(data);
+    if (object->_sharedData.rowChanged(*object, db, operation, tableName, oldRowID, newRowID)) {
+        object->_rowChangesReported = true;
+    }
+}
+
 int SQLite::_sqliteWALCallback(void* data, sqlite3* db, const char* dbName, int pageCount) {
     SQLite* object = static_cast<SQLite*>(data);
     object->_sharedData._currentPageCount.store(pageCount);
@@ -299,7 +312,7 @@ int SQLite::_sqliteWALCallback(void* data, sqlite3* db, const char* dbName, int
         // things will still break.
         thread([object, filename, dbNameCopy, destructorLock = unique_lock<mutex>(object->_destructorMutex)]() {
             SInitialize("checkpoint");
-            uint64_t start = STimeNow();
+            uint64_t start = SMonotonicNow();
 
             // Lock the mutex that keeps anyone from starting a new transaction.
             unique_lock<decltype(object->_sharedData.blockNewTransactionsMutex)> transactionLock(object->_sharedData.blockNewTransactionsMutex);
@@ -330,7 +343,7 @@ int SQLite::_sqliteWALCallback(void* data, sqlite3* db, const char* dbName, int
                 if (count == 0) {
 
                     // Time and run the checkpoint operation.
-                    uint64_t checkpointStart = STimeNow();
+                    uint64_t checkpointStart = SMonotonicNow();
                     SINFO("[checkpoint] Waited " << ((checkpointStart - start) / 1000)
                           << "ms for pending transactions. Starting complete checkpoint.");
                     int walSizeFrames = 0;
@@ -338,7 +351,7 @@ int SQLite::_sqliteWALCallback(void* data, sqlite3* db, const char* dbName, int
                     int result = sqlite3_wal_checkpoint_v2(object->_db, dbNameCopy.c_str(), SQLITE_CHECKPOINT_RESTART, &walSizeFrames, &framesCheckpointed);
                     SINFO("[checkpoint] restart checkpoint complete. Result: " << result << ". Total frames checkpointed: "
                           << framesCheckpointed << " of " << walSizeFrames
-                          << " in " << ((STimeNow() - checkpointStart) / 1000) << "ms.");
+                          << " in " << ((SMonotonicNow() - checkpointStart) / 1000) << "ms.");
 
                     // We're done. Anyone can start a new transaction.
                     object->_sharedData.checkpointComplete(*object);
@@ -411,7 +424,7 @@ bool SQLite::beginTransaction(TRANSACTION_TYPE type) {
     _autoRolledBack = false;
 
     SDEBUG("[concurrent] Beginning transaction");
-    uint64_t before = STimeNow();
+    uint64_t before = SMonotonicNow();
     _currentTransactionAttemptCount = -1;
     _insideTransaction = !SQuery(_db, "starting db transaction", "BEGIN CONCURRENT");
 
@@ -424,7 +437,7 @@ bool SQLite::beginTransaction(TRANSACTION_TYPE type) {
     _queryCache.clear();
     _queryCount = 0;
     _cacheHits = 0;
-    _beginElapsed = STimeNow() - before;
+    _beginElapsed = SMonotonicNow() - before;
     _readElapsed = 0;
     _writeElapsed = 0;
     _prepareElapsed = 0;
@@ -514,7 +527,7 @@ string SQLite::read(const string& query) {
 }
 
 bool SQLite::read(const string& query, SQResult& result) {
-    uint64_t before = STimeNow();
+    uint64_t before = SMonotonicNow();
     _queryCount++;
     auto foundQuery = _queryCache.find(query);
     if (foundQuery != _queryCache.end()) {
@@ -528,7 +541,7 @@ bool SQLite::read(const string& query, SQResult& result) {
         _queryCache.emplace(make_pair(query, result));
     }
     _checkInterruptErrors("SQLite::read"s);
-    _readElapsed += STimeNow() - before;
+    _readElapsed += SMonotonicNow() - before;
     return queryResult;
 }
 
@@ -541,7 +554,7 @@ void SQLite::_checkInterruptErrors(const string& error) {
     // First check timeout. we want this to override the others, so we can't get stuck in an endless loop where we do
     // something like throw `checkpoint_required_error` forever and never notice that the command has timed out.
     if (_timeoutLimit) {
-        uint64_t now = STimeNow();
+        uint64_t now = SMonotonicNow();
         if (now > _timeoutLimit) {
             _timeoutError = now - _timeoutStart;
         }
@@ -609,7 +622,7 @@ bool SQLite::_writeIdempotent(const string& query, bool alwaysKeepQueries) {
     uint64_t changesBefore = sqlite3_total_changes(_db);
 
     // Try to execute the query
-    uint64_t before = STimeNow();
+    uint64_t before = SMonotonicNow();
     bool result = false;
     bool usedRewrittenQuery = false;
     if (_enableRewrite) {
@@ -628,7 +641,7 @@ bool SQLite::_writeIdempotent(const string& query, bool alwaysKeepQueries) {
         result = !SQuery(_db, "read/write transaction", query);
     }
     _checkInterruptErrors("SQLite::write"s);
-    _writeElapsed += STimeNow() - before;
+    _writeElapsed += SMonotonicNow() - before;
     if (!result) {
         return false;
     }
@@ -664,7 +677,7 @@ bool SQLite::prepare() {
     // Queue up the journal entry
     string lastCommittedHash = getCommittedHash(); // This is why we need the lock.
     _uncommittedHash = SToHex(SHashSHA1(lastCommittedHash + _uncommittedQuery));
-    uint64_t before = STimeNow();
+    uint64_t before = SMonotonicNow();
 
     // Crete our query.
     string query = "INSERT INTO " + _journalName + " VALUES (" + SQ(commitCount + 1) + ", " + SQ(_uncommittedQuery) + ", " + SQ(_uncommittedHash) + " )";
@@ -673,7 +686,7 @@ bool SQLite::prepare() {
     _sharedData.prepareTransactionInfo(commitCount + 1, _uncommittedQuery, _uncommittedHash, _dbCountAtStart);
 
     int result = SQuery(_db, "updating journal", query);
-    _prepareElapsed += STimeNow() - before;
+    _prepareElapsed += SMonotonicNow() - before;
     if (result) {
         // Couldn't insert into the journal; roll back the original commit
         SWARN("Unable to prepare transaction, got result: " << result << ". Rolling back: " << _uncommittedQuery);
@@ -697,7 +710,7 @@ int SQLite::commit() {
     uint64_t newJournalSize = _journalSize + 1;
     if (newJournalSize > _maxJournalSize) {
         // Delete the oldest entry
-        uint64_t before = STimeNow();
+        uint64_t before = SMonotonicNow();
         string query = "DELETE FROM " + _journalName + " "
                        "WHERE id < (SELECT MAX(id) FROM " + _journalName + ") - " + SQ(_maxJournalSize) + " "
                        "LIMIT 10";
@@ -712,7 +725,7 @@ int SQLite::commit() {
         newJournalSize = max - min;
 
         // Log timing info.
-        _writeElapsed += STimeNow() - before;
+        _writeElapsed += SMonotonicNow() - before;
     }
 
     // Make sure one is ready to commit
@@ -722,8 +735,8 @@ int SQLite::commit() {
     int startPages, dummy;
     sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_WRITE, &startPages, &dummy, 0);
 
-    uint64_t before = STimeNow();
-    uint64_t beforeCommit = STimeNow();
+    uint64_t before = SMonotonicNow();
+    uint64_t beforeCommit = SMonotonicNow();
     if (_pageLoggingEnabled) {
         {
             lock_guard<mutex> lock(_pageLogMutex);
@@ -738,7 +751,7 @@ int SQLite::commit() {
     SASSERT(result == SQLITE_OK || result == SQLITE_BUSY_SNAPSHOT);
     if (result == SQLITE_OK) {
         char time[16];
-        snprintf(time, 16, "%.2fms", (double)(STimeNow() - beforeCommit) / 1000.0);
+        snprintf(time, 16, "%.2fms", (double)(SMonotonicNow() - beforeCommit) / 1000.0);
         SINFO("SQuery 'COMMIT' took " << time << ".");
 
         // And record pages after the commit.
@@ -761,10 +774,15 @@ int SQLite::commit() {
                              (report ? string(report) : "null"s);
             syslog(LOG_DEBUG, "%s", logLine.c_str());
         }
-        _commitElapsed += STimeNow() - before;
+        _commitElapsed += SMonotonicNow() - before;
         _journalSize = newJournalSize;
         _sharedData.incrementCommit(_uncommittedHash);
-        SDEBUG("Commit successful (" << _sharedData.commitCount << "), releasing commitLock.");
+        uint64_t newCommitCount = _sharedData.commitCount;
+        if (_rowChangesReported) {
+            _rowChangesReported = false;
+            _sharedData.transactionComplete(*this, true);
+        }
+        SDEBUG("Commit successful (" << newCommitCount << "), releasing commitLock.");
         _insideTransaction = false;
         _uncommittedHash.clear();
         _uncommittedQuery.clear();
@@ -773,6 +791,9 @@ int SQLite::commit() {
         _mutexLocked = false;
         _queryCache.clear();
 
+        // Let anyone waiting for this commit know it's here.
+        _sharedData.commitComplete(newCommitCount);
+
         // Notify the checkpoint thread (if there is one) that it might be able to run now.
         {
             unique_lock<mutex> lock(_sharedData.notifyWaitMutex);
@@ -784,11 +805,11 @@ int SQLite::commit() {
         if (!_sharedData._checkpointThreadBusy) {
             int walSizeFrames = 0;
             int framesCheckpointed = 0;
-            uint64_t start = STimeNow();
+            uint64_t start = SMonotonicNow();
             int result = sqlite3_wal_checkpoint_v2(_db, 0, SQLITE_CHECKPOINT_PASSIVE, &walSizeFrames, &framesCheckpointed);
             SINFO("[checkpoint] passive checkpoint complete with " << _sharedData._currentPageCount
                   << " pages in WAL file. Result: " << result << ". Total frames checkpointed: "
-                  << framesCheckpointed << " of " << walSizeFrames << " in " << ((STimeNow() - start) / 1000) << "ms.");
+                  << framesCheckpointed << " of " << walSizeFrames << " in " << ((SMonotonicNow() - start) / 1000) << "ms.");
         }
         SINFO("Transaction commit with " << _queryCount << " queries attempted, " << _cacheHits << " served from cache.");
         _queryCount = 0;
@@ -826,9 +847,13 @@ void SQLite::rollback() {
             if (_uncommittedQuery.size()) {
                 SINFO("Rolling back transaction: " << _uncommittedQuery.substr(0, 100));
             }
-            uint64_t before = STimeNow();
+            uint64_t before = SMonotonicNow();
             SASSERT(!SQuery(_db, "rolling back db transaction", "ROLLBACK"));
-            _rollbackElapsed += STimeNow() - before;
+            _rollbackElapsed += SMonotonicNow() - before;
+        }
+        if (_rowChangesReported) {
+            _rowChangesReported = false;
+            _sharedData.transactionComplete(*this, false);
         }
 
         if (_currentTransactionAttemptCount != -1) {
@@ -1062,7 +1087,7 @@ int SQLite::_authorize(int actionCode, const char* detail1, const char* detail2,
 }
 
 void SQLite::startTiming(uint64_t timeLimitUS) {
-    _timeoutStart = STimeNow();
+    _timeoutStart = SMonotonicNow();
     _timeoutLimit = _timeoutStart + timeLimitUS;
     _timeoutError = 0;
 }
@@ -1106,6 +1131,23 @@ void SQLite::removeCheckpointListener(SQLite::CheckpointRequiredListener& listen
     _sharedData.removeCheckpointListener(listener);
 }
 
+void SQLite::addCommitListener(SQLite::CommitListener& listener) {
+    _sharedData.addCommitListener(listener);
+}
+
+void SQLite::removeCommitListener(SQLite::CommitListener& listener) {
+    _sharedData.removeCommitListener(listener);
+}
+
+void SQLite::addRowChangeListener(SQLite::RowChangeListener& listener, const string& table, const vector<int>& columns,
+                                  bool withOldValues) {
+    _sharedData.addRowChangeListener(listener, table, columns, withOldValues);
+}
+
+void SQLite::removeRowChangeListener(SQLite::RowChangeListener& listener) {
+    _sharedData.removeRowChangeListener(listener);
+}
+
 SQLite::SharedData::SharedData() :
 nextJournalCount(0),
 currentTransactionCount(0),
@@ -1114,7 +1156,8 @@ _checkpointThreadBusy(0),
 _commitLockTimer("commit lock timer", {
     {"EXCLUSIVE", chrono::steady_clock::duration::zero()},
     {"SHARED", chrono::steady_clock::duration::zero()},
-})
+}),
+_hasRowChangeListeners(false)
 { }
 
 void SQLite::SharedData::addCheckpointListener(SQLite::CheckpointRequiredListener& listener) {
@@ -1141,6 +1184,110 @@ void SQLite::SharedData::checkpointComplete(SQLite& db) {
     }
 }
 
+void SQLite::SharedData::addCommitListener(SQLite::CommitListener& listener) {
+    lock_guard<decltype(_internalStateMutex)> lock(_internalStateMutex);
+    _commitListeners.insert(&listener);
+}
+
+void SQLite::SharedData::removeCommitListener(SQLite::CommitListener& listener) {
+    lock_guard<decltype(_internalStateMutex)> lock(_internalStateMutex);
+    _commitListeners.erase(&listener);
+}
+
+void SQLite::SharedData::commitComplete(uint64_t commitCount) {
+    lock_guard<decltype(_internalStateMutex)> lock(_internalStateMutex);
+    for (auto listener : _commitListeners) {
+        listener->commitComplete(commitCount);
+    }
+}
+
+void SQLite::SharedData::addRowChangeListener(SQLite::RowChangeListener& listener, const string& table, const vector<int>& columns,
+                                              bool withOldValues) {
+    unique_lock<decltype(_rowChangeListenerMutex)> lock(_rowChangeListenerMutex);
+    _rowChangeListeners.push_back({&listener, table, columns, withOldValues});
+    _hasRowChangeListeners = true;
+}
+
+void SQLite::SharedData::removeRowChangeListener(SQLite::RowChangeListener& listener) {
+    unique_lock<decltype(_rowChangeListenerMutex)> lock(_rowChangeListenerMutex);
+    _rowChangeListeners.remove_if([&listener](const RowChangeRegistration& registration) {
+        return registration.listener == &listener;
+    });
+    _hasRowChangeListeners = !_rowChangeListeners.empty();
+}
+
+// Reads the values of `columns` of the row being changed, before the change with `sqlite3_preupdate_old`, or after it
+// with `sqlite3_preupdate_new`.
+static vector<string> preUpdateValues(sqlite3* handle, int (*get)(sqlite3*, int, sqlite3_value**), const vector<int>& columns) {
+    vector<string> values;
+    values.reserve(columns.size());
+    for (int column : columns) {
+        sqlite3_value* value = nullptr;
+        const unsigned char* text = nullptr;
+        if (get(handle, column, &value) == SQLITE_OK && value) {
+            text = sqlite3_value_text(value);
+        }
+        if (text) {
+            values.emplace_back(reinterpret_cast<const char*>(text), sqlite3_value_bytes(value));
+        } else {
+            values.emplace_back();
+        }
+    }
+    return values;
+}
+
+bool SQLite::SharedData::rowChanged(SQLite& db, sqlite3* handle, int operation, const char* table, int64_t oldRowID, int64_t newRowID) {
+    // This is called for every change to every table, so it needs to be cheap when nobody's listening.
+    if (!_hasRowChangeListeners.load()) {
+        return false;
+    }
+    shared_lock<decltype(_rowChangeListenerMutex)> lock(_rowChangeListenerMutex);
+    bool called = false;
+    for (auto& registration : _rowChangeListeners) {
+        if (!SIEquals(registration.table, table)) {
+            continue;
+        }
+        called = true;
+        RowChangeListener& listener = *registration.listener;
+        vector<string> oldValues;
+        if (registration.withOldValues && operation != SQLITE_INSERT) {
+            oldValues = preUpdateValues(handle, sqlite3_preupdate_old, registration.columns);
+        }
+        if (operation == SQLITE_DELETE) {
+            if (registration.withOldValues) {
+                listener.rowReplaced(db, oldRowID, oldValues, {});
+            } else {
+                listener.rowChanged(db, oldRowID, {});
+            }
+            continue;
+        }
+
+        // An update that changes a row's rowID looks like a delete of the old row to listeners.
+        if (operation == SQLITE_UPDATE && oldRowID != newRowID) {
+            if (registration.withOldValues) {
+                listener.rowReplaced(db, oldRowID, oldValues, {});
+                oldValues.clear();
+            } else {
+                listener.rowChanged(db, oldRowID, {});
+            }
+        }
+        vector<string> values = preUpdateValues(handle, sqlite3_preupdate_new, registration.columns);
+        if (registration.withOldValues) {
+            listener.rowReplaced(db, newRowID, oldValues, values);
+        } else {
+            listener.rowChanged(db, newRowID, values);
+        }
+    }
+    return called;
+}
+
+void SQLite::SharedData::transactionComplete(SQLite& db, bool committed) {
+    shared_lock<decltype(_rowChangeListenerMutex)> lock(_rowChangeListenerMutex);
+    for (auto& registration : _rowChangeListeners) {
+        registration.listener->transactionComplete(db, committed);
+    }
+}
+
 void SQLite::SharedData::incrementCommit(const string& commitHash) {
     lock_guard<decltype(_internalStateMutex)> lock(_internalStateMutex);
     commitCount++;
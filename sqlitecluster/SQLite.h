@@ -35,6 +35,34 @@ class SQLite {
         virtual void checkpointComplete(SQLite& db) = 0;
     };
 
+    // Abstract base class for objects that need to know as soon as anything is committed to the DB, by any handle.
+    // `commitComplete` is called by the committing thread, right after it releases the commit lock, with the new
+    // commit count.
+    class CommitListener {
+      public:
+        virtual void commitComplete(uint64_t commitCount) = 0;
+    };
+
+    // Abstract base class for objects that keep something in memory that's derived from the rows of a table, and so
+    // need to see every change to those rows, made by any handle, including changes replicated from peers. Each change
+    // is reported as it's made, and the outcome of the transaction that made it afterwards, so listeners can hold on to
+    // changes until they know whether they've been committed.
+    class RowChangeListener {
+      public:
+        // Called for each row inserted, updated or deleted, before the change is made. `values` are the requested
+        // columns of the row after the change, or empty if it's being deleted.
+        virtual void rowChanged(SQLite& db, int64_t rowID, const vector<string>& values) = 0;
+
+        // Called instead of `rowChanged` for listeners registered with `withOldValues`, which also need to know what
+        // the row was before the change. `oldValues` are the same columns before the change, or empty if the row's
+        // being inserted.
+        virtual void rowReplaced(SQLite& db, int64_t rowID, const vector<string>& oldValues, const vector<string>& values) { }
+
+        // Called once the transaction that made the changes reported for `db` since the last call to this for `db` has
+        // committed or rolled back. Commits are reported with the commit lock held, so they're seen in commit order.
+        virtual void transactionComplete(SQLite& db, bool committed) = 0;
+    };
+
     // minJournalTables: Creates journal tables through the specified number. If `-1` is passed, only `journal` is
     //                   created. If some value larger than -1 is passed, then journals `journal0000 through
     //                   journalNNNN` are created (or left alone if such tables already exist). If -2 or less is
@@ -193,6 +221,17 @@ class SQLite {
     void addCheckpointListener(CheckpointRequiredListener& listener);
     void removeCheckpointListener(CheckpointRequiredListener& listener);
 
+    // Register and deregister listeners for commits. See `CommitListener` above.
+    void addCommitListener(CommitListener& listener);
+    void removeCommitListener(CommitListener& listener);
+
+    // Register and deregister listeners for changes to the rows of `table`. `columns` are the indexes of the columns
+    // passed to `rowChanged`, and `withOldValues` says whether to pass their old values too. See `RowChangeListener`
+    // above.
+    void addRowChangeListener(RowChangeListener& listener, const string& table, const vector<int>& columns,
+                              bool withOldValues = false);
+    void removeRowChangeListener(RowChangeListener& listener);
+
     // This atomically removes and returns committed transactions from our internal list. SQLiteNode can call this, and
     // it will return a map of transaction IDs to pairs of (query, hash), so that those transactions can be replicated
     // out to peers. You can limit the number of transactions to a certain commit ID.
@@ -239,6 +278,19 @@ class SQLite {
         void checkpointRequired(SQLite& db);
         void checkpointComplete(SQLite& db);
 
+        // Add and remove and call commit listeners in a thread-safe way.
+        void addCommitListener(CommitListener& listener);
+        void removeCommitListener(CommitListener& listener);
+        void commitComplete(uint64_t commitCount);
+
+        // Add and remove row change listeners in a thread-safe way, and call them for changes made by `db`.
+        // `rowChanged` returns true if any listener was called.
+        void addRowChangeListener(RowChangeListener& listener, const string& table, const vector<int>& columns,
+                                  bool withOldValues);
+        void removeRowChangeListener(RowChangeListener& listener);
+        bool rowChanged(SQLite& db, sqlite3* handle, int operation, const char* table, int64_t oldRowID, int64_t newRowID);
+        void transactionComplete(SQLite& db, bool committed);
+
         // Update the shared state of the DB to include the newest commit with the newest hash. This needs to be done
         // after completing a commit and before releasing the commit lock.
         void incrementCommit(const string& commitHash);
@@ -298,6 +350,21 @@ class SQLite {
 
         // set of objects listening for checkpoints.
         set<SQLite::CheckpointRequiredListener*> _checkpointListeners;
+
+        // set of objects listening for commits.
+        set<SQLite::CommitListener*> _commitListeners;
+
+        // Objects listening for row changes, with the table and columns they want. These are read on every change
+        // to any table, so they have their own lock, and a flag to skip it entirely when there are no listeners.
+        struct RowChangeRegistration {
+            SQLite::RowChangeListener* listener;
+            string table;
+            vector<int> columns;
+            bool withOldValues;
+        };
+        list<RowChangeRegistration> _rowChangeListeners;
+        shared_timed_mutex _rowChangeListenerMutex;
+        atomic<bool> _hasRowChangeListeners;
         
         // This mutex is locked when we need to change the state of the _shareData object. It is shared between a
         // variety of operations (i.e., inserting checkpoint listeners, updating _committedTransactions, etc.
@@ -414,7 +481,15 @@ class SQLite {
     // Handles running checkpointing operations.
     static int _sqliteWALCallback(void* data, sqlite3* db, const char* dbName, int pageCount);
 
-    // Callback function for progress tracking.
+    // Reports row changes to any `RowChangeListener`s.
+    static void _sqlitePreUpdateCallback(void* data, sqlite3* db, int operation, const char* dbName,
+                                         const char* tableName, sqlite3_int64 oldRowID, sqlite3_int64 newRowID);
+
+    // True if changes made in the current transaction have been reported to a `RowChangeListener`, so it needs to be
+    // told how the transaction ends.
+    bool _rowChangesReported = false;
+
+    // Callback function for progress tracking. The timeout values are monotonic, see `SMonotonicNow`.
     static int _progressHandlerCallback(void* arg);
     uint64_t _timeoutLimit = 0;
     uint64_t _timeoutStart;
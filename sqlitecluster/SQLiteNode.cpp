@@ -51,7 +51,6 @@ SQLiteNode::SQLiteNode(SQLiteServer& server, SQLitePool& dbPool, const string& n
       _useParallelReplication(useParallelReplication),
       _multiReplicationThreadSpawn("multi-replication"),
       _legacyReplication("legacy-replication"),
-      _onMessageTimer("_onMESSAGE"),
       _escalateTimer("escalateCommand")
     {
 
@@ -415,7 +414,7 @@ void SQLiteNode::escalateCommand(unique_ptr<SQLiteCommand>&& command, bool forge
     if (forget) {
         SINFO("Firing and forgetting command '" << command->request.methodLine << "' to leader.");
     } else {
-        command->escalationTimeUS = STimeNow();
+        command->escalationTimeUS = SMonotonicNow();
         _escalatedCommandMap.emplace(command->id, move(command));
     }
 
@@ -431,6 +430,22 @@ list<string> SQLiteNode::getEscalatedCommandRequestMethodLines() {
     return returnList;
 }
 
+STable SQLiteNode::getMessageTiming() {
+    STable timing;
+    for (size_t i = 0; i < _messageTiming.size(); i++) {
+        const MessageTiming& t = _messageTiming[i];
+        if (!t.count) {
+            continue;
+        }
+        STable verbTiming;
+        verbTiming["count"] = to_string(t.count);
+        verbTiming["totalUS"] = to_string(chrono::duration_cast<chrono::microseconds>(t.total).count());
+        verbTiming["maxUS"] = to_string(chrono::duration_cast<chrono::microseconds>(t.max).count());
+        timing[verbName((Verb)i)] = SComposeJSONObject(verbTiming);
+    }
+    return timing;
+}
+
 // --------------------------------------------------------------------------
 // State Machine
 // --------------------------------------------------------------------------
@@ -476,13 +491,31 @@ bool SQLiteNode::update() {
                         " ms elapsed. ";
         for (auto& p : peerList) {
             if (p->s) {
-                logMsg += p->name + " sent " + to_string(p->s->getSentBytes()) + " bytes, recv " + to_string(p->s->getRecvBytes()) + " bytes. ";
+                logMsg += p->name + " sent " + to_string(p->s->getSentBytes()) + " bytes, recv " + to_string(p->s->getRecvBytes()) + " bytes";
                 p->s->resetCounters();
+                if (p->dataSocket) {
+                    logMsg += " (data channel sent " + to_string(p->dataSocket->getSentBytes()) + " bytes, recv "
+                              + to_string(p->dataSocket->getRecvBytes()) + " bytes)";
+                    p->dataSocket->resetCounters();
+                }
+                logMsg += ". ";
             } else {
                 logMsg += p->name + " has no socket. ";
             }
         }
         SINFO(logMsg);
+
+        // And how long we've spent handling each kind of message. These totals are cumulative since startup.
+        string timingMsg = "[performance] Peer message timing: ";
+        for (size_t i = 0; i < _messageTiming.size(); i++) {
+            MessageTiming& t = _messageTiming[i];
+            if (t.count) {
+                timingMsg += verbName((Verb)i) + " " + to_string(t.count) + " handled, "
+                             + to_string(chrono::duration_cast<chrono::microseconds>(t.total).count()) + "us total, "
+                             + to_string(chrono::duration_cast<chrono::microseconds>(t.max).count()) + "us max. ";
+            }
+        }
+        SINFO(timingMsg);
     }
 
     // Process the database state machine
@@ -1191,23 +1224,35 @@ bool SQLiteNode::update() {
 
 // Messages
 // Here are the messages that can be received, and how a cluster node will respond to each based on its state:
-void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
-    AutoTimerTime time(_onMessageTimer);
+void SQLiteNode::_onMESSAGE(Peer* peer, Verb verb, const SData& message) {
+    ScopedMessageTimer timer(_messageTiming[(size_t)verb]);
     SASSERT(peer);
     SASSERTWARN(!message.empty());
     SDEBUG("Received sqlitenode message from peer " << peer->name << ": " << message.serialize());
     // Every message broadcasts the current state of the node
-    if (!message.isSet("CommitCount")) {
+    if (!message.isSet(SHeaderTable::COMMIT_COUNT)) {
         STHROW("missing CommitCount");
     }
-    if (!message.isSet("Hash")) {
+    if (!message.isSet(SHeaderTable::HASH)) {
         STHROW("missing Hash");
     }
-    (*peer)["CommitCount"] = message["CommitCount"];
-    (*peer)["Hash"] = message["Hash"];
+
+    // SYNCHRONIZE_RESPONSE comes over the data channel, so it can arrive after newer messages on the control channel.
+    // Don't let its CommitCount move the peer backwards.
+    if (verb != Verb::SYNCHRONIZE_RESPONSE ||
+        message.calcU64(SHeaderTable::COMMIT_COUNT) >= peer->calcU64(SHeaderTable::COMMIT_COUNT)) {
+        (*peer)[SHeaderTable::COMMIT_COUNT] = message[SHeaderTable::COMMIT_COUNT];
+        (*peer)[SHeaderTable::HASH] = message[SHeaderTable::HASH];
+    }
+
+    // Every message other than LOGIN requires that the peer has already logged in.
+    if (verb != Verb::LOGIN && !SIEquals((*peer)["LoggedIn"], "true")) {
+        STHROW("not logged in");
+    }
 
     // Classify and process the message
-    if (SIEquals(message.methodLine, "LOGIN")) {
+    switch (verb) {
+    case Verb::LOGIN: {
         // LOGIN: This is the first message sent to and received from a new peer. It communicates the current state of
         // the peer (hash and commit count), as well as the peer's priority. Peers can connect in any state, so this
         // message can be sent and received in any state.
@@ -1239,12 +1284,18 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
         peer->set("Version",  message["Version"]);
         peer->state = stateFromName(message["State"]);
 
+        // Peers that can inflate gzipped content tell us so at login. Older peers don't send this, and we'll keep
+        // sending them uncompressed messages.
+        peer->acceptsCompression = SIEquals(message["Compression"], "gzip");
+        if (peer->acceptsCompression) {
+            PINFO("Peer accepts compressed messages.");
+        }
+
         // Let the server know that a peer has logged in.
         _server.onNodeLogin(peer);
-    } else if (!SIEquals((*peer)["LoggedIn"], "true")) {
-        STHROW("not logged in");
+        break;
     }
-    else if (SIEquals(message.methodLine, "STATE")) {
+    case Verb::STATE: {
         // STATE: Broadcast to all peers whenever a node's state changes. Also sent whenever a node commits a new query
         // (and thus has a new commit count and hash). A peer can react or respond to a peer's state change as follows:
         if (!message.isSet("State")) {
@@ -1410,7 +1461,9 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
                 }
             }
         }
-    } else if (SIEquals(message.methodLine, "STANDUP_RESPONSE")) {
+        break;
+    }
+    case Verb::STANDUP_RESPONSE: {
         // STANDUP_RESPONSE: Sent in response to the STATE message generated when a node enters the STANDINGUP state.
         // Contains a header "Response" with either the value "approve" or "deny".  This response is stored within the
         // peer for testing in the update loop.
@@ -1438,7 +1491,9 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
         } else {
             SINFO("Got STANDUP_RESPONSE but not STANDINGUP. Probably a late message, ignoring.");
         }
-    } else if (SIEquals(message.methodLine, "SYNCHRONIZE")) {
+        break;
+    }
+    case Verb::SYNCHRONIZE: {
         // If we're FOLLOWING, we'll let worker threads handle SYNCHRONIZATION messages. We don't on leader, because if
         // there's a backlog of commands, these can get stale, and by the time they reach the follower, it's already
         // behind, thus never catching up.
@@ -1464,9 +1519,11 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             // stood up.
             SData response("SYNCHRONIZE_RESPONSE");
             _queueSynchronize(peer, response, false);
-            _sendToPeer(peer, response);
+            _sendToPeer(peer, response, true);
         }
-    } else if (SIEquals(message.methodLine, "SYNCHRONIZE_RESPONSE")) {
+        break;
+    }
+    case Verb::SYNCHRONIZE_RESPONSE: {
         // SYNCHRONIZE_RESPONSE: Sent in response to a SYNCHRONIZE request. Contains a payload of zero or more COMMIT
         // messages, all of which are immediately committed to the local database.
         if (_state != SYNCHRONIZING) {
@@ -1520,7 +1577,9 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             _changeState(SEARCHING);
             throw e;
         }
-    } else if (SIEquals(message.methodLine, "SUBSCRIBE")) {
+        break;
+    }
+    case Verb::SUBSCRIBE: {
         // SUBSCRIBE: Sent by a node in the WAITING state to the current leader to begin FOLLOWING. Respond
         // SUBSCRIPTION_APPROVED with any COMMITs that the subscribing peer lacks (for example, any commits that have
         // occurred after it completed SYNCHRONIZING but before this SUBSCRIBE was received). Tag this peer as
@@ -1554,7 +1613,9 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             transaction.content = _db.getUncommittedQuery();
             _sendToPeer(peer, transaction);
         }
-    } else if (SIEquals(message.methodLine, "SUBSCRIPTION_APPROVED")) {
+        break;
+    }
+    case Verb::SUBSCRIPTION_APPROVED: {
         // SUBSCRIPTION_APPROVED: Sent by a follower's new leader to complete the subscription process. Includes zero or
         // more COMMITS that should be immediately applied to the database.
         if (_state != SUBSCRIBING) {
@@ -1577,7 +1638,11 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             _changeState(SEARCHING);
             throw e;
         }
-    } else if (SIEquals(message.methodLine, "BEGIN_TRANSACTION") || SIEquals(message.methodLine, "COMMIT_TRANSACTION") || SIEquals(message.methodLine, "ROLLBACK_TRANSACTION")) {
+        break;
+    }
+    case Verb::BEGIN_TRANSACTION:
+    case Verb::COMMIT_TRANSACTION:
+    case Verb::ROLLBACK_TRANSACTION: {
         if (_useParallelReplication) {
             if (_replicationThreadsShouldExit) {
                 SINFO("Discarding replication message, stopping FOLLOWING");
@@ -1590,19 +1655,22 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             }
         } else {
             AutoTimerTime time(_legacyReplication);
-            if (SIEquals(message.methodLine, "BEGIN_TRANSACTION")) {
+            if (verb == Verb::BEGIN_TRANSACTION) {
                 handleSerialBeginTransaction(peer, message);
-            } else if (SIEquals(message.methodLine, "COMMIT_TRANSACTION")) {
+            } else if (verb == Verb::COMMIT_TRANSACTION) {
                 handleSerialCommitTransaction(peer, message);
-            } else if (SIEquals(message.methodLine, "ROLLBACK_TRANSACTION")) {
+            } else if (verb == Verb::ROLLBACK_TRANSACTION) {
                 handleSerialRollbackTransaction(peer, message);
             }
         }
-    } else if (SIEquals(message.methodLine, "APPROVE_TRANSACTION") || SIEquals(message.methodLine, "DENY_TRANSACTION")) {
+        break;
+    }
+    case Verb::APPROVE_TRANSACTION:
+    case Verb::DENY_TRANSACTION: {
         // APPROVE_TRANSACTION: Sent to the leader by a follower when it confirms it was able to begin a transaction and
         // is ready to commit. Note that this peer approves the transaction for use in the LEADING and STANDINGDOWN
         // update loop.
-        if (!message.isSet("ID")) {
+        if (!message.isSet(SHeaderTable::ID)) {
             STHROW("missing ID");
         }
         if (!message.isSet("NewCount")) {
@@ -1614,14 +1682,14 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
         if (_state != LEADING && _state != STANDINGDOWN) {
             STHROW("not leading");
         }
-        string response = SIEquals(message.methodLine, "APPROVE_TRANSACTION") ? "approve" : "deny";
+        string response = verb == Verb::APPROVE_TRANSACTION ? "approve" : "deny";
         try {
             // We ignore late approvals of commits that have already been finalized. They could have been committed
             // already, in which case `_lastSentTransactionID` will have incremented, or they could have been rolled
             // back due to a conflict, which would cuase them to have the wrong hash (the hash of the previous attempt
             // at committing the transaction with this ID).
             bool hashMatch = message["NewHash"] == _db.getUncommittedHash();
-            if (hashMatch && to_string(_lastSentTransactionID + 1) == message["ID"]) {
+            if (hashMatch && to_string(_lastSentTransactionID + 1) == message[SHeaderTable::ID]) {
                 if (message.calcU64("NewCount") != _db.getCommitCount() + 1) {
                     STHROW("commit count mismatch. Expected: " + message["NewCount"] + ", but would actually be: "
                           + to_string(_db.getCommitCount() + 1));
@@ -1648,10 +1716,12 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
                   << message.calc("NewCount") << " (" << message["NewHash"] << ", " << message["ID"] << ") but '"
                   << e.what() << "', ignoring.");
         }
-    } else if (SIEquals(message.methodLine, "ESCALATE")) {
+        break;
+    }
+    case Verb::ESCALATE: {
         // ESCALATE: Sent to the leader by a follower. Is processed like a normal command, except when complete an
         // ESCALATE_RESPONSE is sent to the follower that initiated the escalation.
-        if (!message.isSet("ID")) {
+        if (!message.isSet(SHeaderTable::ID)) {
             STHROW("missing ID");
         }
         if (_state != LEADING) {
@@ -1661,7 +1731,7 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
                 PWARN("Received ESCALATE but not LEADING or STANDINGDOWN, aborting command.");
             }
             SData aborted("ESCALATE_ABORTED");
-            aborted["ID"] = message["ID"];
+            aborted[SHeaderTable::ID] = message[SHeaderTable::ID];
             aborted["Reason"] = "not leading";
             _sendToPeer(peer, aborted);
         } else {
@@ -1673,7 +1743,7 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             if ((*peer)["Subscribed"] != "true") {
                 STHROW("not subscribed");
             }
-            if (!message.isSet("ID")) {
+            if (!message.isSet(SHeaderTable::ID)) {
                 STHROW("missing ID");
             }
             PINFO("Received ESCALATE command for '" << message["ID"] << "' (" << request.methodLine << ")");
@@ -1681,15 +1751,17 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             // Create a new Command and send to the server.
             auto command = make_unique<SQLiteCommand>(move(request));
             command->initiatingPeerID = peer->id;
-            command->id = message["ID"];
+            command->id = message[SHeaderTable::ID];
             _server.acceptCommand(move(command), true);
         }
-    } else if (SIEquals(message.methodLine, "ESCALATE_CANCEL")) {
+        break;
+    }
+    case Verb::ESCALATE_CANCEL: {
         // ESCALATE_CANCEL: Sent to the leader by a follower. Indicates that the follower would like to cancel the escalated
         // command, such that it is not processed. For example, if the client that sent the original request
         // disconnects from the follower before an answer is returned, there is no value (and sometimes a negative value)
         // to the leader going ahead and completing it.
-        if (!message.isSet("ID")) {
+        if (!message.isSet(SHeaderTable::ID)) {
             STHROW("missing ID");
         }
         if (_state != LEADING) {
@@ -1704,10 +1776,10 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             if ((*peer)["Subscribed"] != "true") {
                 STHROW("not subscribed");
             }
-            if (!message.isSet("ID")) {
+            if (!message.isSet(SHeaderTable::ID)) {
                 STHROW("missing ID");
             }
-            const string& commandID = SToLower(message["ID"]);
+            const string& commandID = SToLower(message[SHeaderTable::ID]);
             PINFO("Received ESCALATE_CANCEL command for '" << commandID << "'");
 
             // Pass it along to the server. We don't try and cancel a command that's currently being committed. It's
@@ -1715,12 +1787,14 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             // (i.e., a few MS network latency would make it too late, anyway).
             _server.cancelCommand(commandID);
         }
-    } else if (SIEquals(message.methodLine, "ESCALATE_RESPONSE")) {
+        break;
+    }
+    case Verb::ESCALATE_RESPONSE: {
         // ESCALATE_RESPONSE: Sent when the leader processes the ESCALATE.
         if (_state != FOLLOWING) {
             STHROW("not following");
         }
-        if (!message.isSet("ID")) {
+        if (!message.isSet(SHeaderTable::ID)) {
             STHROW("missing ID");
         }
         SData response;
@@ -1730,12 +1804,12 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
 
         // Go find the escalated command
         PINFO("Received ESCALATE_RESPONSE for '" << message["ID"] << "'");
-        auto commandIt = _escalatedCommandMap.find(message["ID"]);
+        auto commandIt = _escalatedCommandMap.find(message[SHeaderTable::ID]);
         if (commandIt != _escalatedCommandMap.end()) {
             // Process the escalated command response
             unique_ptr<SQLiteCommand>& command = commandIt->second;
             if (command->escalationTimeUS) {
-                command->escalationTimeUS = STimeNow() - command->escalationTimeUS;
+                command->escalationTimeUS = SMonotonicNow() - command->escalationTimeUS;
                 SINFO("Total escalation time for command " << command->request.methodLine << " was "
                       << command->escalationTimeUS/1000 << "ms.");
             }
@@ -1746,18 +1820,20 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
         } else {
             SHMMM("Received ESCALATE_RESPONSE for unknown command ID '" << message["ID"] << "', ignoring. ");
         }
-    } else if (SIEquals(message.methodLine, "ESCALATE_ABORTED")) {
+        break;
+    }
+    case Verb::ESCALATE_ABORTED: {
         // ESCALATE_RESPONSE: Sent when the leader aborts processing an escalated command. Re-submit to the new leader.
         if (_state != FOLLOWING) {
             STHROW("not following");
         }
-        if (!message.isSet("ID")) {
+        if (!message.isSet(SHeaderTable::ID)) {
             STHROW("missing ID");
         }
         PINFO("Received ESCALATE_ABORTED for '" << message["ID"] << "' (" << message["Reason"] << ")");
 
         // Look for that command
-        auto commandIt = _escalatedCommandMap.find(message["ID"]);
+        auto commandIt = _escalatedCommandMap.find(message[SHeaderTable::ID]);
         if (commandIt != _escalatedCommandMap.end()) {
             // Re-queue this
             unique_ptr<SQLiteCommand>& command = commandIt->second;
@@ -1767,12 +1843,19 @@ void SQLiteNode::_onMESSAGE(Peer* peer, const SData& message) {
             _escalatedCommandMap.erase(commandIt);
         } else
             SWARN("Received ESCALATE_ABORTED for unescalated command " << message["ID"] << ", ignoring.");
-    } else if (SIEquals(message.methodLine, "CRASH_COMMAND") || SIEquals(message.methodLine, "BROADCAST_COMMAND")) {
+        break;
+    }
+    case Verb::CRASH_COMMAND:
+    case Verb::BROADCAST_COMMAND: {
         // Create a new Command and send to the server.
         SData messageCopy = message;
         PINFO("Received " << message.methodLine << " command, forwarding to server.");
         _server.acceptCommand(make_unique<SQLiteCommand>(move(messageCopy)), true);
-    } else {
+        break;
+    }
+    default:
+        // Count these so we can see if a peer on a different version is sending us things we don't understand.
+        peer->unknownMessages++;
         STHROW("unrecognized message");
     }
 }
@@ -1787,6 +1870,7 @@ void SQLiteNode::_onConnect(Peer* peer) {
     login["State"] = stateName(_state);
     login["Version"] = _version;
     login["Permafollower"] = _originalPriority ? "false" : "true";
+    login["Compression"] = "gzip";
     _sendToPeer(peer, login);
 }
 
@@ -1889,7 +1973,7 @@ void SQLiteNode::_onDisconnect(Peer* peer) {
     }
 }
 
-void SQLiteNode::_sendToPeer(Peer* peer, const SData& message) {
+void SQLiteNode::_sendToPeer(Peer* peer, const SData& message, bool bulk) {
     SASSERT(peer);
     SASSERT(!message.empty());
 
@@ -1900,28 +1984,35 @@ void SQLiteNode::_sendToPeer(Peer* peer, const SData& message) {
     }
     // Piggyback on whatever we're sending to add the CommitCount/Hash
     SData messageCopy = message;
-    messageCopy["CommitCount"] = to_string(_db.getCommitCount());
-    messageCopy["Hash"] = _db.getCommittedHash();
-    peer->s->send(messageCopy.serialize());
+    messageCopy[SHeaderTable::COMMIT_COUNT] = to_string(_db.getCommitCount());
+    messageCopy[SHeaderTable::HASH] = _db.getCommittedHash();
+    peer->sendMessage(messageCopy, bulk);
 }
 
 void SQLiteNode::_sendToAllPeers(const SData& message, bool subscribedOnly) {
     // Piggyback on whatever we're sending to add the CommitCount/Hash, but only serialize once before broadcasting.
     SData messageCopy = message;
-    if (!messageCopy.isSet("CommitCount")) {
-        messageCopy["CommitCount"] = SToStr(_db.getCommitCount());
+    if (!messageCopy.isSet(SHeaderTable::COMMIT_COUNT)) {
+        messageCopy[SHeaderTable::COMMIT_COUNT] = SToStr(_db.getCommitCount());
     }
-    if (!messageCopy.isSet("Hash")) {
-        messageCopy["Hash"] = _db.getCommittedHash();
+    if (!messageCopy.isSet(SHeaderTable::HASH)) {
+        messageCopy[SHeaderTable::HASH] = _db.getCommittedHash();
     }
-    const string& serializedMessage = messageCopy.serialize();
+    // We serialize at most twice, once for peers that accept compression and once for those that don't, and only as
+    // needed.
+    string serializedMessage;
+    string compressedMessage;
 
     // Loop across all connected peers and send the message
     for (auto peer : peerList) {
         // Send either to everybody, or just subscribed peers.
         if (peer->s && (!subscribedOnly || SIEquals((*peer)["Subscribed"], "true"))) {
             // Send it now, without waiting for the outer event loop
-            peer->s->send(serializedMessage);
+            string& toSend = peer->acceptsCompression ? compressedMessage : serializedMessage;
+            if (toSend.empty()) {
+                toSend = serializeForPeer(messageCopy, peer->acceptsCompression);
+            }
+            peer->s->send(toSend);
         }
     }
 }
@@ -2338,7 +2429,7 @@ bool SQLiteNode::peekPeerCommand(SQLiteNode* node, SQLite& db, SQLiteCommand& co
             // The following two lines are copied from `_sendToPeer`.
             command.response["CommitCount"] = to_string(db.getCommitCount());
             command.response["Hash"] = db.getCommittedHash();
-            peer->sendMessage(command.response);
+            peer->sendMessage(command.response, true);
             return true;
         }
     } catch (const SException& e) {
@@ -2418,7 +2509,7 @@ void SQLiteNode::handlePrepareTransaction(SQLite& db, Peer* peer, const SData& m
     bool success = true;
     uint64_t leaderSentTimestamp = message.calcU64("leaderSendTime");
     uint64_t followerDequeueTimestamp = STimeNow();
-    if (!message.isSet("ID")) {
+    if (!message.isSet(SHeaderTable::ID)) {
         STHROW("missing ID");
     }
     if (!message.isSet("NewCount")) {
@@ -2460,13 +2551,13 @@ void SQLiteNode::handlePrepareTransaction(SQLite& db, Peer* peer, const SData& m
     if (_priority) {
         // If the ID is /ASYNC_\d+/, no need to respond, leader will ignore it anyway.
         string verb = success ? "APPROVE_TRANSACTION" : "DENY_TRANSACTION";
-        if (!SStartsWith(message["ID"], "ASYNC_")) {
+        if (!SStartsWith(message[SHeaderTable::ID], "ASYNC_")) {
             // Not a permafollower, approve the transaction
             PINFO(verb << " #" << db.getCommitCount() + 1 << " (" << message["NewHash"] << ").");
             SData response(verb);
             response["NewCount"] = SToStr(db.getCommitCount() + 1);
             response["NewHash"] = success ? db.getUncommittedHash() : message["NewHash"];
-            response["ID"] = message["ID"];
+            response[SHeaderTable::ID] = message[SHeaderTable::ID];
             lock_guard<mutex> leadPeerLock(_leadPeerMutex);
             if (!_leadPeer) {
                 STHROW("no leader?");
@@ -2540,7 +2631,7 @@ void SQLiteNode::handleRollbackTransaction(SQLite& db, Peer* peer, const SData&
     AutoScopedWallClockTimer timer(_syncTimer);
     // ROLLBACK_TRANSACTION: Sent to all subscribed followers by the leader when it determines that the current
     // outstanding transaction should be rolled back. This completes a given distributed transaction.
-    if (!message.isSet("ID")) {
+    if (!message.isSet(SHeaderTable::ID)) {
         STHROW("missing ID");
     }
     if (_state != FOLLOWING) {
@@ -2572,7 +2663,7 @@ void SQLiteNode::handleSerialBeginTransaction(Peer* peer, const SData& message)
     bool success = true;
     uint64_t leaderSentTimestamp = message.calcU64("leaderSendTime");
     uint64_t followerDequeueTimestamp = STimeNow();
-    if (!message.isSet("ID")) {
+    if (!message.isSet(SHeaderTable::ID)) {
         STHROW("missing ID");
     }
     if (!message.isSet("NewCount")) {
@@ -2641,13 +2732,13 @@ void SQLiteNode::handleSerialBeginTransaction(Peer* peer, const SData& message)
     if (_priority) {
         // If the ID is /ASYNC_\d+/, no need to respond, leader will ignore it anyway.
         string verb = success ? "APPROVE_TRANSACTION" : "DENY_TRANSACTION";
-        if (!SStartsWith(message["ID"], "ASYNC_")) {
+        if (!SStartsWith(message[SHeaderTable::ID], "ASYNC_")) {
             // Not a permafollower, approve the transaction
             PINFO(verb << " #" << _db.getCommitCount() + 1 << " (" << message["NewHash"] << ").");
             SData response(verb);
             response["NewCount"] = SToStr(_db.getCommitCount() + 1);
             response["NewHash"] = success ? _db.getUncommittedHash() : message["NewHash"];
-            response["ID"] = message["ID"];
+            response[SHeaderTable::ID] = message[SHeaderTable::ID];
             _sendToPeer(_leadPeer, response);
         } else {
             PINFO("Skipping " << verb << " for ASYNC command.");
@@ -2713,7 +2804,7 @@ void SQLiteNode::handleSerialRollbackTransaction(Peer* peer, const SData& messag
     AutoScopedWallClockTimer timer(_syncTimer);
     // ROLLBACK_TRANSACTION: Sent to all subscribed followers by the leader when it determines that the current
     // outstanding transaction should be rolled back. This completes a given distributed transaction.
-    if (!message.isSet("ID")) {
+    if (!message.isSet(SHeaderTable::ID)) {
         STHROW("missing ID");
     }
     if (_state != FOLLOWING) {
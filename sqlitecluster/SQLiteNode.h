@@ -98,6 +98,10 @@ class SQLiteNode : public STCPNode {
     // This exists so that the _server can inspect internal state for diagnostic purposes.
     list<string> getEscalatedCommandRequestMethodLines();
 
+    // Returns the number of messages handled, and the total and max time spent handling them, for each peer message
+    // verb, as JSON objects keyed by verb name. Like the above, this is for the _server's diagnostics.
+    STable getMessageTiming();
+
     // This mutex is exposed publicly so that others (particularly, the _server) can atomically act on the current
     // state of the node. When working with this and SQLite::g_commitLock, the correct order of acquisition is always:
     // 1. stateMutex
@@ -111,7 +115,7 @@ class SQLiteNode : public STCPNode {
     // STCPNode API: Peer handling framework functions
     void _onConnect(Peer* peer);
     void _onDisconnect(Peer* peer);
-    void _onMESSAGE(Peer* peer, const SData& message);
+    void _onMESSAGE(Peer* peer, Verb verb, const SData& message);
 
     // This is a pool of DB handles that this node can use for any DB access it needs. Currently, it hands them out to
     // replication threads as required. It's passed in via the constructor.
@@ -180,7 +184,9 @@ class SQLiteNode : public STCPNode {
     uint64_t _lastQuorumTime;
 
     // Helper methods
-    void _sendToPeer(Peer* peer, const SData& message);
+    // Sends a message to a single peer. If `bulk` is set, it can go over the peer's data channel (see
+    // STCPNode::Peer::sendMessage).
+    void _sendToPeer(Peer* peer, const SData& message, bool bulk = false);
     void _sendToAllPeers(const SData& message, bool subscribedOnly = false);
     void _changeState(State newState);
 
@@ -275,8 +281,31 @@ class SQLiteNode : public STCPNode {
         CounterType& _counter;
     };
 
+    // Accumulated handling time for each message verb received from peers.
+    struct MessageTiming {
+        uint64_t count = 0;
+        chrono::steady_clock::duration total = chrono::steady_clock::duration::zero();
+        chrono::steady_clock::duration max = chrono::steady_clock::duration::zero();
+    };
+    array<MessageTiming, (size_t)Verb::NUM_VERBS> _messageTiming;
+
+    // Utility class that records the time between its construction and destruction into a MessageTiming, so handlers
+    // that throw are still counted.
+    class ScopedMessageTimer {
+      public:
+        ScopedMessageTimer(MessageTiming& timing) : _timing(timing), _start(chrono::steady_clock::now()) {}
+        ~ScopedMessageTimer() {
+            auto elapsed = chrono::steady_clock::now() - _start;
+            _timing.count++;
+            _timing.total += elapsed;
+            _timing.max = std::max(_timing.max, elapsed);
+        }
+      private:
+        MessageTiming& _timing;
+        chrono::steady_clock::time_point _start;
+    };
+
     AutoTimer _multiReplicationThreadSpawn;
     AutoTimer _legacyReplication;
-    AutoTimer _onMessageTimer;
     AutoTimer _escalateTimer;
 };
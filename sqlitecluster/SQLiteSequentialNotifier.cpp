@@ -23,11 +23,58 @@ SQLiteSequentialNotifier::RESULT SQLiteSequentialNotifier::waitFor(uint64_t valu
     }
 }
 
+uint64_t SQLiteSequentialNotifier::notifyWhen(uint64_t value, function<void(RESULT)> callback) {
+    RESULT result = RESULT::UNKNOWN;
+    {
+        lock_guard<mutex> lock(_internalStateMutex);
+        if (_globalResult == RESULT::CANCELED) {
+            result = RESULT::CANCELED;
+        } else if (value <= _value) {
+            result = RESULT::COMPLETED;
+        } else {
+            uint64_t id = _nextCallbackID++;
+            auto it = _valueToPendingCallbackMap.emplace(value, make_pair(id, move(callback)));
+            _pendingCallbacks.emplace(id, it);
+            return id;
+        }
+    }
+    callback(result);
+    return 0;
+}
+
+bool SQLiteSequentialNotifier::removeCallback(uint64_t id) {
+    lock_guard<mutex> lock(_internalStateMutex);
+    auto it = _pendingCallbacks.find(id);
+    if (it == _pendingCallbacks.end()) {
+        return false;
+    }
+    _valueToPendingCallbackMap.erase(it->second);
+    _pendingCallbacks.erase(it);
+    return true;
+}
+
 void SQLiteSequentialNotifier::notifyThrough(uint64_t value) {
+    // Callbacks that are ready get called once we've released our lock, so they can do whatever they need to,
+    // including registering new callbacks.
+    list<function<void(RESULT)>> callbacks;
+    _notifyThrough(value, callbacks);
+    for (auto& callback : callbacks) {
+        callback(RESULT::COMPLETED);
+    }
+}
+
+void SQLiteSequentialNotifier::_notifyThrough(uint64_t value, list<function<void(RESULT)>>& callbacks) {
     lock_guard<mutex> lock(_internalStateMutex);
     if (value > _value) {
         _value = value;
     }
+    auto callbackIt = _valueToPendingCallbackMap.begin();
+    while (callbackIt != _valueToPendingCallbackMap.end() && callbackIt->first <= value) {
+        _pendingCallbacks.erase(callbackIt->second.first);
+        callbacks.push_back(move(callbackIt->second.second));
+        callbackIt = _valueToPendingCallbackMap.erase(callbackIt);
+    }
+
     auto lastToDelete = _valueToPendingThreadMap.begin();
     for (auto it = _valueToPendingThreadMap.begin(); it != _valueToPendingThreadMap.end(); it++) {
         if (it->first > value)  {
@@ -55,15 +102,26 @@ void SQLiteSequentialNotifier::notifyThrough(uint64_t value) {
 }
 
 void SQLiteSequentialNotifier::cancel() {
-    lock_guard<mutex> lock(_internalStateMutex);
-    _globalResult = RESULT::CANCELED;
-    for (auto& p : _valueToPendingThreadMap) {
-        lock_guard<mutex> lock(p.second->waitingThreadMutex);
-        p.second->result = RESULT::CANCELED;
-        p.second->waitingThreadConditionVariable.notify_all();
+    list<function<void(RESULT)>> callbacks;
+    {
+        lock_guard<mutex> lock(_internalStateMutex);
+        _globalResult = RESULT::CANCELED;
+        for (auto& p : _valueToPendingThreadMap) {
+            lock_guard<mutex> lock(p.second->waitingThreadMutex);
+            p.second->result = RESULT::CANCELED;
+            p.second->waitingThreadConditionVariable.notify_all();
+        }
+        _valueToPendingThreadMap.clear();
+        for (auto& p : _valueToPendingCallbackMap) {
+            callbacks.push_back(move(p.second.second));
+        }
+        _valueToPendingCallbackMap.clear();
+        _pendingCallbacks.clear();
+        _value = 0;
+    }
+    for (auto& callback : callbacks) {
+        callback(RESULT::CANCELED);
     }
-    _valueToPendingThreadMap.clear();
-    _value = 0;
 }
 
 void SQLiteSequentialNotifier::checkpointRequired(SQLite& db) {
@@ -82,6 +140,10 @@ void SQLiteSequentialNotifier::checkpointComplete(SQLite& db) {
     _globalResult = RESULT::UNKNOWN;
 }
 
+void SQLiteSequentialNotifier::commitComplete(uint64_t commitCount) {
+    notifyThrough(commitCount);
+}
+
 void SQLiteSequentialNotifier::reset() {
     lock_guard<mutex> lock(_internalStateMutex);
     _globalResult = RESULT::UNKNOWN;
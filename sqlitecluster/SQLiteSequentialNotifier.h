@@ -16,7 +16,10 @@
 // `waitFor` in transaction B will be interrupted and throw checkpoint_required_error, causing the transaction to be
 // aborted and restarted, which unblocks the checkpoint. Then, the checkpoint will complete, transaction A can run, and
 // checkpoint B can complete.
-class SQLiteSequentialNotifier : public SQLite::CheckpointRequiredListener {
+//
+// It also implements `CommitListener`, so that a notifier can be registered with a DB to be notified through each new
+// commit count as it's committed, for things that want to know when a particular commit has arrived.
+class SQLiteSequentialNotifier : public SQLite::CheckpointRequiredListener, public SQLite::CommitListener {
   public:
 
     // Enumeration of all the possible states to result from waiting.
@@ -28,12 +31,22 @@ class SQLiteSequentialNotifier : public SQLite::CheckpointRequiredListener {
     };
 
     // Constructor
-    SQLiteSequentialNotifier() : _value(0), _globalResult(RESULT::UNKNOWN) {}
+    SQLiteSequentialNotifier() : _value(0), _globalResult(RESULT::UNKNOWN), _nextCallbackID(1) {}
 
     // Blocks until `_value` meets or exceeds `value`, unless an exceptional case (CANCELED, CHEKPOINT_REQUIRED) is
     // hit, and returns the corresponding RESULT.
     SQLiteSequentialNotifier::RESULT waitFor(uint64_t value);
 
+    // Non-blocking version of `waitFor`. Once `_value` meets or exceeds `value`, calls `callback` with COMPLETED, or
+    // with CANCELED if `cancel` is called first. Unlike `waitFor`, these aren't interrupted for checkpoints, as they
+    // don't hold a transaction open. `callback` is called with none of our locks held, by whichever thread calls
+    // `notifyThrough` or `cancel`, or by this thread before returning, if there's already a result.
+    // Returns an ID that can be passed to `removeCallback`, or 0 if `callback` has already been called.
+    uint64_t notifyWhen(uint64_t value, function<void(RESULT)> callback);
+
+    // Removes a callback registered with `notifyWhen`. Returns false if it's already been called, or is being called.
+    bool removeCallback(uint64_t id);
+
     // Causes any threads waiting for a value up to and including `value` to return `true`.
     void notifyThrough(uint64_t value);
 
@@ -45,12 +58,18 @@ class SQLiteSequentialNotifier : public SQLite::CheckpointRequiredListener {
     void checkpointRequired(SQLite& db) override;
     void checkpointComplete(SQLite& db) override;
 
+    // Implement the base class to notify through each commit.
+    void commitComplete(uint64_t commitCount) override;
+
     // After calling `reset`, all calls to `waitFor` return `false` until this is called, and then they will wait
     // again. This allows for a caller to call `cancel`, wait for the completion of their threads, and then call
     // `reset` to use the object again.
     void reset();
 
   private:
+    // Does the work of `notifyThrough`, with our lock held, returning any callbacks that need calling.
+    void _notifyThrough(uint64_t value, list<function<void(RESULT)>>& callbacks);
+
     // This encapsulates the set of values we need to have a thread wait. It's a mutex and condition_variable that the
     // thread can use to wait, and a result indicating if the required result has actually been reached (because
     // condition_variables can be spuriously interrupted and need a second `wait()` call).
@@ -68,4 +87,10 @@ class SQLiteSequentialNotifier : public SQLite::CheckpointRequiredListener {
     // If there is a global result for all pending operations (i.e., they've been canceled or a checkpoint needs to
     // happen), that is stored here.
     RESULT _globalResult;
+
+    // Callbacks registered with `notifyWhen`, by the value they're waiting for, with their IDs. The second map finds
+    // them by ID for `removeCallback`.
+    multimap<uint64_t, pair<uint64_t, function<void(RESULT)>>> _valueToPendingCallbackMap;
+    map<uint64_t, decltype(_valueToPendingCallbackMap)::iterator> _pendingCallbacks;
+    uint64_t _nextCallbackID;
 };
@@ -0,0 +1,149 @@
+#include <libstuff/libstuff.h>
+#include <libstuff/SHTTPSManager.h>
+#include <test/lib/BedrockTester.h>
+
+// A standalone manager that exposes `_httpsSend` so we can drive it directly.
+class PoolTestManager : public SStandaloneHTTPSManager {
+  public:
+    Transaction* send(const string& url, const SData& request) {
+        return _httpsSend(url, request);
+    }
+};
+
+struct HTTPSManagerTest : tpunit::TestFixture {
+    HTTPSManagerTest()
+        : tpunit::TestFixture("HTTPSManager",
+                              TEST(HTTPSManagerTest::testCanReuseConnection),
+                              TEST(HTTPSManagerTest::testCanRetryRequest),
+                              TEST(HTTPSManagerTest::testConnectionReuse),
+                              TEST(HTTPSManagerTest::testSharedSSLConfig))
+    { }
+
+    void testCanReuseConnection() {
+        SData request("GET / HTTP/1.1");
+        SData response("HTTP/1.1 200 OK");
+        response["Content-Length"] = "0";
+        ASSERT_TRUE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+
+        // Either side can ask to close.
+        request["Connection"] = "Close";
+        ASSERT_FALSE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+        request.erase("Connection");
+        response["Connection"] = "close";
+        ASSERT_FALSE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+        response.erase("Connection");
+
+        // HTTP/1.0 needs to opt in.
+        response.methodLine = "HTTP/1.0 200 OK";
+        ASSERT_FALSE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+        response["Connection"] = "keep-alive";
+        ASSERT_TRUE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+
+        // And we need to know where the response ended.
+        response.methodLine = "HTTP/1.1 200 OK";
+        response.erase("Content-Length");
+        ASSERT_FALSE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+        response["Transfer-Encoding"] = "chunked";
+        ASSERT_TRUE(SStandaloneHTTPSManager::canReuseConnection(request, response));
+    }
+
+    void testCanRetryRequest() {
+        // Only idempotent requests are resent when a pooled connection closes under them.
+        for (const char* method : {"GET", "HEAD", "PUT", "DELETE", "OPTIONS"}) {
+            ASSERT_TRUE(SStandaloneHTTPSManager::canRetryRequest(SData(string(method) + " / HTTP/1.1")));
+        }
+        ASSERT_FALSE(SStandaloneHTTPSManager::canRetryRequest(SData("POST / HTTP/1.1")));
+        ASSERT_FALSE(SStandaloneHTTPSManager::canRetryRequest(SData("PATCH / HTTP/1.1")));
+    }
+
+    // Runs both the local server and the manager until `transaction` completes. The server answers every request it
+    // gets with `responseConnection` as the `Connection` header, if set.
+    void runUntilComplete(STCPServer& server, PoolTestManager& manager, SStandaloneHTTPSManager::Transaction* transaction,
+                          const string& responseConnection = "") {
+        uint64_t start = STimeNow();
+        while (!transaction->response && STimeNow() < start + 5 * STIME_US_PER_S) {
+            fd_map fdm;
+            server.prePoll(fdm);
+            manager.prePoll(fdm);
+            S_poll(fdm, 100'000);
+            server.postPoll(fdm);
+            uint64_t nextActivity = STimeNow() + STIME_US_PER_S;
+            list<SStandaloneHTTPSManager::Transaction*> completed;
+            manager.postPoll(fdm, nextActivity, completed);
+
+            // Accept anything new, and answer anything we've received.
+            while (server.acceptSocket()) {
+                acceptedSockets++;
+            }
+            for (auto s : server.socketList) {
+                SData request;
+                int size = request.deserialize(s->recvBuffer);
+                if (size) {
+                    s->recvBuffer.consumeFront(size);
+                    SData response("HTTP/1.1 200 OK");
+                    if (!responseConnection.empty()) {
+                        response["Connection"] = responseConnection;
+                    }
+                    response.content = "hello";
+                    s->send(response.serialize());
+                }
+            }
+        }
+        ASSERT_EQUAL(transaction->response, 200);
+    }
+
+    void testConnectionReuse() {
+        uint16_t port = BedrockTester::ports.getPort();
+        string host = "127.0.0.1:" + to_string(port);
+        STCPServer server(host);
+        PoolTestManager manager;
+        acceptedSockets = 0;
+
+        // Send several requests one after another. They should all go over the same connection.
+        for (int i = 0; i < 3; i++) {
+            SData request("GET / HTTP/1.1");
+            request["Host"] = "localhost";
+            auto transaction = manager.send("http://" + host + "/", request);
+            runUntilComplete(server, manager, transaction);
+            ASSERT_EQUAL(transaction->fullResponse.content, "hello");
+            ASSERT_EQUAL(transaction->reusedSocket, i > 0);
+            manager.closeTransaction(transaction);
+            ASSERT_EQUAL(manager.idleConnectionCount(), 1);
+        }
+        ASSERT_EQUAL(acceptedSockets, 1);
+
+        // If the server says to close, the connection isn't pooled, and the next request needs a new one.
+        SData request("GET / HTTP/1.1");
+        request["Host"] = "localhost";
+        auto transaction = manager.send("http://" + host + "/", request);
+        runUntilComplete(server, manager, transaction, "close");
+        manager.closeTransaction(transaction);
+        ASSERT_EQUAL(manager.idleConnectionCount(), 0);
+        transaction = manager.send("http://" + host + "/", request);
+        runUntilComplete(server, manager, transaction);
+        ASSERT_FALSE(transaction->reusedSocket);
+        manager.closeTransaction(transaction);
+        ASSERT_EQUAL(acceptedSockets, 2);
+
+        BedrockTester::ports.returnPort(port);
+    }
+
+    void testSharedSSLConfig() {
+        // Any number of connections can be set up against one config, and they all keep it alive.
+        shared_ptr<SSSLConfig> config = make_shared<SSSLConfig>(SX509Open());
+        SSSLState* first = SSSLOpen(0, config, "www.example.com:443");
+        SSSLState* second = SSSLOpen(0, config, "www.example.com:443");
+        ASSERT_EQUAL(config.use_count(), 3);
+        ASSERT_EQUAL(first->host, "www.example.com:443");
+
+        // Nothing has completed a handshake, so there's nothing to resume.
+        ASSERT_EQUAL(config->sessionCount(), 0);
+        ASSERT_FALSE(config->loadSession("www.example.com:443", first->ssl));
+
+        SSSLClose(first);
+        SSSLClose(second);
+        ASSERT_EQUAL(config.use_count(), 1);
+    }
+
+    int acceptedSockets;
+} __HTTPSManagerTest;
@@ -6,6 +6,8 @@ struct LibStuff : tpunit::TestFixture {
                                     TEST(LibStuff::testEncryptDecrpyt),
                                     TEST(LibStuff::testSHMACSHA1),
                                     TEST(LibStuff::testSHMACSHA256),
+                                    TEST(LibStuff::testSHA),
+                                    TEST(LibStuff::testBase64),
                                     TEST(LibStuff::testJSONDecode),
                                     TEST(LibStuff::testJSON),
                                     TEST(LibStuff::testEscapeUnescape),
@@ -14,17 +16,24 @@ struct LibStuff : tpunit::TestFixture {
                                     TEST(LibStuff::testStrip),
                                     TEST(LibStuff::testChunkedEncoding),
                                     TEST(LibStuff::testDaysInMonth),
+                                    TEST(LibStuff::testClocks),
                                     TEST(LibStuff::testGZip),
                                     TEST(LibStuff::testConstantTimeEquals),
                                     TEST(LibStuff::testParseIntegerList),
                                     TEST(LibStuff::testSData),
                                     TEST(LibStuff::testSTable),
+                                    TEST(LibStuff::testHeaderTable),
+                                    TEST(LibStuff::testSynchronizedQueue),
+                                    TEST(LibStuff::testTimerWheel),
                                     TEST(LibStuff::testFileIO),
                                     TEST(LibStuff::testSQList),
                                     TEST(LibStuff::testRandom),
                                     TEST(LibStuff::testHexConversion),
                                     TEST(LibStuff::testBase32Conversion),
-                                    TEST(LibStuff::testContains))
+                                    TEST(LibStuff::testContains),
+                                    TEST(LibStuff::testPeerVerbs),
+                                    TEST(LibStuff::testAsyncLogging),
+                                    TEST(LibStuff::testLogLevel))
     { }
 
     void testEncryptDecrpyt() {
@@ -48,6 +57,48 @@ struct LibStuff : tpunit::TestFixture {
         ASSERT_EQUAL(SToHex(SHMACSHA256("key", "Only a Sith deals in absolutes")), "524C9B1C0B6E9F47F10041A429FCB2C880129F940DC9E41F31267E0909D46845");
     }
 
+    void testSHA() {
+        // Lengths either side of where the padding spills into a second block, and a few blocks' worth.
+        ASSERT_EQUAL(SToHex(SHashSHA1("")), "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709");
+        ASSERT_EQUAL(SToHex(SHashSHA1("abc")), "A9993E364706816ABA3E25717850C26C9CD0D89D");
+        ASSERT_EQUAL(SToHex(SHashSHA1(string(55, 'a'))), "C1C8BBDC22796E28C0E15163D20899B65621D65A");
+        ASSERT_EQUAL(SToHex(SHashSHA1(string(56, 'a'))), "C2DB330F6083854C99D4B5BFB6E8F29F201BE699");
+        ASSERT_EQUAL(SToHex(SHashSHA1(string(64, 'a'))), "0098BA824B5C16427BD7A1122A5A442A25EC644D");
+        ASSERT_EQUAL(SToHex(SHashSHA1(string(1000, 'a'))), "291E9A6C66994949B57BA5E650361E98FC36B1BA");
+        ASSERT_EQUAL(SToHex(SHashSHA256("")), "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855");
+        ASSERT_EQUAL(SToHex(SHashSHA256("abc")), "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD");
+        ASSERT_EQUAL(SToHex(SHashSHA256(string(55, 'a'))), "9F4390F8D30C2DD92EC9F095B65E2B9AE9B0A925A5258E241C9F1E910F734318");
+        ASSERT_EQUAL(SToHex(SHashSHA256(string(56, 'a'))), "B35439A4AC6F0948B6D6F9E3C6AF0F5F590CE20F1BDE7090EF7970686EC6738A");
+        ASSERT_EQUAL(SToHex(SHashSHA256(string(64, 'a'))), "FFE054FE7AE0CB6DC65C3AF9B61D5209F439851DB43D0BA5997337DF154668EB");
+        ASSERT_EQUAL(SToHex(SHashSHA256(string(1000, 'a'))), "41EDECE42D63E8D9BF515A9BA6932E1C20CBC9F5A5D134645ADB5DB1B9737EA3");
+    }
+
+    void testBase64() {
+        ASSERT_EQUAL(SEncodeBase64(""), "");
+        ASSERT_EQUAL(SEncodeBase64("f"), "Zg==");
+        ASSERT_EQUAL(SEncodeBase64("fo"), "Zm8=");
+        ASSERT_EQUAL(SEncodeBase64("foo"), "Zm9v");
+        ASSERT_EQUAL(SEncodeBase64("foobar"), "Zm9vYmFy");
+        ASSERT_EQUAL(SDecodeBase64("Zg=="), "f");
+        ASSERT_EQUAL(SDecodeBase64("Zm8="), "fo");
+        ASSERT_EQUAL(SDecodeBase64("Zm9vYmFy"), "foobar");
+
+        // Long enough to go through the vectorized encoder, with every byte value and every tail length.
+        string bytes;
+        for (int i = 0; i < 256; i++) {
+            bytes += (char)i;
+        }
+        string encoded = SEncodeBase64(bytes);
+        ASSERT_EQUAL(encoded.substr(0, 60), "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKiss");
+        ASSERT_EQUAL(SToHex(SHashSHA1(encoded)), "D512A02578EC6B21491E55E9081BB0FC16CE4193");
+        for (size_t size = 0; size <= bytes.size(); size++) {
+            ASSERT_EQUAL(SDecodeBase64(SEncodeBase64(bytes.substr(0, size))), bytes.substr(0, size));
+        }
+
+        // Non-canonical input still decodes the way it always has.
+        ASSERT_EQUAL(SDecodeBase64("Zm9v\r\nYmFy"), "foobar");
+    }
+
     void testJSONDecode() {
         const string& sampleJson = SFileLoad("sample_data/lottoNumbers.json");
         ASSERT_FALSE(sampleJson.empty());
@@ -128,6 +179,30 @@ struct LibStuff : tpunit::TestFixture {
                         "348706C9EDFE8A0CDD13BFB476367DEA2761A102B26443C7D3A464DB49A37F1F816B8BEC4C55DBD9DAF0B70652D32A"
                         "CBD224F9487E25398E740E99B24089A6343B6FD6C1BC6A89AF90F3DC69016A42066AAF430B1B584D236B8AD285828D"
                         "59BB8375E2E955E246390DE9AA69D05DEF1FBC25318C9CCFE90159EC7EAA71637C07BD"));
+
+        // Only canonical integers are written as numbers.
+        ASSERT_EQUAL(SToJSON("42"), "42");
+        ASSERT_EQUAL(SToJSON("-42"), "-42");
+        ASSERT_EQUAL(SToJSON("042"), "\"042\"");
+        ASSERT_EQUAL(SToJSON("-0"), "\"-0\"");
+        ASSERT_EQUAL(SToJSON("9223372036854775807"), "9223372036854775807");
+        ASSERT_EQUAL(SToJSON("9223372036854775808"), "\"9223372036854775808\"");
+        ASSERT_EQUAL(SToJSON("-9223372036854775808"), "-9223372036854775808");
+        ASSERT_EQUAL(SToJSON("1.500000"), "1.500000");
+        ASSERT_EQUAL(SToJSON("1.5"), "\"1.5\"");
+
+        // Escaping.
+        ASSERT_EQUAL(SToJSON("a/b\"c\\d\te\x01\x7f"), "\"a\\/b\\\"c\\\\d\\te\\u0001\\\x7f\"");
+        ASSERT_EQUAL(SToJSON(string("ab\0cd", 5)), "\"ab\"");
+
+        // Long strings, with and without escapes, to cover the vectorized scan.
+        string longString(100, 'x');
+        ASSERT_EQUAL(SParseJSONObject("{\"long\":\"" + longString + "\"}")["long"], longString);
+        longString[70] = '"';
+        STable longTable;
+        longTable["long"] = longString;
+        ASSERT_EQUAL(SParseJSONObject(SComposeJSONObject(longTable))["long"], longString);
+        ASSERT_EQUAL(SParseJSONArray(SComposeJSONArray(list<string>{longString, "", "x"})).front(), longString);
     }
 
     void testEscapeUnescape() {
@@ -304,6 +379,32 @@ struct LibStuff : tpunit::TestFixture {
         ASSERT_EQUAL(SDaysInMonth(2014, 7), 31);
     }
 
+    void testClocks() {
+        // The wall clock should agree with `time`, and the coarse clocks should be within a tick or so of the fine ones.
+        uint64_t now = STimeNow();
+        ASSERT_LESS_THAN(llabs((int64_t)(now / STIME_US_PER_S) - (int64_t)time(nullptr)), 2);
+        ASSERT_LESS_THAN(llabs((int64_t)STimeNowCoarse() - (int64_t)STimeNow()), (int64_t)(100 * STIME_US_PER_MS));
+        ASSERT_LESS_THAN(llabs((int64_t)SMonotonicNowCoarse() - (int64_t)SMonotonicNow()), (int64_t)(100 * STIME_US_PER_MS));
+
+        // Monotonic time never goes backwards, and measures sleeps.
+        uint64_t start = SMonotonicNow();
+        usleep(10'000);
+        uint64_t end = SMonotonicNow();
+        ASSERT_GREATER_THAN_EQUAL(end - start, 10'000);
+
+        // The cached time only moves when it's refreshed.
+        uint64_t refreshed = STimeRefresh();
+        usleep(10'000);
+        ASSERT_EQUAL(STimeCached(), refreshed);
+        ASSERT_GREATER_THAN(STimeRefresh(), refreshed);
+
+        // A stopwatch with an alarm starts out ringing, and one that's just been started doesn't.
+        SStopwatch alarm(STIME_US_PER_M);
+        ASSERT_TRUE(alarm.ringing());
+        ASSERT_TRUE(alarm.ding());
+        ASSERT_FALSE(alarm.ringing());
+    }
+
     void testGZip() {
 
         // All these really test is that we won't segfault or anything.
@@ -325,6 +426,22 @@ struct LibStuff : tpunit::TestFixture {
 
         // Test end to end.
         ASSERT_EQUAL(SGUnzip(SGZip(data)), data);
+
+        // Peer messages only get compressed when asked and when they're big enough to be worth it.
+        SData commit("COMMIT");
+        commit["CommitIndex"] = "1";
+        commit.content = "this is a test";
+        ASSERT_EQUAL(STCPNode::serializeForPeer(commit, true), commit.serialize());
+        for (int i = 0; i < 1000; i++) {
+            commit.content += "INSERT INTO test VALUES(" + to_string(i) + ", 'value');";
+        }
+        ASSERT_EQUAL(STCPNode::serializeForPeer(commit, false), commit.serialize());
+        SData compressed;
+        const string serialized = STCPNode::serializeForPeer(commit, true);
+        ASSERT_TRUE(serialized.size() < commit.content.size());
+        ASSERT_EQUAL(compressed.deserialize(serialized), (int)serialized.size());
+        ASSERT_EQUAL(compressed["Content-Encoding"], "gzip");
+        ASSERT_EQUAL(SGUnzip(compressed.content), commit.content);
     }
 
     void testConstantTimeEquals() {
@@ -404,6 +521,153 @@ struct LibStuff : tpunit::TestFixture {
         ASSERT_EQUAL(test["k"], "false");
     }
 
+    void testHeaderTable() {
+        // Names are case-insensitive, and the pre-hashed keys find the same entries as plain strings.
+        SHeaderTable headers;
+        headers["Connection"] = "forget";
+        headers["timeout"] = "5000";
+        headers["Zebra"] = "z";
+        headers["apple"] = "a";
+        ASSERT_EQUAL(headers.size(), 4);
+        ASSERT_EQUAL(headers["CONNECTION"], "forget");
+        ASSERT_TRUE(headers.find(SHeaderTable::CONNECTION) == headers.find("connection"));
+        ASSERT_EQUAL(headers.find(SHeaderTable::TIMEOUT)->second, "5000");
+        ASSERT_TRUE(headers.find(SHeaderTable::PRIORITY) == headers.end());
+        ASSERT_EQUAL(headers.size(), 4);
+        ASSERT_FALSE(headers.emplace("APPLE", "b").second);
+        ASSERT_EQUAL(headers.at("apple"), "a");
+
+        // Serializing gives exactly what an STable with the same contents would.
+        STable table = headers;
+        ASSERT_EQUAL(table.size(), 4);
+        ASSERT_EQUAL(SComposeHTTP("GET / HTTP/1.1", headers, "body"), SComposeHTTP("GET / HTTP/1.1", table, "body"));
+
+        // And parsing gives back the same headers.
+        SHeaderTable parsed;
+        string methodLine, content;
+        string message = SComposeHTTP("GET / HTTP/1.1", headers, "body");
+        ASSERT_EQUAL(SParseHTTP(message, methodLine, parsed, content), (int)message.size());
+        ASSERT_EQUAL(content, "body");
+        parsed.erase("Content-Length");
+        ASSERT_TRUE(parsed == headers);
+
+        // Erasing keeps everything else findable.
+        ASSERT_EQUAL(headers.erase("connection"), 1);
+        ASSERT_EQUAL(headers.erase("connection"), 0);
+        ASSERT_EQUAL(headers.size(), 3);
+        ASSERT_EQUAL(headers["Zebra"], "z");
+        ASSERT_EQUAL(headers["timeout"], "5000");
+        ASSERT_TRUE(parsed != headers);
+
+        // And keeps the rest in order, so erasing while iterating works like it does on an STable.
+        headers[SHeaderTable::ID] = "1";
+        for (auto it = headers.begin(); it != headers.end();) {
+            if (it->second == "z" || it->second == "1") {
+                it = headers.erase(it);
+            } else {
+                it++;
+            }
+        }
+        list<string> names;
+        for (const auto& header : headers) {
+            names.push_back(header.first);
+        }
+        ASSERT_EQUAL(SComposeList(names), "timeout, apple");
+
+        // Entries added with a key get its spelling.
+        SData request("GET / HTTP/1.1");
+        request[SHeaderTable::COMMIT_COUNT] = "5";
+        ASSERT_EQUAL(request.nameValueMap.begin()->first, "CommitCount");
+        ASSERT_EQUAL(request.calcU64(SHeaderTable::COMMIT_COUNT), 5);
+        ASSERT_TRUE(request.isSet("commitcount"));
+    }
+
+    void testSynchronizedQueue() {
+        SSynchronizedQueue<int> queue;
+        auto isReadable = [&]() {
+            fd_map fdm;
+            queue.prePoll(fdm);
+            S_poll(fdm, 0);
+            return SFDAnySet(fdm, fdm.begin()->first, SREADEVTS);
+        };
+        ASSERT_TRUE(queue.empty());
+        ASSERT_FALSE(isReadable());
+
+        // Several threads pushing at once. Everything should arrive, and each thread's items should stay in order.
+        const int threads = 4;
+        const int perThread = 10000;
+        list<thread> producers;
+        for (int t = 0; t < threads; t++) {
+            producers.emplace_back([&queue, t]() {
+                for (int i = 0; i < perThread; i++) {
+                    queue.push(t * perThread + i);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        ASSERT_TRUE(isReadable());
+        ASSERT_EQUAL(queue.size(), threads * perThread);
+        vector<int> last(threads, -1);
+        while (!queue.empty()) {
+            int item = queue.pop();
+            ASSERT_GREATER_THAN(item % perThread, last[item / perThread]);
+            last[item / perThread] = item % perThread;
+        }
+        for (int t = 0; t < threads; t++) {
+            ASSERT_EQUAL(last[t], perThread - 1);
+        }
+
+        // Once postPoll has cleared the wakeup, it stays clear until something else is pushed.
+        fd_map fdm;
+        queue.prePoll(fdm);
+        S_poll(fdm, 0);
+        queue.postPoll(fdm);
+        ASSERT_FALSE(isReadable());
+        queue.push(1);
+        queue.push(2);
+        ASSERT_TRUE(isReadable());
+        ASSERT_EQUAL(queue.front(), 1);
+        ASSERT_EQUAL(queue.pop(), 1);
+        ASSERT_EQUAL(queue.pop(), 2);
+        ASSERT_THROW(queue.pop(), out_of_range);
+    }
+
+    void testTimerWheel() {
+        // Use a fixed start time with 1ms ticks, so the test doesn't depend on the clock.
+        uint64_t start = 1'000'000'000'000;
+        STimerWheel<int> wheel(STIME_US_PER_MS, start);
+        list<int> expired;
+        auto collect = [&expired](int& value) { expired.push_back(value); };
+
+        // Things come back in the order they expire, never early, whichever level of the wheel they were in.
+        wheel.add(start + 5 * STIME_US_PER_M, 4);
+        wheel.add(start + 100 * STIME_US_PER_MS, 2);
+        wheel.add(start + 1500, 1);
+        wheel.add(start + 2 * STIME_US_PER_S, 3);
+        wheel.add(start + 400 * STIME_US_PER_H, 5);
+        STimerHandle cancelled = wheel.add(start + 3 * STIME_US_PER_S, 6);
+        ASSERT_EQUAL(wheel.size(), 6);
+        ASSERT_EQUAL(wheel.expire(start + 1999, collect), 0);
+        ASSERT_EQUAL(wheel.expire(start + 2000, collect), 1);
+        ASSERT_TRUE(wheel.cancel(cancelled));
+        ASSERT_FALSE(wheel.cancel(cancelled));
+        ASSERT_EQUAL(wheel.expire(start + 10 * STIME_US_PER_M, collect), 3);
+        ASSERT_EQUAL(expired, list<int>({1, 2, 3, 4}));
+
+        // Anything added that's already expired comes back next time, earliest first.
+        wheel.add(start, 8);
+        wheel.add(start - STIME_US_PER_S, 7);
+        ASSERT_EQUAL(wheel.expire(start + 10 * STIME_US_PER_M, collect), 2);
+        ASSERT_EQUAL(expired, list<int>({1, 2, 3, 4, 7, 8}));
+
+        // Expired entries can't be cancelled, and once everything's expired, the wheel's empty.
+        ASSERT_EQUAL(wheel.expire(start + 401 * STIME_US_PER_H, collect), 1);
+        ASSERT_EQUAL(expired.back(), 5);
+        ASSERT_TRUE(wheel.empty());
+    }
+
     void testFileIO() {
         const string path = "./fileio.test";
         const string contents = "test";
@@ -576,6 +840,19 @@ struct LibStuff : tpunit::TestFixture {
         string start = "I wish I was an Oscar Meyer Weiner";
         ASSERT_EQUAL(SStrFromHex(SToHex(start)), start);
 
+        // Every byte value, through both the vectorized and byte-at-a-time paths.
+        string bytes;
+        for (int i = 0; i < 256; i++) {
+            bytes += (char)i;
+        }
+        ASSERT_EQUAL(SToHex(bytes).substr(0, 40), "000102030405060708090A0B0C0D0E0F10111213");
+        ASSERT_EQUAL(SToHex(bytes).substr(480), "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF");
+        ASSERT_EQUAL(SStrFromHex(SToHex(bytes)), bytes);
+
+        // Odd lengths and bad digits are parsed like strtol always parsed them.
+        ASSERT_EQUAL(SStrFromHex("414"), "A\x04");
+        ASSERT_EQUAL(SStrFromHex("4G41"), string("\x04") + "A");
+
     }
 
     void testBase32Conversion() {
@@ -594,4 +871,82 @@ struct LibStuff : tpunit::TestFixture {
         ASSERT_TRUE(SContains(string("asdf"), "a"));
         ASSERT_TRUE(SContains(string("asdf"), string("asd")));
     }
+
+    void testPeerVerbs() {
+        // Every verb should round trip through its name.
+        for (size_t i = 0; i < (size_t)STCPNode::Verb::NUM_VERBS; i++) {
+            STCPNode::Verb verb = (STCPNode::Verb)i;
+            ASSERT_EQUAL((size_t)STCPNode::verbFromName(STCPNode::verbName(verb)), i);
+        }
+
+        // Lookups are case-insensitive, like the comparisons they replace.
+        ASSERT_TRUE(STCPNode::verbFromName("synchronize_response") == STCPNode::Verb::SYNCHRONIZE_RESPONSE);
+        ASSERT_TRUE(STCPNode::verbFromName("Ping") == STCPNode::Verb::PING);
+        ASSERT_TRUE(STCPNode::verbFromName("NOT_A_VERB") == STCPNode::Verb::UNKNOWN);
+        ASSERT_TRUE(STCPNode::verbFromName("") == STCPNode::Verb::UNKNOWN);
+    }
+
+    void testAsyncLogging() {
+        const string path = "./asynclog.test";
+        SFileDelete(path);
+        SLogStartAsync(path);
+
+        // Log from a few threads at once.
+        list<thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([i]() {
+                for (int j = 0; j < 100; j++) {
+                    SWARN("asynclogtest " << i << ":" << j << ".");
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        // Once stopped, everything should have been written, in order for each thread.
+        SLogStopAsync();
+        string contents = SFileLoad(path);
+        for (int i = 0; i < 4; i++) {
+            size_t last = 0;
+            for (int j = 0; j < 100; j++) {
+                size_t pos = contents.find("asynclogtest " + to_string(i) + ":" + to_string(j) + ".");
+                ASSERT_TRUE(pos != string::npos);
+                ASSERT_TRUE(pos >= last);
+                last = pos;
+            }
+        }
+        ASSERT_EQUAL(SLogDroppedCount(), 0);
+
+        // Without the logging thread, lines go straight to the file.
+        ASSERT_TRUE(SLogOpenFile(path));
+        SWARN("synclogtest.");
+        ASSERT_TRUE(SFileLoad(path).find("synclogtest.") != string::npos);
+        SLogCloseFile();
+        SFileDelete(path);
+    }
+
+    void testLogLevel() {
+        int oldMask = _g_SLogMask.load();
+        SLogLevel(LOG_WARNING);
+        ASSERT_TRUE(SLogEnabled(LOG_WARNING));
+        ASSERT_TRUE(SLogEnabled(LOG_ERR));
+        ASSERT_FALSE(SLogEnabled(LOG_INFO));
+        ASSERT_FALSE(SLogEnabled(LOG_DEBUG));
+
+        // A filtered log line shouldn't do any of the work of building its message.
+        int evaluated = 0;
+        auto message = [&evaluated]() {
+            evaluated++;
+            return "message";
+        };
+        SINFO(message());
+        SDEBUG(message());
+        ASSERT_EQUAL(evaluated, 0);
+        SWARN(message());
+        ASSERT_EQUAL(evaluated, 1);
+
+        _g_SLogMask = oldMask;
+        setlogmask(oldMask);
+    }
 } __LibStuff;
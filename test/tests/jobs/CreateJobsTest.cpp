@@ -9,6 +9,9 @@ struct CreateJobsTest : tpunit::TestFixture {
                               TEST(CreateJobsTest::createWithInvalidJson),
                               TEST(CreateJobsTest::createWithParentIDNotRunning),
                               TEST(CreateJobsTest::createWithParentMocked),
+                              TEST(CreateJobsTest::createManyReservesIDBlocks),
+                              TEST(CreateJobsTest::createUniqueInSameRequest),
+                              TEST(CreateJobsTest::updateUniqueInSameRequest),
                               AFTER(CreateJobsTest::tearDown),
                               AFTER_CLASS(CreateJobsTest::tearDownClass)) { }
 
@@ -193,4 +196,72 @@ struct CreateJobsTest : tpunit::TestFixture {
 
         ASSERT_EQUAL(result.rows.size(), 0);
     }
+
+    // Job IDs come from blocks reserved in jobIDSequence, skipping any that were already in use.
+    void createManyReservesIDBlocks() {
+        // Put a job where the next block will start, like one created with a random ID before we used the sequence.
+        int64_t nextBlock = SToInt64(tester->readDB("SELECT nextJobID FROM jobIDSequence;"));
+        SData query("Query");
+        query["query"] = "INSERT INTO jobs (jobID, created, state, name, nextRun, repeat, data) "
+                         "VALUES (" + SQ(nextBlock) + ", DATETIME('now'), 'QUEUED', 'legacy', DATETIME('now'), '', '{}');";
+        tester->executeWaitVerifyContent(query);
+
+        // Create enough jobs at once to need more than one block.
+        vector<string> jobs;
+        for (int i = 0; i < 2500; i++) {
+            STable job;
+            job["name"] = "many";
+            jobs.push_back(SComposeJSONObject(job));
+        }
+        SData command("CreateJobs");
+        command["jobs"] = SComposeJSONArray(jobs);
+        list<string> jobIDList = SParseJSONArray(tester->executeWaitVerifyContentTable(command)["jobIDs"]);
+        ASSERT_EQUAL(jobIDList.size(), 2500);
+        set<string> jobIDs(jobIDList.begin(), jobIDList.end());
+        ASSERT_EQUAL(jobIDs.size(), 2500);
+        ASSERT_FALSE(jobIDs.count(to_string(nextBlock)));
+        ASSERT_GREATER_THAN(SToInt64(tester->readDB("SELECT nextJobID FROM jobIDSequence;")), nextBlock + 1000);
+    }
+
+    // A unique job finds one with the same name created earlier in the same request.
+    void createUniqueInSameRequest() {
+        STable unique;
+        unique["name"] = "uniqueJob";
+        unique["unique"] = "true";
+        STable plain;
+        plain["name"] = "plainJob";
+        SData command("CreateJobs");
+        command["jobs"] = SComposeJSONArray(vector<string>{SComposeJSONObject(unique), SComposeJSONObject(plain),
+                                                           SComposeJSONObject(unique)});
+        vector<string> jobIDs;
+        for (auto& jobID : SParseJSONArray(tester->executeWaitVerifyContentTable(command)["jobIDs"])) {
+            jobIDs.push_back(jobID);
+        }
+        ASSERT_EQUAL(jobIDs.size(), 3);
+        ASSERT_NOT_EQUAL(jobIDs[0], jobIDs[1]);
+        ASSERT_EQUAL(jobIDs[0], jobIDs[2]);
+        ASSERT_EQUAL(tester->readDB("SELECT COUNT(*) FROM jobs WHERE name = 'uniqueJob';"), "1");
+    }
+
+    void updateUniqueInSameRequest() {
+        // The second job updates the first, which is created by the same request.
+        STable first;
+        first["name"] = "uniqueJob";
+        first["unique"] = "true";
+        first["data"] = "{\"first\":1}";
+        STable second = first;
+        second["data"] = "{\"second\":2}";
+        second["jobPriority"] = "1000";
+        SData command("CreateJobs");
+        command["jobs"] = SComposeJSONArray(vector<string>{SComposeJSONObject(first), SComposeJSONObject(second)});
+        list<string> jobIDs = SParseJSONArray(tester->executeWaitVerifyContentTable(command)["jobIDs"]);
+        ASSERT_EQUAL(jobIDs.size(), 2);
+        ASSERT_EQUAL(jobIDs.front(), jobIDs.back());
+
+        SQResult result;
+        tester->readDB("SELECT data, priority FROM jobs WHERE name = 'uniqueJob';", result);
+        ASSERT_EQUAL(result.size(), 1);
+        ASSERT_EQUAL(result[0][0], "{\"first\":1,\"second\":2}");
+        ASSERT_EQUAL(result[0][1], "1000");
+    }
 } __CreateJobsTest;
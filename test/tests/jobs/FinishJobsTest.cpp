@@ -0,0 +1,127 @@
+#include <test/lib/BedrockTester.h>
+
+struct FinishJobsTest : tpunit::TestFixture {
+    FinishJobsTest()
+        : tpunit::TestFixture("FinishJobs",
+                              BEFORE_CLASS(FinishJobsTest::setupClass),
+                              TEST(FinishJobsTest::finishJobs),
+                              TEST(FinishJobsTest::retryJobs),
+                              TEST(FinishJobsTest::partialFailure),
+                              TEST(FinishJobsTest::missingJobID),
+                              AFTER(FinishJobsTest::tearDown),
+                              AFTER_CLASS(FinishJobsTest::tearDownClass)) { }
+
+    BedrockTester* tester;
+
+    void setupClass() { tester = new BedrockTester(_threadID, {{"-plugins", "Jobs,DB"}}, {});}
+
+    // Reset the jobs table
+    void tearDown() {
+        SData command("Query");
+        command["query"] = "DELETE FROM jobs WHERE jobID > 0;";
+        tester->executeWaitVerifyContent(command);
+    }
+
+    void tearDownClass() { delete tester; }
+
+    // Creates a job and gets it, so that it's RUNNING.
+    string createRunningJob(const string& name, const string& repeat = "") {
+        SData command("CreateJob");
+        command["name"] = name;
+        if (!repeat.empty()) {
+            command["repeat"] = repeat;
+        }
+        STable response = tester->executeWaitVerifyContentTable(command);
+        string jobID = response["jobID"];
+
+        command.clear();
+        command.methodLine = "GetJob";
+        command["name"] = name;
+        tester->executeWaitVerifyContent(command);
+        return jobID;
+    }
+
+    // Returns the "jobID=result" for each job in the response, in order.
+    list<string> getResults(const STable& response) {
+        list<string> results;
+        for (const string& result : SParseJSONArray(response.at("results"))) {
+            STable values = SParseJSONObject(result);
+            results.push_back(values["jobID"] + "=" + values["result"]);
+        }
+        return results;
+    }
+
+    string getState(const string& jobID) {
+        SQResult result;
+        tester->readDB("SELECT state FROM jobs WHERE jobID = " + jobID + ";", result);
+        return result.empty() ? "" : result[0][0];
+    }
+
+    void finishJobs() {
+        string first = createRunningJob("first");
+        string second = createRunningJob("second", "SCHEDULED, +1 HOUR");
+
+        SData command("FinishJobs");
+        command["jobs"] = "[{\"jobID\":" + first + "},{\"jobID\":" + second + ",\"data\":{\"count\":1}}]";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(SComposeList(getResults(response)), first + "=200 OK, " + second + "=200 OK");
+
+        // The first job is done, and the second is queued to repeat, with its new data.
+        ASSERT_EQUAL(getState(first), "");
+        ASSERT_EQUAL(getState(second), "QUEUED");
+        SQResult result;
+        tester->readDB("SELECT data FROM jobs WHERE jobID = " + second + ";", result);
+        ASSERT_EQUAL(result[0][0], "{\"count\":1}");
+    }
+
+    void retryJobs() {
+        string first = createRunningJob("first");
+        string second = createRunningJob("second");
+
+        SData command("RetryJobs");
+        command["jobs"] = "[{\"jobID\":" + first + ",\"delay\":5},{\"jobID\":" + second + ",\"name\":\"renamed\",\"jobPriority\":1000}]";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(SComposeList(getResults(response)), first + "=200 OK, " + second + "=200 OK");
+        ASSERT_EQUAL(getState(first), "QUEUED");
+        SQResult result;
+        tester->readDB("SELECT state, name, priority FROM jobs WHERE jobID = " + second + ";", result);
+        ASSERT_EQUAL(result[0][0], "QUEUED");
+        ASSERT_EQUAL(result[0][1], "renamed");
+        ASSERT_EQUAL(result[0][2], "1000");
+    }
+
+    void partialFailure() {
+        string running = createRunningJob("running");
+        SData command("CreateJob");
+        command["name"] = "queued";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        string queued = response["jobID"];
+
+        // A job that can't be finished gets the error FinishJob would have returned, and doesn't stop the others.
+        command.clear();
+        command.methodLine = "FinishJobs";
+        command["jobs"] = "[{\"jobID\":" + queued + "},{\"jobID\":999999},{\"jobID\":" + running + "}]";
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(SComposeList(getResults(response)),
+                     queued + "=405 Can only retry/finish RUNNING and RUNQUEUED jobs, "
+                     "999999=404 No job with this jobID, " +
+                     running + "=200 OK");
+        ASSERT_EQUAL(getState(queued), "QUEUED");
+        ASSERT_EQUAL(getState(running), "");
+
+        // Finishing the same job twice in a batch sees the first one's changes.
+        string again = createRunningJob("again");
+        command["jobs"] = "[{\"jobID\":" + again + "},{\"jobID\":" + again + "}]";
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(SComposeList(getResults(response)), again + "=200 OK, " + again + "=404 No job with this jobID");
+    }
+
+    void missingJobID() {
+        SData command("FinishJobs");
+        command["jobs"] = "[{\"data\":{}}]";
+        tester->executeWaitVerifyContent(command, "402 Missing jobID");
+        command["jobs"] = "not json";
+        tester->executeWaitVerifyContent(command, "401 Invalid JSON");
+    }
+
+} __FinishJobsTest;
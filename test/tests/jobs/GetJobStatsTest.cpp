@@ -0,0 +1,128 @@
+#include <test/lib/BedrockTester.h>
+
+struct GetJobStatsTest : tpunit::TestFixture {
+    GetJobStatsTest()
+        : tpunit::TestFixture("GetJobStats",
+                              BEFORE_CLASS(GetJobStatsTest::setupClass),
+                              TEST(GetJobStatsTest::countJobs),
+                              TEST(GetJobStatsTest::filterByName),
+                              TEST(GetJobStatsTest::oldestReady),
+                              TEST(GetJobStatsTest::rolledBack),
+                              AFTER(GetJobStatsTest::tearDown),
+                              AFTER_CLASS(GetJobStatsTest::tearDownClass)) { }
+
+    BedrockTester* tester;
+
+    void setupClass() { tester = new BedrockTester(_threadID, {{"-plugins", "Jobs,DB"}}, {});}
+
+    // Reset the jobs table
+    void tearDown() {
+        SData command("Query");
+        command["query"] = "DELETE FROM jobs WHERE jobID > 0;";
+        tester->executeWaitVerifyContent(command);
+    }
+
+    void tearDownClass() { delete tester; }
+
+    string createJob(const string& name, int64_t priority, const string& firstRun = "") {
+        SData command("CreateJob");
+        command["name"] = name;
+        command["jobPriority"] = to_string(priority);
+        if (!firstRun.empty()) {
+            command["firstRun"] = firstRun;
+        }
+        STable response = tester->executeWaitVerifyContentTable(command);
+        return response["jobID"];
+    }
+
+    // Returns the stats as "name/state/priority=count" strings, in order.
+    list<string> getStats(const string& name = "") {
+        SData command("GetJobStats");
+        if (!name.empty()) {
+            command["name"] = name;
+        }
+        STable response = tester->executeWaitVerifyContentTable(command);
+        list<string> stats;
+        for (const string& stat : SParseJSONArray(response["stats"])) {
+            STable values = SParseJSONObject(stat);
+            stats.push_back(values["name"] + "/" + values["state"] + "/" + values["priority"] + "=" + values["count"]);
+        }
+        return stats;
+    }
+
+    void countJobs() {
+        ASSERT_TRUE(getStats().empty());
+        createJob("a", 500);
+        createJob("a", 500);
+        createJob("a", 1000);
+        createJob("b", 0);
+        ASSERT_EQUAL(SComposeList(getStats()), "a/QUEUED/500=2, a/QUEUED/1000=1, b/QUEUED/0=1");
+
+        // Counts follow jobs as they change state.
+        SData command("GetJob");
+        command["name"] = "a";
+        tester->executeWaitVerifyContent(command);
+        ASSERT_EQUAL(SComposeList(getStats()), "a/QUEUED/500=2, a/RUNNING/1000=1, b/QUEUED/0=1");
+
+        // And as they're deleted, by any means.
+        command.clear();
+        command.methodLine = "Query";
+        command["query"] = "DELETE FROM jobs WHERE name = 'b';";
+        tester->executeWaitVerifyContent(command);
+        ASSERT_EQUAL(SComposeList(getStats()), "a/QUEUED/500=2, a/RUNNING/1000=1");
+
+        // They match what's actually in the table.
+        SQResult result;
+        tester->readDB("SELECT name, state, priority, COUNT(*) FROM jobs GROUP BY name, state, priority ORDER BY name, state, priority;", result);
+        list<string> expected;
+        for (auto& row : result.rows) {
+            expected.push_back(row[0] + "/" + row[1] + "/" + row[2] + "=" + row[3]);
+        }
+        ASSERT_EQUAL(SComposeList(getStats()), SComposeList(expected));
+    }
+
+    void filterByName() {
+        createJob("report/daily", 500);
+        createJob("report/weekly", 500);
+        createJob("email", 500);
+        ASSERT_EQUAL(SComposeList(getStats("report/*")), "report/daily/QUEUED/500=1, report/weekly/QUEUED/500=1");
+        ASSERT_EQUAL(SComposeList(getStats("email")), "email/QUEUED/500=1");
+        ASSERT_TRUE(getStats("nothing").empty());
+    }
+
+    void oldestReady() {
+        const uint64_t now = STimeNow();
+        createJob("late", 500, SComposeTime("%Y-%m-%d %H:%M:%S", now - 2 * 60 * 60 * STIME_US_PER_S));
+        createJob("late", 1000, SComposeTime("%Y-%m-%d %H:%M:%S", now - 60 * 60 * STIME_US_PER_S));
+        createJob("future", 500, SComposeTime("%Y-%m-%d %H:%M:%S", now + 60 * 60 * STIME_US_PER_S));
+
+        // Only jobs that are ready to run count, and the oldest of any priority is the one that's reported.
+        SData command("GetJobStats");
+        STable response = tester->executeWaitVerifyContentTable(command);
+        STable oldestReady = SParseJSONObject(response["oldestReady"]);
+        ASSERT_EQUAL(oldestReady.size(), 1);
+        ASSERT_GREATER_THAN_EQUAL(SToInt64(oldestReady["late"]), 2 * 60 * 60);
+        ASSERT_LESS_THAN(SToInt64(oldestReady["late"]), 2 * 60 * 60 + 60);
+    }
+
+    void rolledBack() {
+        SData command("CreateJob");
+        command["name"] = "unique";
+        command["data"] = "{\"version\":1}";
+        command["unique"] = "true";
+        tester->executeWaitVerifyContent(command);
+        ASSERT_EQUAL(SComposeList(getStats()), "unique/QUEUED/500=1");
+
+        // The first job gets inserted, and the second moves the existing unique job to another priority, before the
+        // third fails. None of it is counted, as it's all rolled back.
+        command.clear();
+        command.methodLine = "CreateJobs";
+        command["jobs"] = "[{\"name\":\"new\"},"
+                          "{\"name\":\"unique\",\"unique\":true,\"data\":{\"version\":2},\"jobPriority\":1000},"
+                          "{\"name\":\"bad\",\"repeat\":\"NOT A REPEAT\"}]";
+        tester->executeWaitVerifyContent(command, "402 Malformed repeat");
+        ASSERT_EQUAL(SComposeList(getStats()), "unique/QUEUED/500=1");
+        ASSERT_EQUAL(tester->readDB("SELECT COUNT(*) FROM jobs;"), "1");
+    }
+
+} __GetJobStatsTest;
@@ -35,7 +35,11 @@ struct GetJobTest : tpunit::TestFixture {
                               TEST(GetJobTest::testMultipleNames),
                               TEST(GetJobTest::testPriorityParameter),
                               TEST(GetJobTest::testInvalidJobPriority),
+                              TEST(GetJobTest::testRoundRobin),
+                              TEST(GetJobTest::testRoundRobinOneAtATime),
                               TEST(GetJobTest::testRetryableParentJobs),
+                              TEST(GetJobTest::testQueryChangesReadyJobs),
+                              TEST(GetJobTest::testConnectionWait),
                               AFTER(GetJobTest::tearDown),
                               AFTER_CLASS(GetJobTest::tearDownClass)) { }
 
@@ -701,6 +705,77 @@ struct GetJobTest : tpunit::TestFixture {
         tester->executeWaitVerifyContent(command, "402 Invalid priority value");
     }
 
+    void testRoundRobin() {
+        // A backlog of one name, followed by a couple of other names, and something of a higher priority.
+        auto createJob = [this](const string& name, int64_t priority, int64_t secondsAgo) {
+            SData command("CreateJob");
+            command["name"] = name;
+            command["jobPriority"] = to_string(priority);
+            command["firstRun"] = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - secondsAgo * STIME_US_PER_S);
+            tester->executeWaitVerifyContent(command);
+        };
+        for (int i = 0; i < 10; i++) {
+            createJob("flood", 500, 100 - i);
+        }
+        createJob("other", 500, 50);
+        createJob("another", 500, 60);
+        createJob("other", 500, 40);
+        createJob("urgent", 1000, 0);
+
+        // Higher priorities still come first, but then each name gets a turn, in order, before any gets another.
+        SData command("GetJobs");
+        command["name"] = "*";
+        command["numResults"] = "6";
+        command["order"] = "roundRobin";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        list<string> names;
+        for (const string& job : SParseJSONArray(response["jobs"])) {
+            names.push_back(SParseJSONObject(job)["name"]);
+        }
+        ASSERT_EQUAL(SComposeList(names), "urgent, another, flood, other, flood, other");
+
+        // Without it, the backlog gets everything.
+        command.erase("order");
+        command["numResults"] = "3";
+        response = tester->executeWaitVerifyContentTable(command);
+        names.clear();
+        for (const string& job : SParseJSONArray(response["jobs"])) {
+            names.push_back(SParseJSONObject(job)["name"]);
+        }
+        ASSERT_EQUAL(SComposeList(names), "flood, flood, flood");
+
+        command["order"] = "random";
+        tester->executeWaitVerifyContent(command, "402 Invalid order");
+    }
+
+    void testRoundRobinOneAtATime() {
+        // A flood of old jobs, and one newer job under another name.
+        for (int i = 0; i < 10; i++) {
+            SData command("CreateJob");
+            command["name"] = "flood";
+            command["firstRun"] = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - (100 - i) * STIME_US_PER_S);
+            tester->executeWaitVerifyContent(command);
+        }
+        SData command("CreateJob");
+        command["name"] = "quiet";
+        tester->executeWaitVerifyContent(command);
+
+        // Taking one job at a time, the quiet name still gets its turn before the flood gets a second one.
+        command.clear();
+        command.methodLine = "GetJobs";
+        command["name"] = "*";
+        command["numResults"] = "1";
+        command["order"] = "roundRobin";
+        set<string> names;
+        for (int i = 0; i < 2; i++) {
+            STable response = tester->executeWaitVerifyContentTable(command);
+            list<string> jobs = SParseJSONArray(response["jobs"]);
+            ASSERT_EQUAL(jobs.size(), 1);
+            names.insert(SParseJSONObject(jobs.front())["name"]);
+        }
+        ASSERT_EQUAL(SComposeList(names), "flood, quiet");
+    }
+
     void testRetryableParentJobs() {
         // Create the parent job
         SData createJobCommand("CreateJob");
@@ -799,5 +874,64 @@ struct GetJobTest : tpunit::TestFixture {
         ASSERT_EQUAL(stoi(parentCount), 0);
     }
 
+    // Jobs changed directly in the DB, rather than by Jobs commands, should be picked up by GetJob just the same.
+    void testQueryChangesReadyJobs() {
+        SData command("CreateJob");
+        command["name"] = "queried";
+        string jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+
+        // Push it into the future, and it's not ready anymore.
+        SData query("Query");
+        query["query"] = "UPDATE jobs SET nextRun = DATETIME('now', '+1 HOUR') WHERE jobID = " + jobID + ";";
+        tester->executeWaitVerifyContent(query);
+        SData getJobCommand("GetJob");
+        getJobCommand["name"] = "queried";
+        tester->executeWaitVerifyContent(getJobCommand, "404 No job found");
+
+        // Mock it and bring it back, and only a mocked GetJob can get it.
+        query["query"] = "UPDATE jobs SET nextRun = created, data = '{\"mockRequest\":true}', mockRequest = 1 WHERE jobID = " + jobID + ";";
+        tester->executeWaitVerifyContent(query);
+        tester->executeWaitVerifyContent(getJobCommand, "404 No job found");
+        getJobCommand["getMockedJobs"] = "true";
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(getJobCommand)["jobID"], jobID);
+
+        // And a job inserted directly is ready straight away.
+        query["query"] = "INSERT INTO jobs (jobID, created, state, name, nextRun, repeat, data) "
+                         "VALUES (1234567890123, DATETIME('now'), 'QUEUED', 'queried', DATETIME('now'), '', '{}');";
+        tester->executeWaitVerifyContent(query);
+        getJobCommand.erase("getMockedJobs");
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(getJobCommand)["jobID"], "1234567890123");
+    }
+
+    // GetJob with "Connection: wait" is held until there's a job for it, or it times out.
+    void testConnectionWait() {
+        SData getJobCommand("GetJob");
+        getJobCommand["name"] = "waiting";
+        getJobCommand["Connection"] = "wait";
+        getJobCommand["timeout"] = "1000";
+        uint64_t start = STimeNow();
+        tester->executeWaitVerifyContent(getJobCommand, "303 Timeout");
+        ASSERT_GREATER_THAN_EQUAL(STimeNow() - start, 1'000'000);
+
+        // Creating a job releases a waiting GetJob straight away.
+        getJobCommand["timeout"] = "20000";
+        STable response;
+        thread waiter([&]() {
+            response = tester->executeWaitVerifyContentTable(getJobCommand);
+        });
+        sleep(1);
+        SData command("CreateJob");
+        command["name"] = "waiting";
+        start = STimeNow();
+        string jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+        waiter.join();
+        ASSERT_EQUAL(response["jobID"], jobID);
+        ASSERT_LESS_THAN(STimeNow() - start, 5'000'000);
+
+        // So does a job's nextRun arriving.
+        command["firstRun"] = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() + 2'000'000);
+        jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(getJobCommand)["jobID"], jobID);
+    }
 } __GetJobTest;
 
@@ -0,0 +1,131 @@
+#include <test/lib/BedrockTester.h>
+#include <test/tests/jobs/JobTestHelper.h>
+
+struct PurgeJobsTest : tpunit::TestFixture {
+    PurgeJobsTest()
+        : tpunit::TestFixture("PurgeJobs",
+                              BEFORE_CLASS(PurgeJobsTest::setupClass),
+                              TEST(PurgeJobsTest::purgeOldJobs),
+                              TEST(PurgeJobsTest::keepChildrenOfRunningParents),
+                              TEST(PurgeJobsTest::limit),
+                              TEST(PurgeJobsTest::olderThanEpoch),
+                              AFTER(PurgeJobsTest::tearDown),
+                              AFTER_CLASS(PurgeJobsTest::tearDownClass)) { }
+
+    BedrockTester* tester;
+
+    void setupClass() { tester = new BedrockTester(_threadID, {{"-plugins", "Jobs,DB"}}, {});}
+
+    // Reset the jobs table
+    void tearDown() {
+        SData command("Query");
+        command["query"] = "DELETE FROM jobs WHERE jobID > 0;";
+        tester->executeWaitVerifyContent(command);
+    }
+
+    void tearDownClass() { delete tester; }
+
+    // Creates a job and then sets its state and when it last ran directly.
+    string createJob(const string& state, const string& lastRun, const string& parentJobID = "") {
+        SData command("CreateJob");
+        command["name"] = "job";
+        if (!parentJobID.empty()) {
+            command["parentJobID"] = parentJobID;
+        }
+        STable response = tester->executeWaitVerifyContentTable(command);
+        string jobID = response["jobID"];
+
+        command.clear();
+        command.methodLine = "Query";
+        command["query"] = "UPDATE jobs SET state = " + SQ(state) + ", lastRun = " + SQ(lastRun) + " WHERE jobID = " + jobID + ";";
+        tester->executeWaitVerifyContent(command);
+        return jobID;
+    }
+
+    void purgeOldJobs() {
+        const string old = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - 2 * 60 * 60 * STIME_US_PER_S);
+        const string recent = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow());
+        createJob("FINISHED", old);
+        createJob("FAILED", old);
+        createJob("CANCELLED", old);
+        string recentlyFailed = createJob("FAILED", recent);
+        string queued = createJob("QUEUED", old);
+
+        SData command("PurgeJobs");
+        command["olderThan"] = "3600";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "3");
+
+        // Only the old jobs that are done are gone.
+        SQResult result;
+        tester->readDB("SELECT jobID FROM jobs ORDER BY jobID;", result);
+        list<string> remaining;
+        for (auto& row : result.rows) {
+            remaining.push_back(row[0]);
+        }
+        list<string> expected = {recentlyFailed, queued};
+        expected.sort([](const string& a, const string& b) { return SToInt64(a) < SToInt64(b); });
+        ASSERT_EQUAL(SComposeList(remaining), SComposeList(expected));
+    }
+
+    void keepChildrenOfRunningParents() {
+        const string old = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - 2 * 60 * 60 * STIME_US_PER_S);
+
+        // The parent of a finished child needs to see it when it resumes, so it's kept until the parent's done too.
+        string parent = createJob("PAUSED", old);
+        string child = createJob("FINISHED", old, parent);
+        SData command("PurgeJobs");
+        command["olderThan"] = "3600";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "0");
+
+        // Once the parent has failed, they can both go.
+        command.clear();
+        command.methodLine = "Query";
+        command["query"] = "UPDATE jobs SET state = 'FAILED' WHERE jobID = " + parent + ";";
+        tester->executeWaitVerifyContent(command);
+        command.clear();
+        command.methodLine = "PurgeJobs";
+        command["olderThan"] = "3600";
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "2");
+        SQResult result;
+        tester->readDB("SELECT COUNT(*) FROM jobs WHERE jobID IN (" + parent + ", " + child + ");", result);
+        ASSERT_EQUAL(result[0][0], "0");
+    }
+
+    void limit() {
+        const string old = SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - 2 * 60 * 60 * STIME_US_PER_S);
+        for (int i = 0; i < 5; i++) {
+            createJob("FINISHED", old);
+        }
+
+        // Each batch only deletes as many as we ask for.
+        SData command("PurgeJobs");
+        command["olderThan"] = "3600";
+        command["limit"] = "2";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "2");
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "2");
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "1");
+        response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "0");
+
+        // We can't purge without saying how old the jobs need to be.
+        command.erase("olderThan");
+        tester->executeWaitVerifyContent(command, "402 Missing olderThan");
+    }
+
+    void olderThanEpoch() {
+        // Asking to keep jobs for longer than there's been time for keeps everything, rather than wrapping around.
+        createJob("FINISHED", SComposeTime("%Y-%m-%d %H:%M:%S", STimeNow() - 2 * 60 * 60 * STIME_US_PER_S));
+        SData command("PurgeJobs");
+        command["olderThan"] = "9000000000000";
+        STable response = tester->executeWaitVerifyContentTable(command);
+        ASSERT_EQUAL(response["purgedJobs"], "0");
+        ASSERT_EQUAL(tester->readDB("SELECT COUNT(*) FROM jobs;"), "1");
+    }
+
+} __PurgeJobsTest;
@@ -0,0 +1,109 @@
+#include <test/lib/BedrockTester.h>
+#include <plugins/Jobs.h>
+
+struct RepeatTest : tpunit::TestFixture {
+    RepeatTest()
+        : tpunit::TestFixture("Repeat",
+                              BEFORE_CLASS(RepeatTest::setupClass),
+                              TEST(RepeatTest::matchesSQLite),
+                              TEST(RepeatTest::cannedSchedules),
+                              TEST(RepeatTest::fallback),
+                              TEST(RepeatTest::invalid),
+                              AFTER_CLASS(RepeatTest::tearDownClass)) { }
+
+    sqlite3* db = nullptr;
+
+    void setupClass() { sqlite3_open(":memory:", &db); }
+
+    void tearDownClass() { sqlite3_close(db); }
+
+    // Returns what SQLite computes for the next run.
+    string sqliteNextRun(const BedrockJobsRepeat& repeat, const string& lastScheduled, const string& lastRun, uint64_t now) {
+        SQResult result;
+        SQuery(db, "nextRun", "SELECT " + repeat.nextRunSQL(lastScheduled, lastRun, now) + ";", result);
+        return result[0][0];
+    }
+
+    void matchesSQLite() {
+        // Each of these gets computed from the start of every month over a few years, including leap years, and from
+        // the last second of every month, and has to come out exactly as SQLite would have it.
+        list<string> repeats = {
+            "SCHEDULED, +1 MONTH",
+            "SCHEDULED, +13 MONTHS, -1 DAY",
+            "STARTED, +1 YEAR",
+            "STARTED, -1 YEARS, +400 DAYS",
+            "FINISHED, +1 HOUR, +30 MINUTES, -15 SECONDS",
+            "FINISHED, -90 MINUTES",
+            "SCHEDULED, START OF MONTH, +1 MONTH, -1 DAY",
+            "SCHEDULED, START OF YEAR, +6 MONTHS",
+            "STARTED, +1 DAY, START OF DAY, +9 HOURS",
+            "STARTED, WEEKDAY 1",
+            "STARTED, +1 DAY, WEEKDAY 0, START OF DAY",
+            "FINISHED, WEEKDAY 6, +1 MONTH, WEEKDAY 3",
+        };
+
+        // Every base time, and the same time in seconds, for `now`.
+        SQResult bases;
+        SQuery(db, "bases", "WITH RECURSIVE months(m) AS (SELECT 0 UNION ALL SELECT m + 1 FROM months WHERE m < 83), "
+                            "bases(base) AS ("
+                                "SELECT DATETIME('2019-01-01', m || ' MONTHS') FROM months UNION ALL "
+                                "SELECT DATE('2019-01-01', m || ' MONTHS') FROM months UNION ALL "
+                                "SELECT DATETIME('2019-01-01', (m + 1) || ' MONTHS', '-1 SECOND') FROM months) "
+                            "SELECT base, STRFTIME('%s', base) FROM bases;", bases);
+        ASSERT_EQUAL(bases.size(), 3u * 84);
+
+        for (const string& repeatString : repeats) {
+            auto repeat = BedrockJobsRepeat::get(repeatString);
+            ASSERT_TRUE(repeat);
+            for (auto& row : bases.rows) {
+                const string& base = row[0];
+                const uint64_t now = SToUInt64(row[1]) * STIME_US_PER_S;
+                string nextRun = repeat->nextRun(base, base, now);
+                ASSERT_FALSE(nextRun.empty());
+                ASSERT_EQUAL(nextRun, sqliteNextRun(*repeat, base, base, now));
+            }
+        }
+    }
+
+    void cannedSchedules() {
+        // 2020-09-13 12:26:40 was a Sunday.
+        const uint64_t now = 1600000000 * STIME_US_PER_S;
+        ASSERT_EQUAL(BedrockJobsRepeat::get("HOURLY")->nextRun("", "", now), "2020-09-13 13:00:00");
+        ASSERT_EQUAL(BedrockJobsRepeat::get("DAILY")->nextRun("", "", now), "2020-09-14 00:00:00");
+        ASSERT_EQUAL(BedrockJobsRepeat::get("WEEKLY")->nextRun("", "", now), "2020-09-20 00:00:00");
+        for (const char* name : {"HOURLY", "DAILY", "WEEKLY"}) {
+            auto repeat = BedrockJobsRepeat::get(name);
+            ASSERT_EQUAL(repeat->nextRun("", "", now), sqliteNextRun(*repeat, "", "", now));
+        }
+    }
+
+    void fallback() {
+        // A job that's never run has no `lastRun`, and a day past the end of the month is carried through the
+        // arithmetic by SQLite in a way we don't reproduce. Both are left to SQLite.
+        auto repeat = BedrockJobsRepeat::get("STARTED, +1 MONTH");
+        ASSERT_EQUAL(repeat->nextRun("2020-01-01 00:00:00", "", STimeNow()), "");
+        ASSERT_EQUAL(repeat->nextRun("", "2020-02-30 00:00:00", STimeNow()), "");
+        ASSERT_EQUAL(sqliteNextRun(*repeat, "", "2020-02-30 00:00:00", STimeNow()), "2020-03-30 00:00:00");
+
+        // So is anything that goes past the year 9999, where SQLite gives up.
+        repeat = BedrockJobsRepeat::get("SCHEDULED, +1 YEAR");
+        ASSERT_EQUAL(repeat->nextRun("9999-06-01 00:00:00", "", STimeNow()), "");
+        ASSERT_EQUAL(repeat->nextRun("9998-06-01 00:00:00", "", STimeNow()), "9999-06-01 00:00:00");
+
+        // And timestamps with a signed or space-padded field, which SQLite won't parse at all.
+        repeat = BedrockJobsRepeat::get("SCHEDULED, +1 HOUR");
+        for (const string& base : list<string>{"2020-01-01 -1:00:00", "2020-01-01 00:00:-1", "2020-+1-01 00:00:00",
+                                               "2020-01-01  1:00:00"}) {
+            ASSERT_EQUAL(repeat->nextRun(base, "", STimeNow()), "");
+            ASSERT_EQUAL(sqliteNextRun(*repeat, base, "", STimeNow()), "");
+        }
+    }
+
+    void invalid() {
+        ASSERT_FALSE(BedrockJobsRepeat::get("blabla"));
+        ASSERT_FALSE(BedrockJobsRepeat::get("SCHEDULED, +1 FORTNIGHT"));
+        ASSERT_FALSE(BedrockJobsRepeat::get("+1 HOUR"));
+        ASSERT_TRUE(BedrockJobsRepeat::get("scheduled, +1 hour"));
+    }
+
+} __RepeatTest;
@@ -6,6 +6,9 @@ struct UpdateJobTest : tpunit::TestFixture {
             : tpunit::TestFixture("UpdateJob",
                                   BEFORE_CLASS(UpdateJobTest::setupClass),
                                   TEST(UpdateJobTest::updateJob),
+                                  TEST(UpdateJobTest::updateMockRequest),
+                                  TEST(UpdateJobTest::nullMockRequest),
+                                  TEST(UpdateJobTest::backfillMockRequest),
                                   AFTER_CLASS(UpdateJobTest::tearDownClass)) { }
 
     BedrockTester* tester;
@@ -49,5 +52,82 @@ struct UpdateJobTest : tpunit::TestFixture {
         ASSERT_EQUAL(currentJob[0][3], "2020-01-01 00:00:00");
     }
 
+    // Whether a job is mocked follows its data, and GetJob only returns mocked jobs to mocked requests.
+    void updateMockRequest() {
+        SData command("CreateJob");
+        command["name"] = "mockedLater";
+        string jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+        SQResult result;
+        tester->readDB("SELECT mockRequest FROM jobs WHERE jobID = " + jobID + ";", result);
+        ASSERT_EQUAL(result[0][0], "0");
+
+        command.clear();
+        command.methodLine = "UpdateJob";
+        command["jobID"] = jobID;
+        command["data"] = "{\"mockRequest\":true}";
+        tester->executeWaitVerifyContent(command);
+        tester->readDB("SELECT mockRequest FROM jobs WHERE jobID = " + jobID + ";", result);
+        ASSERT_EQUAL(result[0][0], "1");
+
+        SData getJobCommand("GetJob");
+        getJobCommand["name"] = "mockedLater";
+        tester->executeWaitVerifyContent(getJobCommand, "404 No job found");
+        getJobCommand["getMockedJobs"] = "true";
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(getJobCommand)["jobID"], jobID);
+    }
+
+    // A null `mockRequest` in the data doesn't make a job mocked, so it can be taken and finished like any other.
+    void nullMockRequest() {
+        SData command("CreateJob");
+        command["name"] = "nullMock";
+        command["data"] = "{\"mockRequest\":null}";
+        string jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+        ASSERT_EQUAL(tester->readDB("SELECT mockRequest FROM jobs WHERE jobID = " + jobID + ";"), "0");
+
+        command.clear();
+        command.methodLine = "GetJob";
+        command["name"] = "nullMock";
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(command)["jobID"], jobID);
+
+        command.clear();
+        command.methodLine = "FinishJob";
+        command["jobID"] = jobID;
+        command["data"] = "{\"mockRequest\":null}";
+        tester->executeWaitVerifyContent(command);
+    }
+
+    // Jobs that were there before the `mockRequest` column get it filled in a batch at a time.
+    void backfillMockRequest() {
+        map<string, string> mockedByJobID;
+        for (const string& data : list<string>{"{\"mockRequest\":true}", "{}", "{\"mockRequest\":null}", "{\"mockRequest\":true}"}) {
+            SData command("CreateJob");
+            command["name"] = "backfill";
+            command["data"] = data;
+            string jobID = tester->executeWaitVerifyContentTable(command)["jobID"];
+            mockedByJobID[jobID] = data.find("true") != string::npos ? "1" : "0";
+        }
+
+        // Make it look like the column's just been added.
+        SData query("Query");
+        query["query"] = "UPDATE jobs SET mockRequest = 0;";
+        tester->executeWaitVerifyContent(query);
+        query["query"] = "INSERT INTO jobsMockRequestBackfill VALUES ( 0 );";
+        tester->executeWaitVerifyContent(query);
+
+        // One job at a time, it takes a batch for each job in the table, and then one more that finds there's nothing
+        // left.
+        SData command("BackfillMockRequest");
+        command["limit"] = "1";
+        int64_t jobCount = SToInt64(tester->readDB("SELECT COUNT(*) FROM jobs;"));
+        for (int64_t batch = 0; batch < jobCount; batch++) {
+            ASSERT_EQUAL(tester->executeWaitVerifyContentTable(command)["done"], batch == jobCount - 1 ? "true" : "false");
+        }
+        ASSERT_EQUAL(tester->readDB("SELECT COUNT(*) FROM jobsMockRequestBackfill;"), "0");
+        for (const auto& job : mockedByJobID) {
+            ASSERT_EQUAL(tester->readDB("SELECT mockRequest FROM jobs WHERE jobID = " + job.first + ";"), job.second);
+        }
+        ASSERT_EQUAL(tester->executeWaitVerifyContentTable(command)["done"], "true");
+    }
+
 } __UpdateJobTest;
 